@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xgossip/include/block_log_store.h"
+#include "xgossip/include/header_block_data.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+// blocks stored per run, fewer of the large ones
+static const uint32_t kBenchStoreBytes = 64 * 1024 * 1024;
+
+// args: block bytes, 1 to read a view instead of a copy. The read a sync
+// request does on a HeaderBlockData over the log store
+static void BM_HeaderBlockRead(benchmark::State& state) {
+    auto block_store = std::make_shared<BlockLogStore>("", 4 * 1024 * 1024, 60 * 1000);
+    HeaderBlockData header_block_data(block_store);
+    const std::string block(state.range(0), 'x');
+    uint32_t block_count = kBenchStoreBytes / block.size();
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < block_count; ++i) {
+        keys.push_back(std::to_string(i * 2654435761u));
+        header_block_data.AddData(keys.back(), block);
+    }
+
+    bool view_read = (state.range(1) != 0);
+    uint32_t index = 0;
+    for (auto _ : state) {
+        const std::string& key = keys[index++ % block_count];
+        if (view_read) {
+            BlockLogView view;
+            benchmark::DoNotOptimize(header_block_data.GetViewIfPresent(key, view));
+            benchmark::DoNotOptimize(view.data);
+        } else {
+            std::string value;
+            benchmark::DoNotOptimize(header_block_data.GetDataIfPresent(key, value));
+            benchmark::DoNotOptimize(value.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HeaderBlockRead)->ArgsProduct({ { 1024, 16 * 1024, 256 * 1024 }, { 0, 1 } });
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/layered_tree_index.h"
+#include "xgossip/include/neighbor_liveness.h"
+#include "xgossip/bench/bench_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+// args: node count, neighbor count. Next hops of every node of the tree,
+// what the old choose_next_nodes level walk computed one node at a time
+static void BM_LayeredChildrenRange(benchmark::State& state) {
+    uint32_t count = state.range(0);
+    uint32_t k = state.range(1);
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (uint32_t index = 1; index <= count; ++index) {
+            sum += LayeredChildrenRange(index, k, count).size();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LayeredChildrenRange)
+        ->ArgsProduct({ { 64, 1024, 16384 }, { 2, 3, 5, 8 } });
+
+// args: node count, neighbor count, 1 to rebuild the plan every time
+static void BM_BroadcastLayered(benchmark::State& state) {
+    auto transport = std::make_shared<BenchTransport>();
+    auto nodes = CreateBenchNodes(state.range(0));
+    auto routing_table = CreateBenchRoutingTable(transport, nodes);
+    BroadcastLayered broadcast(transport);
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(1024, state.range(1), message);
+    message.mutable_gossip()->set_gossip_type(kGossipLayeredBroadcast);
+    bool plan_miss = (state.range(2) != 0);
+    for (auto _ : state) {
+        if (plan_miss) {
+            broadcast.OnRoutingTableChanged();
+        }
+        transport::protobuf::RoutingMessage broadcast_message(message);
+        broadcast.Broadcast(broadcast_message, routing_table);
+    }
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    broadcast.GetPlanCacheStat(hit_count, miss_count);
+    state.counters["plan_hit"] = hit_count;
+    state.counters["plan_miss"] = miss_count;
+    state.SetItemsProcessed(transport->send_count());
+    state.SetBytesProcessed(transport->send_bytes());
+}
+BENCHMARK(BM_BroadcastLayered)
+        ->ArgsProduct({ { 64, 1024 }, { 2, 3, 5, 8 }, { 0, 1 } });
+
+// args: node count, percent of dead members. Share of the live members a
+// layered broadcast reaches while dead members stay in every routing table:
+// the first message loses the subtrees below them, once their failed sends
+// make them suspect the relays above send to their children too
+static void BM_LayeredCoverageUnderChurn(benchmark::State& state) {
+    uint32_t node_count = state.range(0);
+    BenchNetwork network(node_count);
+    uint32_t dead_count = 0;
+    if (state.range(1) > 0) {
+        uint32_t step = 100 / state.range(1);
+        for (uint32_t i = step - 1; i < node_count; i += step) {
+            network.SetDead(i, true);
+            ++dead_count;
+        }
+    }
+    // liveness is process wide, start from what earlier runs left
+    auto& nodes = network.nodes();
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        auto local_node = iter->routing_table->get_local_node_info();
+        NeighborLiveness::Instance()->OnAck(local_node->public_ip(), local_node->public_port());
+    }
+
+    double live_count = node_count - dead_count - 1;
+    double first_coverage = -1.0;
+    double coverage_sum = 0.0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        transport::protobuf::RoutingMessage message;
+        CreateBenchMessage(1024, 3, message);
+        message.mutable_gossip()->set_gossip_type(kGossipLayeredBroadcast);
+        state.ResumeTiming();
+        network.Run(message, false);
+        double coverage = network.reached() / live_count;
+        if (first_coverage < 0) {
+            first_coverage = coverage;
+        }
+        coverage_sum += coverage;
+    }
+    state.counters["first_coverage"] = first_coverage;
+    state.counters["coverage"] = coverage_sum / state.iterations();
+}
+BENCHMARK(BM_LayeredCoverageUnderChurn)
+        ->ArgsProduct({ { 256, 1024 }, { 0, 5, 10, 20 } })
+        ->Iterations(100)
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
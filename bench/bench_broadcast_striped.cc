@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+
+#include "xgossip/bench/bench_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+// args: node count, neighbor count, 1 for striped. Upload bytes of the
+// busiest relay against the mean: one layered tree puts K copies of the
+// message on its 1/K interior nodes, the stripes spread them over everyone.
+// completion_depth is the hop by which every member had all K stripes, the
+// whole message for the single tree, so the two modes compare directly
+static void BM_BroadcastStripedUpload(benchmark::State& state) {
+    const uint32_t payload_size = 256 * 1024;
+    BenchNetwork network(state.range(0));
+    bool striped = (state.range(2) != 0);
+    uint64_t packet_count = 0;
+    uint64_t completed = 0;
+    uint32_t completion_depth = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        transport::protobuf::RoutingMessage message;
+        CreateBenchMessage(payload_size, state.range(1), message);
+        message.mutable_gossip()->set_gossip_type(
+                striped ? kGossipStripedLayered : kGossipLayeredBroadcast);
+        state.ResumeTiming();
+        packet_count += network.Run(message, striped);
+        completed += network.completed();
+        completion_depth = std::max(completion_depth, network.completion_depth());
+    }
+
+    // the originator sends K copies in both modes, relays are what differ
+    auto& nodes = network.nodes();
+    uint64_t max_upload = 0;
+    uint64_t total_upload = 0;
+    for (uint32_t i = 1; i < nodes.size(); ++i) {
+        max_upload = std::max(max_upload, nodes[i].transport->send_bytes());
+        total_upload += nodes[i].transport->send_bytes();
+    }
+    double broadcasts = static_cast<double>(state.iterations());
+    state.counters["origin_upload"] = nodes[0].transport->send_bytes() / broadcasts;
+    state.counters["max_relay_upload"] = max_upload / broadcasts;
+    state.counters["mean_relay_upload"] = total_upload / broadcasts / (nodes.size() - 1);
+    state.counters["packets"] = packet_count / broadcasts;
+    state.counters["completed_ratio"] = completed / broadcasts / (nodes.size() - 1);
+    state.counters["completion_depth"] = completion_depth;
+    state.SetBytesProcessed(total_upload + nodes[0].transport->send_bytes());
+}
+BENCHMARK(BM_BroadcastStripedUpload)
+        ->ArgsProduct({ { 64, 512 }, { 3, 5, 8 }, { 0, 1 } })
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "xgossip/include/gossip_filter.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/mesages_with_bloomfilter.h"
+#include "xgossip/bench/bench_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+// args: payload bytes, FilterMessage copies the gossip param with the block
+static void BM_FilterMessageNew(benchmark::State& state) {
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    message.mutable_gossip()->set_block(std::string(state.range(0), 'b'));
+    uint32_t msg_hash = message.gossip().msg_hash() << 8;
+    for (auto _ : state) {
+        message.mutable_gossip()->set_msg_hash(++msg_hash);
+        benchmark::DoNotOptimize(GossipFilter::Instance()->FilterMessage(message));
+    }
+}
+BENCHMARK(BM_FilterMessageNew)->Arg(0)->Arg(1024)->Arg(16384);
+
+static void BM_FilterMessageDuplicate(benchmark::State& state) {
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    message.mutable_gossip()->set_block(std::string(state.range(0), 'b'));
+    GossipFilter::Instance()->FilterMessage(message);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(GossipFilter::Instance()->FilterMessage(message));
+    }
+}
+BENCHMARK(BM_FilterMessageDuplicate)->Arg(0)->Arg(1024)->Arg(16384);
+
+// args: bloomfilter words carried by the message, 0 builds an empty filter
+static void BM_GetMessageBloomfilter(benchmark::State& state) {
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        message.add_bloomfilter(0x0101010101010101ull << (i % 8));
+    }
+    uint32_t msg_hash = message.gossip().msg_hash() << 8;
+    for (auto _ : state) {
+        message.mutable_gossip()->set_msg_hash(++msg_hash);
+        bool stop_gossip = false;
+        benchmark::DoNotOptimize(
+                MessageWithBloomfilter::Instance()->GetMessageBloomfilter(message, stop_gossip));
+    }
+}
+BENCHMARK(BM_GetMessageBloomfilter)->Arg(0)->Arg(kGossipBloomfilterSize / 64);
+
+// args: distinct message hashes cycled through
+static void BM_StopGossip(benchmark::State& state) {
+    uint32_t hash_count = state.range(0);
+    uint32_t index = 0;
+    for (auto _ : state) {
+        uint32_t msg_hash = 0x5a000000u + (index++ % hash_count);
+        benchmark::DoNotOptimize(
+                MessageWithBloomfilter::Instance()->StopGossip(msg_hash, kGossipSwitchLayerCount));
+    }
+}
+BENCHMARK(BM_StopGossip)->Arg(1)->Arg(1024)->Arg(65536);
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,55 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_config.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/gossip_filter.h"
+
+namespace top {
+    std::shared_ptr<top::base::KadmliaKey> global_xid;
+    uint32_t gloabl_platform_type = kPlatform;
+    std::string global_node_id = RandomString(256);
+    std::string global_node_id_hash("");
+}
+
+// results also go to xgossip_bench.json unless --benchmark_out is given, so
+// every run leaves a file to compare against a baseline with
+// benchmark's tools/compare.py
+int main(int argc, char *argv[]) {
+    xinit_log("xgossip_bench.log", true, true);
+    xset_log_level(enum_xlog_level_error);
+    top::base::Config config;
+    config.Init("./conf.ut/test_routing_table.conf");
+    top::kadmlia::CreateGlobalXid(config);
+    top::gossip::GossipFilter::Instance()->Init();
+
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--benchmark_out=", strlen("--benchmark_out=")) == 0) {
+            has_out = true;
+        }
+    }
+    std::string out_arg = "--benchmark_out=xgossip_bench.json";
+    std::string format_arg = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(&out_arg[0]);
+        args.push_back(&format_arg[0]);
+    }
+    int bench_argc = args.size();
+    benchmark::Initialize(&bench_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(bench_argc, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,276 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "xgossip/include/block_log_store.h"
+#include "xgossip/include/block_sync_manager.h"
+#include "xgossip/include/gossip_filter.h"
+#include "xgossip/include/gossip_registry.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/lock_wait_mutex.h"
+#include "xgossip/include/mesages_with_bloomfilter.h"
+#include "xgossip/bench/bench_utils.h"
+
+// Thread scaling of the process wide singletons as receive threads are
+// added. Every benchmark runs from 1 to 64 threads on shared message
+// hashes, a duplicate is a hash another thread drew recently, as copies of
+// one broadcast arrive from several neighbors at once. Besides throughput
+// (items_per_second, over all threads) each reports:
+//   p99_ns      99th percentile of one call, averaged over threads
+//   lock_waits  lock() calls that found the mutex held, per call
+//   wait_ns     time those lock() calls blocked, per call
+// Lock waits are counted by the LockWaitMutex of GossipFilter,
+// MessageWithBloomfilter and the BlockSyncManager shards, summed
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+static const int kScalingMaxThreads = 64;
+// new hashes wrap after this many, so long runs keep a bounded working set
+static const uint64_t kScalingHashSpace = 1ull << 20;
+// duplicates are drawn from the last kScalingDuplicateWindow new hashes
+static const uint64_t kScalingDuplicateWindow = 256ull;
+
+static std::atomic<uint64_t> scaling_hash_seq{ 0 };
+
+// shared message hash source, state.range(0) is the duplicate percent
+class ScalingHashes {
+public:
+    ScalingHashes(uint32_t duplicate_percent, uint32_t seed)
+            : duplicate_percent_(duplicate_percent), random_(seed) {}
+    uint32_t Next() {
+        uint64_t seq = 0;
+        if (random_() % 100 < duplicate_percent_) {
+            uint64_t last = scaling_hash_seq.load(std::memory_order_relaxed);
+            seq = last - std::min(last, static_cast<uint64_t>(random_() % kScalingDuplicateWindow));
+        } else {
+            seq = scaling_hash_seq.fetch_add(1, std::memory_order_relaxed);
+        }
+        // spread like msg_hash, which is a hash of the message
+        return static_cast<uint32_t>((seq % kScalingHashSpace + 1) * 2654435761ull);
+    }
+
+private:
+    uint32_t duplicate_percent_;
+    std::mt19937 random_;
+};
+
+static LockWaitStat GetScalingLockWait() {
+    LockWaitStat stat;
+    GossipFilter::Instance()->GetLockWaitStat(stat);
+    MessageWithBloomfilter::Instance()->GetLockWaitStat(stat);
+    BlockSyncManager::Instance()->GetLockWaitStat(stat);
+    return stat;
+}
+
+// per thread timing of each call, thread 0 also reports the lock waits
+class ScalingRecorder {
+public:
+    ScalingRecorder() {
+        latency_ns_.reserve(1 << 16);
+    }
+    void Start() {
+        if (call_count_ == 0) {
+            // after the benchmark start barrier, not before it
+            lock_wait_start_ = GetScalingLockWait();
+        }
+        call_start_ = std::chrono::steady_clock::now();
+    }
+    void Stop() {
+        auto call_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - call_start_).count();
+        if (latency_ns_.size() < kMaxSamples) {
+            latency_ns_.push_back(call_ns);
+        }
+        ++call_count_;
+    }
+    void Report(benchmark::State& state) {
+        uint64_t p99_ns = 0;
+        if (!latency_ns_.empty()) {
+            size_t index = (latency_ns_.size() - 1) * 99 / 100;
+            std::nth_element(latency_ns_.begin(), latency_ns_.begin() + index, latency_ns_.end());
+            p99_ns = latency_ns_[index];
+        }
+        state.counters["p99_ns"] = benchmark::Counter(p99_ns, benchmark::Counter::kAvgThreads);
+        state.SetItemsProcessed(call_count_);
+        if (state.thread_index() != 0) {
+            return;
+        }
+        // waits of all threads over the calls of all threads, other threads
+        // may still be in their last calls
+        LockWaitStat lock_wait = GetScalingLockWait();
+        double calls = static_cast<double>(std::max<uint64_t>(call_count_ * state.threads(), 1));
+        state.counters["lock_waits"] = (lock_wait.wait_count - lock_wait_start_.wait_count) / calls;
+        state.counters["wait_ns"] = (lock_wait.wait_ns - lock_wait_start_.wait_ns) / calls;
+    }
+
+private:
+    static const size_t kMaxSamples = 1 << 20;
+
+    std::vector<uint64_t> latency_ns_;
+    std::chrono::steady_clock::time_point call_start_;
+    LockWaitStat lock_wait_start_;
+    uint64_t call_count_{ 0 };
+};
+
+static uint32_t ScalingSeed() {
+    static std::atomic<uint32_t> seed{ 1 };
+    return seed++;
+}
+
+static void BM_ScaleFilterMessage(benchmark::State& state) {
+    ScalingHashes hashes(state.range(0), ScalingSeed());
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    ScalingRecorder recorder;
+    for (auto _ : state) {
+        message.mutable_gossip()->set_msg_hash(hashes.Next());
+        recorder.Start();
+        benchmark::DoNotOptimize(GossipFilter::Instance()->FilterMessage(message));
+        recorder.Stop();
+    }
+    recorder.Report(state);
+}
+BENCHMARK(BM_ScaleFilterMessage)
+        ->Arg(0)->Arg(50)->Arg(80)
+        ->ThreadRange(1, kScalingMaxThreads)->UseRealTime();
+
+static void BM_ScaleStopGossip(benchmark::State& state) {
+    ScalingHashes hashes(state.range(0), ScalingSeed());
+    ScalingRecorder recorder;
+    for (auto _ : state) {
+        uint32_t msg_hash = hashes.Next();
+        recorder.Start();
+        benchmark::DoNotOptimize(
+                MessageWithBloomfilter::Instance()->StopGossip(msg_hash, kGossipSwitchLayerCount));
+        recorder.Stop();
+    }
+    recorder.Report(state);
+}
+BENCHMARK(BM_ScaleStopGossip)
+        ->Arg(0)->Arg(50)->Arg(80)
+        ->ThreadRange(1, kScalingMaxThreads)->UseRealTime();
+
+static void BM_ScaleGetMessageBloomfilter(benchmark::State& state) {
+    ScalingHashes hashes(state.range(0), ScalingSeed());
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    for (uint32_t i = 0; i < kGossipBloomfilterSize / 64; ++i) {
+        message.add_bloomfilter(0x0101010101010101ull << (i % 8));
+    }
+    ScalingRecorder recorder;
+    for (auto _ : state) {
+        message.mutable_gossip()->set_msg_hash(hashes.Next());
+        bool stop_gossip = false;
+        recorder.Start();
+        benchmark::DoNotOptimize(
+                MessageWithBloomfilter::Instance()->GetMessageBloomfilter(message, stop_gossip));
+        recorder.Stop();
+    }
+    recorder.Report(state);
+}
+BENCHMARK(BM_ScaleGetMessageBloomfilter)
+        ->Arg(0)->Arg(50)->Arg(80)
+        ->ThreadRange(1, kScalingMaxThreads)->UseRealTime();
+
+// header only announcements, as every gossip receive hands them to sync
+static void BM_ScaleNewBroadcastMessage(benchmark::State& state) {
+    static std::once_flag store_flag;
+    std::call_once(store_flag, []() {
+        BlockSyncManager::Instance()->SetBlockLogStore(
+                std::make_shared<BlockLogStore>("", 4 * 1024 * 1024, 60 * 1000));
+    });
+    ScalingHashes hashes(state.range(0), ScalingSeed());
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(0, 3, message);
+    message.set_is_root(true);
+    message.mutable_gossip()->set_pre_ip("127.0.0.1");
+    ScalingRecorder recorder;
+    uint32_t index = 0;
+    for (auto _ : state) {
+        uint32_t msg_hash = hashes.Next();
+        message.mutable_gossip()->set_msg_hash(msg_hash);
+        message.mutable_gossip()->set_header_hash(
+                std::string(reinterpret_cast<const char*>(&msg_hash), sizeof(msg_hash)));
+        message.mutable_gossip()->set_pre_port(10000 + (index++ % 8));
+        recorder.Start();
+        BlockSyncManager::Instance()->NewBroadcastMessage(message);
+        recorder.Stop();
+    }
+    recorder.Report(state);
+}
+BENCHMARK(BM_ScaleNewBroadcastMessage)
+        ->Arg(0)->Arg(50)->Arg(80)
+        ->ThreadRange(1, kScalingMaxThreads)->UseRealTime();
+
+// one registry shared by all receive threads, as in a node
+struct ScalingGossip {
+    std::shared_ptr<BenchTransport> transport;
+    std::shared_ptr<GossipRegistry> registry;
+    GossipContext context;
+};
+
+static ScalingGossip& GetScalingGossip() {
+    static std::once_flag gossip_flag;
+    static ScalingGossip gossip;
+    std::call_once(gossip_flag, []() {
+        gossip.transport = std::make_shared<BenchTransport>();
+        auto nodes = CreateBenchNodes(256);
+        gossip.registry = std::make_shared<GossipRegistry>(gossip.transport);
+        gossip.context.routing_table = CreateBenchRoutingTable(gossip.transport, nodes);
+        gossip.context.neighbors = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>(nodes);
+        gossip.context.local_hash64 = gossip.context.routing_table->get_local_node_info()->hash64();
+    });
+    return gossip;
+}
+
+// args: GossipType, duplicate percent
+static void BM_ScaleBroadcast(benchmark::State& state) {
+    auto& gossip = GetScalingGossip();
+    uint32_t gossip_type = state.range(0);
+    if (!gossip.registry->Has(gossip_type)) {
+        state.SkipWithError("gossip type not registered");
+        return;
+    }
+    ScalingHashes hashes(state.range(1), ScalingSeed());
+    transport::protobuf::RoutingMessage message;
+    CreateBenchMessage(1024, 3, message);
+    message.mutable_gossip()->set_gossip_type(gossip_type);
+    ScalingRecorder recorder;
+    for (auto _ : state) {
+        transport::protobuf::RoutingMessage broadcast_message(message);
+        broadcast_message.mutable_gossip()->set_msg_hash(hashes.Next());
+        recorder.Start();
+        gossip.registry->Broadcast(gossip.context, broadcast_message);
+        recorder.Stop();
+    }
+    recorder.Report(state);
+}
+BENCHMARK(BM_ScaleBroadcast)
+        ->ArgsProduct({
+                { kGossipBloomfilter,
+                  kGossipLayeredBroadcast,
+                  kGossipBloomfilterAndLayered,
+                  kGossipSetFilterAndLayered,
+                  kGossipLayeredCapacity },
+                { 0, 80 } })
+        ->ThreadRange(1, kScalingMaxThreads)->UseRealTime();
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,179 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/bench/bench_utils.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "xpbase/base/top_utils.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/tests/test_gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+std::vector<kadmlia::NodeInfoPtr> CreateBenchNodes(uint32_t node_count) {
+    auto nodes = test::CreateTestNodes(node_count, 10000);
+    std::sort(
+            nodes.begin(),
+            nodes.end(),
+            [](const kadmlia::NodeInfoPtr& left, const kadmlia::NodeInfoPtr& right) -> bool {
+        return left->hash64 < right->hash64;
+    });
+    return nodes;
+}
+
+kadmlia::RoutingTablePtr CreateBenchRoutingTable(
+        transport::TransportPtr transport,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+    return test::CreateTestRoutingTable(transport, test::CreateTestLocalNode(9999), nodes);
+}
+
+void CreateBenchMessage(
+        uint32_t payload_size,
+        uint32_t neighbor_count,
+        transport::protobuf::RoutingMessage& message) {
+    static std::atomic<uint32_t> msg_hash{ 1 };
+    message.set_id(msg_hash);
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(0);
+    message.set_src_node_id(RandomString(kadmlia::kNodeIdSize));
+    message.set_des_node_id(RandomString(kadmlia::kNodeIdSize));
+    message.set_data(std::string(payload_size, 'd'));
+    auto gossip_param = message.mutable_gossip();
+    gossip_param->set_neighber_count(neighbor_count);
+    gossip_param->set_stop_times(kGossipSwitchLayerCount);
+    gossip_param->set_gossip_type(kGossipBloomfilter);
+    gossip_param->set_max_hop_num(10);
+    gossip_param->set_evil_rate(0);
+    gossip_param->set_msg_hash(msg_hash++);
+    gossip_param->set_min_dis(0);
+    gossip_param->set_max_dis(0);
+}
+
+int NetworkTransport::SendData(base::xpacket_t& packet) {
+    BenchTransport::SendData(packet);
+    if (dead_ports_.find(packet.get_to_ip_port()) != dead_ports_.end()) {
+        return kadmlia::kKadFailed;
+    }
+    auto& body = packet.get_body();
+    packets_.push_back(BenchPacket{
+            packet.get_to_ip_port(),
+            std::string((const char*)body.data(), body.size()) });
+    return kadmlia::kKadSuccess;
+}
+
+BenchNetwork::BenchNetwork(uint32_t node_count) {
+    std::vector<kadmlia::LocalNodeInfoPtr> local_nodes;
+    std::vector<kadmlia::NodeInfoPtr> members;
+    for (uint32_t i = 0; i < node_count; ++i) {
+        local_nodes.push_back(test::CreateTestLocalNode(20000 + i));
+        members.push_back(test::CreateTestNode(local_nodes.back()));
+    }
+    for (uint32_t i = 0; i < node_count; ++i) {
+        std::vector<kadmlia::NodeInfoPtr> others(members);
+        others.erase(others.begin() + i);
+        NetworkNode node;
+        node.transport = std::make_shared<NetworkTransport>(packets_, dead_ports_);
+        node.routing_table = test::CreateTestRoutingTable(node.transport, local_nodes[i], others);
+        node.layered = std::make_shared<BroadcastLayered>(node.transport);
+        node.striped = std::make_shared<BroadcastStriped>(node.transport);
+        port_map_[local_nodes[i]->public_port()] = nodes_.size();
+        nodes_.push_back(node);
+    }
+}
+
+void BenchNetwork::SetDead(uint32_t index, bool dead) {
+    uint16_t port = nodes_[index].routing_table->get_local_node_info()->public_port();
+    if (dead) {
+        dead_ports_.insert(port);
+    } else {
+        dead_ports_.erase(port);
+    }
+}
+
+uint64_t BenchNetwork::Run(transport::protobuf::RoutingMessage& message, bool striped) {
+    reached_.clear();
+    arrival_hops_.clear();
+    Broadcast(nodes_[0], message, striped);
+    uint64_t packet_count = 0;
+    while (!packets_.empty()) {
+        BenchPacket packet = std::move(packets_.front());
+        packets_.pop_front();
+        auto iter = port_map_.find(packet.port);
+        if (iter == port_map_.end() || packet.body.size() < sizeof(_xip2_header)) {
+            continue;
+        }
+        transport::protobuf::RoutingMessage relay_message;
+        if (!relay_message.ParseFromArray(
+                packet.body.data() + sizeof(_xip2_header),
+                packet.body.size() - sizeof(_xip2_header))) {
+            continue;
+        }
+        ++packet_count;
+        relay_message.set_hop_num(relay_message.hop_num() + 1);
+        if (iter->second != 0) {
+            reached_.insert(iter->second);
+            AddArrival(iter->second, relay_message);
+        }
+        Broadcast(nodes_[iter->second], relay_message, striped);
+    }
+    CountCompletion();
+    return packet_count;
+}
+
+void BenchNetwork::AddArrival(
+        uint32_t index,
+        const transport::protobuf::RoutingMessage& message) {
+    // a layered message is the whole message, one stripe of one
+    StripeHeader header;
+    std::string stripe;
+    uint32_t stripe_index = 0;
+    uint32_t stripe_count = 1;
+    if (BroadcastStriped::DecodeStripe(message.data(), header, stripe)) {
+        stripe_index = header.stripe_index;
+        stripe_count = header.stripe_count;
+    }
+    auto& hops = arrival_hops_[index];
+    if (hops.size() < stripe_count) {
+        hops.resize(stripe_count, std::numeric_limits<uint32_t>::max());
+    }
+    hops[stripe_index] = std::min(hops[stripe_index], static_cast<uint32_t>(message.hop_num()));
+}
+
+void BenchNetwork::CountCompletion() {
+    completed_ = 0;
+    completion_depth_ = 0;
+    for (auto iter = arrival_hops_.begin(); iter != arrival_hops_.end(); ++iter) {
+        uint32_t last_hop = *std::max_element(iter->second.begin(), iter->second.end());
+        if (last_hop == std::numeric_limits<uint32_t>::max()) {
+            continue;
+        }
+        ++completed_;
+        completion_depth_ = std::max(completion_depth_, last_hop);
+    }
+}
+
+void BenchNetwork::Broadcast(
+        NetworkNode& node,
+        transport::protobuf::RoutingMessage& message,
+        bool striped) {
+    if (striped) {
+        node.striped->Broadcast(message, node.routing_table);
+    } else {
+        node.layered->Broadcast(message, node.routing_table);
+    }
+}
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "xtransport/udp_transport/udp_transport.h"
+#include "xkad/routing_table/local_node_info.h"
+#include "xkad/routing_table/node_info.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xgossip/gossip_interface.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/broadcast_striped.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace bench {
+
+// UdpTransport that is never started, sends only count packets and bytes
+class BenchTransport : public transport::UdpTransport {
+public:
+    BenchTransport() {}
+    virtual ~BenchTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override {
+        ++send_count_;
+        send_bytes_ += packet.get_body().size();
+        return kadmlia::kKadSuccess;
+    }
+    uint64_t send_count() const { return send_count_; }
+    uint64_t send_bytes() const { return send_bytes_; }
+
+private:
+    std::atomic<uint64_t> send_count_{ 0 };
+    std::atomic<uint64_t> send_bytes_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(BenchTransport);
+};
+
+// exposes the protected GossipInterface helpers to the benchmarks
+class BenchGossip : public GossipInterface {
+public:
+    explicit BenchGossip(transport::TransportPtr transport_ptr) : GossipInterface(transport_ptr) {}
+    virtual ~BenchGossip() {}
+    virtual void Broadcast(
+            uint64_t local_hash64,
+            transport::protobuf::RoutingMessage& message,
+            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors) {}
+
+    using GossipInterface::GetDistance;
+    using GossipInterface::SelectNodes;
+    using GossipInterface::SendLayered;
+};
+
+struct BenchPacket {
+    uint16_t port;
+    std::string body;
+};
+
+// BenchTransport of one member of a BenchNetwork, hands its packets to the
+// network. a packet to a dead member fails, standing in for the ack
+// timeout the sender would see
+class NetworkTransport : public BenchTransport {
+public:
+    NetworkTransport(
+            std::deque<BenchPacket>& packets,
+            const std::unordered_set<uint16_t>& dead_ports)
+            : packets_(packets), dead_ports_(dead_ports) {}
+    virtual ~NetworkTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override;
+
+private:
+    std::deque<BenchPacket>& packets_;
+    const std::unordered_set<uint16_t>& dead_ports_;
+
+    DISALLOW_COPY_AND_ASSIGN(NetworkTransport);
+};
+
+struct NetworkNode {
+    std::shared_ptr<NetworkTransport> transport;
+    kadmlia::RoutingTablePtr routing_table;
+    std::shared_ptr<BroadcastLayered> layered;
+    std::shared_ptr<BroadcastStriped> striped;
+};
+
+// every member runs its own broadcast over its own routing table, packets
+// go from one to the next in one thread until the message dies out
+class BenchNetwork {
+public:
+    explicit BenchNetwork(uint32_t node_count);
+    ~BenchNetwork() {}
+
+    // node 0 originates message, returns the packets delivered
+    uint64_t Run(transport::protobuf::RoutingMessage& message, bool striped);
+    // a dead member drops what it gets and fails every send to it
+    void SetDead(uint32_t index, bool dead);
+    // members other than the originator that got the last message
+    uint32_t reached() const { return reached_.size(); }
+    // members other than the originator that got every stripe of the last
+    // message, the whole message when it was not striped
+    uint32_t completed() const { return completed_; }
+    // hop by which the last of them had every stripe
+    uint32_t completion_depth() const { return completion_depth_; }
+    const std::vector<NetworkNode>& nodes() const { return nodes_; }
+
+private:
+    void Broadcast(NetworkNode& node, transport::protobuf::RoutingMessage& message, bool striped);
+    // records the hop stripe arrived at node index by, the first one counts
+    void AddArrival(uint32_t index, const transport::protobuf::RoutingMessage& message);
+    void CountCompletion();
+
+    std::deque<BenchPacket> packets_;
+    std::unordered_set<uint16_t> dead_ports_;
+    std::unordered_set<uint32_t> reached_;
+    // node index to the first hop each stripe arrived by
+    std::unordered_map<uint32_t, std::vector<uint32_t>> arrival_hops_;
+    uint32_t completed_{ 0 };
+    uint32_t completion_depth_{ 0 };
+    std::vector<NetworkNode> nodes_;
+    std::unordered_map<uint16_t, uint32_t> port_map_;
+
+    DISALLOW_COPY_AND_ASSIGN(BenchNetwork);
+};
+
+// nodes and routing tables come from the test helpers in
+// tests/test_gossip_utils.h, these only fix what the benchmarks share
+
+// node_count nodes with random ids on 127.0.0.1, sorted by hash64
+std::vector<kadmlia::NodeInfoPtr> CreateBenchNodes(uint32_t node_count);
+// a routing table holding nodes, sending through transport
+kadmlia::RoutingTablePtr CreateBenchRoutingTable(
+        transport::TransportPtr transport,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes);
+// a gossip message carrying payload_size block bytes
+void CreateBenchMessage(
+        uint32_t payload_size,
+        uint32_t neighbor_count,
+        transport::protobuf::RoutingMessage& message);
+
+}  // namespace bench
+
+}  // namespace gossip
+
+}  // namespace top
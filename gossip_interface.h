@@ -20,6 +20,8 @@ class Uint64BloomFilter;
 
 namespace gossip {
 
+class GossipStageTimer;
+
 class GossipInterface {
 public:
     virtual void Broadcast(
@@ -37,13 +39,20 @@ protected:
     virtual ~GossipInterface() {}
 
     uint64_t GetDistance(const std::string& src, const std::string& des);
+    // stage, when given, times the encode and transmit stages
     void Send(
             transport::protobuf::RoutingMessage& message,
-            const std::vector<kadmlia::NodeInfoPtr>& nodes);
+            const std::vector<kadmlia::NodeInfoPtr>& nodes,
+            GossipStageTimer* stage = nullptr);
     uint32_t GetNeighborCount(transport::protobuf::RoutingMessage& message);
     std::vector<kadmlia::NodeInfoPtr> GetRandomNodes(
             std::vector<kadmlia::NodeInfoPtr>& neighbors,
             uint32_t number_to_get) const;
+    // range of the message widened by its left and right overlap
+    void GetSelectRange(
+            transport::protobuf::RoutingMessage& message,
+            uint64_t& min_dis,
+            uint64_t& max_dis);
     void SelectNodes(
             transport::protobuf::RoutingMessage& message,
             const std::vector<kadmlia::NodeInfoPtr>& nodes,
@@ -55,7 +64,23 @@ protected:
             std::vector<kadmlia::NodeInfoPtr>& select_nodes);
     void SendLayered(
             transport::protobuf::RoutingMessage& message,
-            const std::vector<kadmlia::NodeInfoPtr>& nodes);
+            const std::vector<kadmlia::NodeInfoPtr>& nodes,
+            GossipStageTimer* stage = nullptr);
+    void SetLayeredRange(
+            transport::protobuf::RoutingMessage& message,
+            const std::vector<kadmlia::NodeInfoPtr>& nodes,
+            uint32_t i,
+            uint64_t min_dis,
+            uint64_t max_dis);
+    // for every suspect node in nodes, send to the nodes it would choose
+    // from its own range, min_dis and max_dis are the range nodes came from
+    void SendLayeredBypass(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table,
+            std::shared_ptr<base::Uint64BloomFilter>& bloomfilter,
+            const std::vector<kadmlia::NodeInfoPtr>& nodes,
+            uint64_t min_dis,
+            uint64_t max_dis);
     void CheckDiffNetwork(transport::protobuf::RoutingMessage& message);
 
     // TODO(Charlie): for test evil
@@ -0,0 +1,353 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_config.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/harness/cluster_node.h"
+#include "xgossip/tool/tool_utils.h"
+
+using top::gossip::harness::ClusterConfig;
+using top::gossip::harness::ClusterNodeStat;
+using top::gossip::harness::ClusterNode;
+using top::gossip::tool::GossipTypeName;
+using top::gossip::tool::GetArg;
+using top::gossip::tool::GetGossipTypes;
+using top::gossip::tool::PrintGossipTypeUsage;
+
+// one forked process per node, talking to the parent over a pipe pair with
+// one line per step: child "id", parent "peers", child "ready", parent "go",
+// child "stat"
+struct ChildProcess {
+    pid_t pid;
+    FILE* to_child;
+    FILE* from_child;
+};
+
+static void Usage() {
+    printf("xgossip_cluster [--nodes=32] [--type=0] [--origins=1] [--messages=100] [--rate=50]\n"
+           "                [--payload=1024] [--neighbors=3] [--base_port=30000] [--drain_ms=2000]\n"
+           "                [--verbose=0]\n");
+    PrintGossipTypeUsage();
+}
+
+static std::string HexEncode(const std::string& str) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(str.size() * 2);
+    for (auto iter = str.begin(); iter != str.end(); ++iter) {
+        hex.push_back(kHex[static_cast<uint8_t>(*iter) >> 4]);
+        hex.push_back(kHex[static_cast<uint8_t>(*iter) & 0x0f]);
+    }
+    return hex;
+}
+
+static std::string HexDecode(const std::string& hex) {
+    std::string str;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        str.push_back(static_cast<char>(strtoul(hex.substr(i, 2).c_str(), nullptr, 16)));
+    }
+    return str;
+}
+
+static bool ReadLine(FILE* file, std::string& line) {
+    char* buf = nullptr;
+    size_t len = 0;
+    ssize_t size = getline(&buf, &len, file);
+    if (size <= 0) {
+        free(buf);
+        return false;
+    }
+    line.assign(buf, size);
+    free(buf);
+    while (!line.empty() && line.back() == '\n') {
+        line.pop_back();
+    }
+    return true;
+}
+
+static void WriteLine(FILE* file, const std::string& line) {
+    fprintf(file, "%s\n", line.c_str());
+    fflush(file);
+}
+
+static int RunChild(const ClusterConfig& config, uint32_t index, FILE* from_parent, FILE* to_parent) {
+    ClusterNode node(config, index);
+    if (!node.Init()) {
+        WriteLine(to_parent, "fail");
+        return 1;
+    }
+    WriteLine(to_parent, "id " + HexEncode(node.node_id()));
+
+    std::string line;
+    if (!ReadLine(from_parent, line) || line.compare(0, 6, "peers ") != 0) {
+        return 1;
+    }
+    std::vector<std::string> node_ids;
+    std::istringstream peers(line.substr(6));
+    std::string hex;
+    while (peers >> hex) {
+        node_ids.push_back(HexDecode(hex));
+    }
+    if (!node.SetPeers(node_ids)) {
+        WriteLine(to_parent, "fail");
+        return 1;
+    }
+    WriteLine(to_parent, "ready");
+    if (!ReadLine(from_parent, line) || line != "go") {
+        return 1;
+    }
+
+    node.RunWorkload();
+    ClusterNodeStat stat;
+    node.GetStat(stat);
+    std::ostringstream out;
+    out << "stat " << stat.index << " " << stat.recv_count << " " << stat.first_count << " "
+        << stat.send_count << " " << stat.send_bytes << " " << stat.user_cpu_us << " "
+        << stat.sys_cpu_us << " " << stat.latency_us.size();
+    for (auto iter = stat.latency_us.begin(); iter != stat.latency_us.end(); ++iter) {
+        out << " " << *iter;
+    }
+    WriteLine(to_parent, out.str());
+    return 0;
+}
+
+static bool ParseStat(const std::string& line, ClusterNodeStat& stat) {
+    std::istringstream in(line);
+    std::string tag;
+    size_t latency_count = 0;
+    in >> tag >> stat.index >> stat.recv_count >> stat.first_count >> stat.send_count
+       >> stat.send_bytes >> stat.user_cpu_us >> stat.sys_cpu_us >> latency_count;
+    if (!in || tag != "stat") {
+        return false;
+    }
+    stat.latency_us.resize(latency_count);
+    for (size_t i = 0; i < latency_count; ++i) {
+        in >> stat.latency_us[i];
+    }
+    return static_cast<bool>(in);
+}
+
+static void StopChildren(std::vector<ChildProcess>& children, bool kill_children) {
+    for (auto iter = children.begin(); iter != children.end(); ++iter) {
+        if (kill_children) {
+            kill(iter->pid, SIGKILL);
+        }
+        fclose(iter->to_child);
+        fclose(iter->from_child);
+        waitpid(iter->pid, nullptr, 0);
+    }
+    children.clear();
+}
+
+static bool RunCluster(const ClusterConfig& config, std::vector<ClusterNodeStat>& stats) {
+    std::vector<ChildProcess> children;
+    for (uint32_t i = 0; i < config.node_count; ++i) {
+        int down[2];
+        int up[2];
+        if (pipe(down) != 0 || pipe(up) != 0) {
+            perror("pipe");
+            StopChildren(children, true);
+            return false;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            StopChildren(children, true);
+            return false;
+        }
+        if (pid == 0) {
+            close(down[1]);
+            close(up[0]);
+            for (auto iter = children.begin(); iter != children.end(); ++iter) {
+                fclose(iter->to_child);
+                fclose(iter->from_child);
+            }
+            FILE* from_parent = fdopen(down[0], "r");
+            FILE* to_parent = fdopen(up[1], "w");
+            _exit(RunChild(config, i, from_parent, to_parent));
+        }
+        close(down[0]);
+        close(up[1]);
+        children.push_back(ChildProcess{ pid, fdopen(down[1], "w"), fdopen(up[0], "r") });
+    }
+
+    std::string peers = "peers";
+    std::string line;
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        if (!ReadLine(children[i].from_child, line) || line.compare(0, 3, "id ") != 0) {
+            printf("node %u failed to start\n", i);
+            StopChildren(children, true);
+            return false;
+        }
+        peers += " " + line.substr(3);
+    }
+    for (auto iter = children.begin(); iter != children.end(); ++iter) {
+        WriteLine(iter->to_child, peers);
+    }
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        if (!ReadLine(children[i].from_child, line) || line != "ready") {
+            printf("node %u failed to join\n", i);
+            StopChildren(children, true);
+            return false;
+        }
+    }
+    for (auto iter = children.begin(); iter != children.end(); ++iter) {
+        WriteLine(iter->to_child, "go");
+    }
+
+    stats.clear();
+    for (uint32_t i = 0; i < children.size(); ++i) {
+        ClusterNodeStat stat;
+        if (!ReadLine(children[i].from_child, line) || !ParseStat(line, stat)) {
+            printf("node %u returned no stat\n", i);
+            StopChildren(children, true);
+            return false;
+        }
+        stats.push_back(stat);
+    }
+    StopChildren(children, false);
+    return true;
+}
+
+static uint64_t Percentile(const std::vector<uint64_t>& sorted, double rate) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(rate * (sorted.size() - 1));
+    return sorted[index];
+}
+
+static void PrintCluster(const ClusterConfig& config, const std::vector<ClusterNodeStat>& stats, bool verbose) {
+    uint64_t expect_count = static_cast<uint64_t>(std::min(config.origin_count, config.node_count)) *
+            config.message_count;
+    uint64_t recv_count = 0;
+    uint64_t first_count = 0;
+    uint64_t send_count = 0;
+    uint64_t cpu_us = 0;
+    std::vector<uint64_t> latency_us;
+    if (verbose) {
+        printf("  %5s %9s %9s %9s %11s %9s %9s %9s %9s\n",
+                "node", "recv", "first", "sent", "sent_bytes", "user_ms", "sys_ms", "p50_us", "p99_us");
+    }
+    for (auto iter = stats.begin(); iter != stats.end(); ++iter) {
+        std::vector<uint64_t> node_latency(iter->latency_us);
+        std::sort(node_latency.begin(), node_latency.end());
+        recv_count += iter->recv_count;
+        first_count += iter->first_count;
+        send_count += iter->send_count;
+        cpu_us += iter->user_cpu_us + iter->sys_cpu_us;
+        latency_us.insert(latency_us.end(), node_latency.begin(), node_latency.end());
+        if (verbose) {
+            printf("  %5u %9llu %9llu %9llu %11llu %9.1f %9.1f %9llu %9llu\n",
+                    iter->index,
+                    (unsigned long long)iter->recv_count,
+                    (unsigned long long)iter->first_count,
+                    (unsigned long long)iter->send_count,
+                    (unsigned long long)iter->send_bytes,
+                    iter->user_cpu_us / 1000.0,
+                    iter->sys_cpu_us / 1000.0,
+                    (unsigned long long)Percentile(node_latency, 0.5),
+                    (unsigned long long)Percentile(node_latency, 0.99));
+        }
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+
+    // origins do not receive their own messages
+    uint64_t need_count = expect_count * (config.node_count - 1);
+    printf("%-20s %9.4f %9.3f %11llu %9llu %9llu %9llu %11.1f\n",
+            GossipTypeName(config.gossip_type),
+            need_count > 0 ? static_cast<double>(first_count) / need_count : 0.0,
+            first_count > 0 ? static_cast<double>(recv_count) / first_count : 0.0,
+            (unsigned long long)send_count,
+            (unsigned long long)Percentile(latency_us, 0.5),
+            (unsigned long long)Percentile(latency_us, 0.99),
+            (unsigned long long)(latency_us.empty() ? 0 : latency_us.back()),
+            cpu_us / 1000.0);
+}
+
+int main(int argc, char *argv[]) {
+    ClusterConfig config;
+    config.node_count = 32;
+    config.gossip_type = 0;
+    config.origin_count = 1;
+    config.message_count = 100;
+    config.message_rate = 50;
+    config.payload_size = 1024;
+    config.neighbor_count = 3;
+    config.base_port = 30000;
+    config.drain_ms = 2000;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (GetArg(argv[i], "nodes", value)) {
+            config.node_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "type", value)) {
+            config.gossip_type = atoi(value.c_str());
+        } else if (GetArg(argv[i], "origins", value)) {
+            config.origin_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "messages", value)) {
+            config.message_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "rate", value)) {
+            config.message_rate = atoi(value.c_str());
+        } else if (GetArg(argv[i], "payload", value)) {
+            config.payload_size = atoi(value.c_str());
+        } else if (GetArg(argv[i], "neighbors", value)) {
+            config.neighbor_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "base_port", value)) {
+            config.base_port = atoi(value.c_str());
+        } else if (GetArg(argv[i], "drain_ms", value)) {
+            config.drain_ms = atoi(value.c_str());
+        } else if (GetArg(argv[i], "verbose", value)) {
+            verbose = (atoi(value.c_str()) != 0);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (config.node_count < 2 || config.node_count + config.base_port > 65535u) {
+        printf("nodes %u with base_port %u invalid\n", config.node_count, config.base_port);
+        return 1;
+    }
+
+    // children inherit log, config and global xid over fork
+    xinit_log("xgossip_cluster.log", true, true);
+    xset_log_level(enum_xlog_level_error);
+    top::base::Config top_config;
+    top_config.Init("./conf.ut/test_routing_table.conf");
+    top::kadmlia::CreateGlobalXid(top_config);
+
+    std::vector<uint32_t> gossip_types;
+    GetGossipTypes(config.gossip_type, gossip_types);
+
+    printf("nodes %u on 127.0.0.1:%u, origins %u, messages %u at %u/s, payload %u, neighbors %u\n",
+            config.node_count, config.base_port, config.origin_count, config.message_count,
+            config.message_rate, config.payload_size, config.neighbor_count);
+    printf("%-20s %9s %9s %11s %9s %9s %9s %11s\n",
+            "type", "coverage", "amplify", "sent_pkts", "p50_us", "p99_us", "max_us", "cpu_ms");
+    for (auto iter = gossip_types.begin(); iter != gossip_types.end(); ++iter) {
+        config.gossip_type = *iter;
+        std::vector<ClusterNodeStat> stats;
+        if (!RunCluster(config, stats)) {
+            printf("%-20s cluster failed\n", GossipTypeName(*iter));
+            return 1;
+        }
+        PrintCluster(config, stats, verbose);
+    }
+    return 0;
+}
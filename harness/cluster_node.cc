@@ -0,0 +1,213 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/harness/cluster_node.h"
+
+#include <string.h>
+#include <sys/resource.h>
+
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include "xbase/xhash.h"
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_utils.h"
+#include "xpbase/base/check_cast.h"
+#include "xpbase/base/kad_key/platform_kadmlia_key.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xwrouter/message_handler/wrouter_message_handler.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_filter.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace harness {
+
+// every message carries the steady clock time of its broadcast first, the
+// clock is system wide so receivers in other processes can take latency
+static const uint32_t kTimestampSize = sizeof(uint64_t);
+
+static uint64_t SteadyNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ClusterNode::ClusterNode(const ClusterConfig& config, uint32_t index)
+        : config_(config), index_(index) {}
+
+ClusterNode::~ClusterNode() {
+    if (transport_) {
+        transport_->Stop();
+    }
+}
+
+bool ClusterNode::Init() {
+    std::string idtype(kadmlia::GenNodeIdType("CN", "VPN"));
+    local_node_info_.reset(new kadmlia::LocalNodeInfo());
+    auto kad_key = std::make_shared<base::PlatformKadmliaKey>();
+    kad_key->set_xnetwork_id(kEdgeXVPN);
+    kad_key->set_zone_id(check_cast<uint8_t>(26));
+    uint16_t port = config_.base_port + index_;
+    if (!local_node_info_->Init(
+            "127.0.0.1", port, false, false, idtype, kad_key, kad_key->xnetwork_id(), kRoleEdge)) {
+        TOP_ERROR("cluster node(%u) local node info init failed", index_);
+        return false;
+    }
+    local_node_info_->set_public_ip("127.0.0.1");
+    local_node_info_->set_public_port(port);
+    node_id_ = local_node_info_->id();
+    hash64_ = base::xhash64_t::digest(node_id_);
+
+    thread_message_handler_ = std::make_shared<transport::MultiThreadHandler>();
+    thread_message_handler_->Init();
+    transport_ = std::make_shared<ClusterTransport>();
+    if (transport_->Start("127.0.0.1", port, thread_message_handler_.get()) != kadmlia::kKadSuccess) {
+        TOP_ERROR("cluster node(%u) udp transport start on port(%u) failed", index_, port);
+        return false;
+    }
+
+    routing_table_.reset(new kadmlia::RoutingTable(transport_, kadmlia::kNodeIdSize, local_node_info_));
+    neighbors_ = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>();
+    context_.local_hash64 = hash64_;
+    context_.neighbors = neighbors_;
+    context_.routing_table = routing_table_;
+    registry_ = std::make_shared<GossipRegistry>(transport_);
+    if (!registry_->Has(config_.gossip_type)) {
+        TOP_ERROR("cluster gossip type(%u) not supported", config_.gossip_type);
+        return false;
+    }
+
+    GossipFilter::Instance()->Init();
+    wrouter::WrouterRegisterMessageHandler(kTestChainTrade, [this](
+            transport::protobuf::RoutingMessage& message,
+            base::xpacket_t& packet) {
+        HandleMessage(message, packet);
+    });
+    return true;
+}
+
+bool ClusterNode::SetPeers(const std::vector<std::string>& node_ids) {
+    if (node_ids.size() != config_.node_count || node_ids[index_] != node_id_) {
+        TOP_ERROR("cluster node(%u) peers invalid, size(%u)", index_, (uint32_t)node_ids.size());
+        return false;
+    }
+    // full membership as in a shard network
+    for (uint32_t i = 0; i < node_ids.size(); ++i) {
+        if (i == index_) {
+            continue;
+        }
+        auto node_ptr = std::make_shared<kadmlia::NodeInfo>(node_ids[i]);
+        node_ptr->xid = node_ids[i];
+        node_ptr->local_ip = "127.0.0.1";
+        node_ptr->local_port = config_.base_port + i;
+        node_ptr->public_ip = "127.0.0.1";
+        node_ptr->public_port = config_.base_port + i;
+        node_ptr->hash64 = base::xhash64_t::digest(node_ids[i]);
+        routing_table_->AddNode(node_ptr);
+        neighbors_->push_back(node_ptr);
+    }
+    BroadcastLayered::OnMembershipChanged();
+    return true;
+}
+
+void ClusterNode::Forward(transport::protobuf::RoutingMessage& message) {
+    registry_->Broadcast(context_, message);
+}
+
+void ClusterNode::HandleMessage(
+        transport::protobuf::RoutingMessage& message,
+        base::xpacket_t& packet) {
+    ++recv_count_;
+    if (GossipFilter::Instance()->FilterMessage(
+            message,
+            packet.get_from_ip_addr(),
+            packet.get_from_ip_port())) {
+        return;
+    }
+    ++first_count_;
+    if (message.data().size() >= kTimestampSize) {
+        uint64_t send_us = 0;
+        memcpy(&send_us, message.data().data(), kTimestampSize);
+        uint64_t now_us = SteadyNowUs();
+        std::unique_lock<std::mutex> lock(latency_mutex_);
+        latency_us_.push_back(now_us > send_us ? now_us - send_us : 0);
+    }
+
+    // what wrouter does before handing the message to gossip
+    message.set_hop_num(message.hop_num() + 1);
+    message.mutable_gossip()->set_pre_ip(packet.get_from_ip_addr());
+    message.mutable_gossip()->set_pre_port(packet.get_from_ip_port());
+    Forward(message);
+}
+
+void ClusterNode::Broadcast(uint32_t message_index) {
+    uint64_t send_us = SteadyNowUs();
+    std::string data(reinterpret_cast<const char*>(&send_us), kTimestampSize);
+    data.append(config_.payload_size, 'd');
+
+    transport::protobuf::RoutingMessage message;
+    message.set_id(message_index);
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(0);
+    message.set_src_node_id(node_id_);
+    message.set_des_node_id(node_id_);
+    message.set_data(data);
+    auto gossip_param = message.mutable_gossip();
+    gossip_param->set_neighber_count(config_.neighbor_count);
+    gossip_param->set_stop_times(kGossipSendoutMaxTimes);
+    gossip_param->set_gossip_type(config_.gossip_type);
+    gossip_param->set_max_hop_num(kadmlia::kHopToLive);
+    gossip_param->set_evil_rate(0);
+    gossip_param->set_switch_layer_hop_num(kGossipSwitchLayerCount);
+    gossip_param->set_ign_bloomfilter_level(kGossipBloomfilterIgnoreLevel);
+    gossip_param->set_msg_hash(base::xhash32_t::digest(
+            std::to_string(index_) + ":" + std::to_string(message_index)));
+    gossip_param->set_min_dis(0);
+    gossip_param->set_max_dis(0);
+    gossip_param->set_left_min(0);
+    gossip_param->set_right_max(std::numeric_limits<uint64_t>::max());
+
+    // copies coming back are duplicates, not first receipts
+    GossipFilter::Instance()->FilterMessage(message);
+    Forward(message);
+}
+
+void ClusterNode::RunWorkload() {
+    if (index_ < config_.origin_count && config_.message_count > 0) {
+        auto interval = std::chrono::microseconds(
+                config_.message_rate > 0 ? 1000000 / config_.message_rate : 0);
+        auto next_time = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < config_.message_count; ++i) {
+            std::this_thread::sleep_until(next_time);
+            Broadcast(i);
+            next_time += interval;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(config_.drain_ms));
+}
+
+void ClusterNode::GetStat(ClusterNodeStat& stat) {
+    stat.index = index_;
+    stat.recv_count = recv_count_;
+    stat.first_count = first_count_;
+    stat.send_count = transport_->send_count();
+    stat.send_bytes = transport_->send_bytes();
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+    stat.user_cpu_us = usage.ru_utime.tv_sec * 1000000ull + usage.ru_utime.tv_usec;
+    stat.sys_cpu_us = usage.ru_stime.tv_sec * 1000000ull + usage.ru_stime.tv_usec;
+    std::unique_lock<std::mutex> lock(latency_mutex_);
+    stat.latency_us = latency_us_;
+}
+
+}  // namespace harness
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,118 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xbase/xpacket.h"
+#include "xtransport/proto/transport.pb.h"
+#include "xtransport/udp_transport/udp_transport.h"
+#include "xtransport/message_manager/multi_message_handler.h"
+#include "xkad/routing_table/local_node_info.h"
+#include "xkad/routing_table/node_info.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xgossip/include/gossip_registry.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace harness {
+
+struct ClusterConfig {
+    uint32_t node_count;
+    uint32_t gossip_type;  // GossipType
+    uint32_t origin_count;  // nodes 0 .. origin_count - 1 broadcast
+    uint32_t message_count;  // per origin
+    uint32_t message_rate;  // per origin per second
+    uint32_t payload_size;
+    uint32_t neighbor_count;
+    uint16_t base_port;  // node i listens on 127.0.0.1:base_port + i
+    uint32_t drain_ms;  // wait after the last broadcast before stats are taken
+};
+
+struct ClusterNodeStat {
+    uint32_t index;
+    uint64_t recv_count;  // every copy
+    uint64_t first_count;  // distinct messages
+    uint64_t send_count;
+    uint64_t send_bytes;
+    uint64_t user_cpu_us;
+    uint64_t sys_cpu_us;
+    // broadcast to first receipt, one sample per distinct message
+    std::vector<uint64_t> latency_us;
+};
+
+// UdpTransport that counts what the gossip classes send
+class ClusterTransport : public transport::UdpTransport {
+public:
+    ClusterTransport() {}
+    virtual ~ClusterTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override {
+        ++send_count_;
+        send_bytes_ += packet.get_body().size();
+        return transport::UdpTransport::SendData(packet);
+    }
+    uint64_t send_count() const { return send_count_; }
+    uint64_t send_bytes() const { return send_bytes_; }
+
+private:
+    std::atomic<uint64_t> send_count_{ 0 };
+    std::atomic<uint64_t> send_bytes_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(ClusterTransport);
+};
+
+// One xgossip node of the loopback cluster, one per process so the gossip
+// singletons, GossipFilter and the wrouter handlers are its own. Messages
+// come in through the real UDP transport and MultiThreadHandler, are
+// filtered by GossipFilter and forwarded with the configured gossip type.
+class ClusterNode {
+public:
+    ClusterNode(const ClusterConfig& config, uint32_t index);
+    ~ClusterNode();
+    bool Init();
+    const std::string& node_id() const { return node_id_; }
+    // node ids of the whole cluster by index, fills the routing table
+    bool SetPeers(const std::vector<std::string>& node_ids);
+    // broadcasts if this node is an origin, then waits drain_ms
+    void RunWorkload();
+    void GetStat(ClusterNodeStat& stat);
+
+private:
+    void HandleMessage(transport::protobuf::RoutingMessage& message, base::xpacket_t& packet);
+    void Forward(transport::protobuf::RoutingMessage& message);
+    void Broadcast(uint32_t message_index);
+
+    ClusterConfig config_;
+    uint32_t index_;
+    std::string node_id_;
+    uint64_t hash64_{ 0 };
+    kadmlia::LocalNodeInfoPtr local_node_info_;
+    std::shared_ptr<ClusterTransport> transport_;
+    std::shared_ptr<transport::MultiThreadHandler> thread_message_handler_;
+    kadmlia::RoutingTablePtr routing_table_;
+    std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors_;
+    GossipContext context_;
+    std::shared_ptr<GossipRegistry> registry_;
+    std::atomic<uint64_t> recv_count_{ 0 };
+    std::atomic<uint64_t> first_count_{ 0 };
+    std::vector<uint64_t> latency_us_;
+    std::mutex latency_mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClusterNode);
+};
+
+}  // namespace harness
+
+}  // namespace gossip
+
+}  // namespace top
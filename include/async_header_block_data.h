@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xgossip/include/header_block_data.h"
+
+namespace top {
+
+namespace gossip {
+
+// Runs HeaderBlockData calls on worker threads, so a slow ledger does not
+// stall the thread that received the packet. Reads and posted tasks go to
+// thread_count readers, writes to one writer of their own, so a burst of
+// broadcast writes does not delay sync reads. Each queue sheds once its
+// backlog is full.
+class AsyncHeaderBlockData {
+public:
+    typedef std::function<void(bool found, const std::string& block)> GetCallback;
+    typedef std::function<void()> Task;
+
+    AsyncHeaderBlockData(
+            std::shared_ptr<HeaderBlockData> header_block_data,
+            uint32_t thread_count,
+            uint32_t max_read_backlog,
+            uint32_t max_write_backlog);
+    ~AsyncHeaderBlockData();
+    // false when shed, callback is then never called
+    bool AsyncGetData(const std::string& header_hash, GetCallback callback);
+    // false when shed, callback may be null, runs after the block is stored
+    bool AsyncAddData(const std::string& header_hash, const std::string& block, Task callback);
+    // false when shed
+    bool Post(Task task);
+    std::shared_ptr<HeaderBlockData> header_block_data() { return header_block_data_; }
+    uint32_t read_backlog();
+    uint32_t write_backlog();
+    uint64_t shed_count() const { return read_queue_.shed_count + write_queue_.shed_count; }
+
+private:
+    struct TaskQueue {
+        explicit TaskQueue(uint32_t max) : max_backlog(max) {}
+        const uint32_t max_backlog;
+        std::deque<Task> tasks;
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool stop{ false };
+        std::atomic<uint64_t> shed_count{ 0 };
+    };
+
+    static bool Push(TaskQueue& queue, Task task);
+    static uint32_t Backlog(TaskQueue& queue);
+    static void Stop(TaskQueue& queue);
+    static void WorkerLoop(TaskQueue& queue);
+
+    std::shared_ptr<HeaderBlockData> header_block_data_;
+    TaskQueue read_queue_;
+    TaskQueue write_queue_;
+    std::vector<std::thread> threads_;
+
+    DISALLOW_COPY_AND_ASSIGN(AsyncHeaderBlockData);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+// One append only segment of BlockLogStore. Entries are written once and
+// never moved, so a reader holding the segment can use the bytes in place.
+class BlockLogSegment {
+public:
+    // path empty keeps the segment in memory, else it is a mmap'd file
+    BlockLogSegment(
+            uint64_t id,
+            uint32_t capacity,
+            const std::string& path,
+            std::chrono::steady_clock::time_point seal_time,
+            std::chrono::steady_clock::time_point expire_time);
+    ~BlockLogSegment();
+    // false when the entry does not fit, value_offset is where the value starts
+    bool Append(const std::string& key, const char* data, uint32_t size, uint32_t& value_offset);
+    const char* At(uint32_t offset) const { return base_ + offset; }
+    uint64_t id() const { return id_; }
+    uint32_t used() const { return used_; }
+    bool mapped() const { return fd_ >= 0; }
+    std::chrono::steady_clock::time_point seal_time() const { return seal_time_; }
+    std::chrono::steady_clock::time_point expire_time() const { return expire_time_; }
+    const std::vector<std::string>& keys() const { return keys_; }
+
+private:
+    uint64_t id_;
+    uint32_t capacity_;
+    uint32_t used_{ 0 };
+    char* base_{ nullptr };
+    int fd_{ -1 };
+    std::string path_;
+    std::vector<char> memory_;
+    std::chrono::steady_clock::time_point seal_time_;
+    std::chrono::steady_clock::time_point expire_time_;
+    std::vector<std::string> keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(BlockLogSegment);
+};
+
+typedef std::shared_ptr<BlockLogSegment> BlockLogSegmentPtr;
+
+// bytes of one entry, valid while segment is held. Bytes that live outside
+// a segment, a block read from the ledger, are held by buffer instead.
+// expire_time is when the store stops serving the entry
+struct BlockLogView {
+    BlockLogSegmentPtr segment;
+    std::shared_ptr<const std::string> buffer;
+    const char* data{ nullptr };
+    uint32_t size{ 0 };
+    std::chrono::steady_clock::time_point expire_time{ std::chrono::steady_clock::time_point::max() };
+
+    std::string ToString() const { return std::string(data, size); }
+};
+
+// Log structured store for short lived gossip payloads. Writes append to the
+// active segment. A segment takes writes for ttl / 4 and is dropped as a
+// whole once ttl passed after that, so an entry lives between ttl and
+// 1.25 * ttl. Remove only drops the index entry, nothing is deleted in place.
+class BlockLogStore {
+public:
+    // dir empty keeps segments in memory, else each segment is a file in dir
+    BlockLogStore(const std::string& dir, uint32_t segment_size, uint32_t ttl_ms);
+    ~BlockLogStore();
+    void Put(const std::string& key, const std::string& value);
+    bool Get(const std::string& key, BlockLogView& view);
+    bool Has(const std::string& key);
+    void Remove(const std::string& key);
+    void DropExpired();
+    void GetStat(uint32_t& segment_count, uint32_t& entry_count, uint64_t& bytes);
+
+private:
+    struct Location {
+        uint64_t segment_id;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    BlockLogSegmentPtr NewSegment(uint32_t capacity, std::chrono::steady_clock::time_point tp_now);
+    void DropExpiredLocked(std::chrono::steady_clock::time_point tp_now);
+    BlockLogSegmentPtr FindSegment(uint64_t segment_id);
+
+    std::string dir_;
+    uint32_t segment_size_;
+    std::chrono::milliseconds ttl_;
+    std::chrono::milliseconds seal_period_;
+    uint64_t next_segment_id_{ 0 };
+    // oldest first, the back one takes writes
+    std::deque<BlockLogSegmentPtr> segments_;
+    std::unordered_map<std::string, Location> index_map_;
+    std::mutex mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(BlockLogStore);
+};
+
+}  // namespace gossip
+
+}  // namespace top
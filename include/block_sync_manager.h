@@ -5,13 +5,20 @@
 #pragma once
 
 #include <queue>
-#include <set>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "xbase/xpacket.h"
 #include "xtransport/proto/transport.pb.h"
 #include "xpbase/base/top_timer.h"
+#include "xgossip/include/async_header_block_data.h"
 #include "xgossip/include/header_block_data.h"
+#include "xgossip/include/lock_wait_mutex.h"
+#include "xgossip/include/sync_admission.h"
+#include "xgossip/include/sync_message_codec.h"
+#include "xgossip/include/sync_response_cache.h"
 #include "xtransport/message_manager/message_manager_intf.h"
 
 namespace top {
@@ -25,31 +32,173 @@ typedef std::shared_ptr<RoutingTable> RoutingTablePtr;
 
 namespace gossip {
 
-struct SyncBlockItem {
-    uint64_t routing_service_type;
+// xhash64 of the header hash, the key of the sync table
+typedef uint64_t SyncHeaderKey;
+
+enum SyncHeaderState {
+    kSyncHeaderAnnounced = 0,  // header seen without block, not asked yet
+    kSyncHeaderAsking,  // asks sent, waiting for an ack
+    kSyncHeaderRequested,  // request sent to an acker, waiting for the block
+    kSyncHeaderFetched,  // block stored, kept a while to drop late responses
+};
+
+// a neighbor that announced the header or acked (has) the block
+struct SyncSource {
+    std::string ip;
+    uint16_t port;
+    std::string node_id;  // empty until it acked
+    bool acked;
+    bool requested;
+};
+
+enum SyncChunkState {
+    kSyncChunkMissing = 0,
+    kSyncChunkInFlight,
+    kSyncChunkDone,
+};
+
+// a block pulled in chunks after a holder answered the request with a manifest
+struct SyncChunkTransfer {
+    SyncChunkManifest manifest;
+    // verified chunks, kept apart until the last one arrives so that memory
+    // follows the bytes received, not the size a manifest claims
+    std::vector<std::string> chunks;
+    std::vector<uint8_t> chunk_states;
+    std::vector<std::chrono::steady_clock::time_point> chunk_deadlines;
+    // index in holders the chunk was requested from
+    std::vector<uint32_t> chunk_holders;
+    // holders that sent the same manifest, chunks are pulled from all of them
+    std::vector<SyncSource> holders;
+    uint32_t next_holder;
+    uint32_t done_count;
+};
+
+struct SyncHeaderRecord {
     std::string header_hash;
+    uint64_t routing_service_type;
+    SyncHeaderState state;
+    uint32_t retry_count;
+    // requests out in this round, 2 once hedged to a second acker
+    uint32_t request_count;
+    std::chrono::steady_clock::time_point request_time;
+    // the record is dropped after expire_time
+    std::chrono::steady_clock::time_point expire_time;
+    // next ask or request timeout, the one in deadline_queue that belongs to this record
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<SyncSource> sources;
+    // set once a manifest arrived, the hedge and re-ask wait while chunks flow
+    std::shared_ptr<SyncChunkTransfer> transfer;
+};
+
+// next time a record has to be looked at
+struct SyncDeadline {
     std::chrono::steady_clock::time_point time_point;
+    SyncHeaderKey key;
+
+    bool operator>(const SyncDeadline& other) const {
+        return time_point > other.time_point;
+    }
+};
+
+enum SyncActionType {
+    kSyncActionAsk = 0,  // ask neighbors, announcers in sources first
+    kSyncActionRequest,  // request header_hashes from sources.front()
+    kSyncActionChunk,  // request chunk_indexes from sources.front()
+};
+
+// work found under a shard lock, done after it is released
+struct SyncAction {
+    SyncActionType type;
+    std::vector<std::string> header_hashes;
+    uint64_t service_type;
+    std::vector<SyncSource> sources;
+    std::vector<uint32_t> chunk_indexes;
+};
+
+struct SyncHeaderShard {
+    LockWaitMutex mutex;
+    std::unordered_map<SyncHeaderKey, SyncHeaderRecord> header_map;
+    // one live entry per record, earliest first, stale entries are skipped
+    std::priority_queue<
+            SyncDeadline,
+            std::vector<SyncDeadline>,
+            std::greater<SyncDeadline>> deadline_queue;
 };
 
 class BlockSyncManager {
 public:
     static BlockSyncManager* Instance();
     void SetLeagerFace(std::shared_ptr<top::ledger::xledger_face_t> ledger_face);
+    // keep synced blocks in block_store instead of the ledger
+    void SetBlockLogStore(std::shared_ptr<BlockLogStore> block_store);
     void SetRoutingTablePtr(kadmlia::RoutingTablePtr& routing_table);
     void NewBroadcastMessage(transport::protobuf::RoutingMessage& message);
+    // drops a stored block and the response cached for it
+    void RemoveBlock(const std::string& header_hash);
+    // waits on the sync table shard locks
+    void GetLockWaitStat(LockWaitStat& stat);
 
 private:
+    static const uint32_t kSyncShardCount = 16u;
+    static const uint64_t kSyncResponseCacheSize = 32ull * 1024ull * 1024ull;
+    // upload budget of sync serving in bytes per second, bursts are twice that
+    static const uint64_t kSyncServeRate = 16ull * 1024ull * 1024ull;
+    static const uint64_t kSyncRequesterServeRate = 2ull * 1024ull * 1024ull;
+    static const uint32_t kMaxEnvelopePeerCount = 4096u;
+    // expired blocks and responses are released every this many header checks
+    static const uint32_t kExpireCheckCount = 10u;
+
     BlockSyncManager();
     ~BlockSyncManager();
 
-    bool HeaderHashExists(const std::string& header_hash);
-    uint32_t GetBlockMsgType(const std::string& header_hash);
+    SyncHeaderKey GetHeaderKey(const std::string& header_hash);
+    SyncHeaderShard& GetShard(SyncHeaderKey key);
+    void SetDeadline(
+            SyncHeaderShard& shard,
+            SyncHeaderKey key,
+            SyncHeaderRecord& record,
+            std::chrono::steady_clock::time_point time_point);
     void AddHeaderHashToQueue(
             const std::string& header_hash,
-            uint64_t service_type);
+            uint64_t service_type,
+            const std::string& announcer_ip,
+            uint16_t announcer_port);
+    SyncSource* FindSource(SyncHeaderRecord& record, const std::string& ip, uint16_t port);
+    std::chrono::microseconds HedgeTimeout();
+    void UpdateResponseTime(std::chrono::microseconds response_time);
     void CheckHeaderHashQueue();
+    void CheckShard(
+            SyncHeaderShard& shard,
+            std::chrono::steady_clock::time_point tp_now,
+            std::chrono::steady_clock::duration chunk_timeout,
+            std::vector<SyncAction>& actions,
+            std::vector<SyncSource>& timeout_sources);
+    std::chrono::steady_clock::time_point PullChunks(
+            SyncHeaderRecord& record,
+            std::chrono::steady_clock::time_point tp_now,
+            std::chrono::steady_clock::duration chunk_timeout,
+            std::vector<SyncAction>& actions);
+    void SendSyncAction(const SyncAction& action);
     uint64_t GetRoutingServiceType(const std::string& des_node_id);
-    void SendSyncAsk(std::shared_ptr<SyncBlockItem>& sync_item);
+    void SendSyncAsk(
+            const std::vector<std::string>& header_hashes,
+            uint64_t service_type,
+            const std::vector<SyncSource>& announcers);
+    void SendSyncRequest(
+            const std::vector<std::string>& header_hashes,
+            uint64_t service_type,
+            const SyncSource& source);
+    void SendSyncHeaders(
+            kadmlia::RoutingTablePtr& routing,
+            uint32_t message_type,
+            uint64_t service_type,
+            const std::string& des_node_id,
+            const std::string& ip,
+            uint16_t port,
+            const std::vector<std::string>& header_hashes);
+    // peers that sent a sync envelope, the others may run the old protocol
+    void AddEnvelopePeer(const std::string& ip, uint16_t port);
+    bool IsEnvelopePeer(const std::string& ip, uint16_t port);
     void HandleSyncAsk(
             transport::protobuf::RoutingMessage& message,
             base::xpacket_t& packet);
@@ -62,16 +211,72 @@ private:
     void HandleSyncResponse(
             transport::protobuf::RoutingMessage& message,
             base::xpacket_t& packet);
-    bool HeaderRequested(const std::string& header_hash);
+    bool AckHeader(
+            const std::string& header_hash,
+            const SyncSource& acker_source,
+            std::chrono::steady_clock::time_point tp_now,
+            std::chrono::steady_clock::duration hedge_timeout,
+            uint64_t& service_type);
+    void HandleSyncBlock(const transport::protobuf::GossipSyncBlockData& gossip_data);
+    void HandleSyncManifest(const SyncChunkManifest& manifest, const SyncSource& holder);
+    void HandleSyncChunk(const SyncChunk& chunk);
+    void HandleSyncBusy(const std::vector<SyncRedirect>& redirects, const SyncSource& busy_source);
+    bool RedirectHeader(
+            const SyncRedirect& redirect,
+            const SyncSource& busy_source,
+            std::chrono::steady_clock::time_point tp_now,
+            std::chrono::steady_clock::duration hedge_timeout,
+            uint64_t& service_type,
+            SyncSource& next_source);
+    void ServeSyncRequest(
+            transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port);
+    void ServeSyncChunkRequest(
+            transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port);
+    void StoreSyncBlock(
+            const std::string& header_hash,
+            const std::string& block,
+            transport::protobuf::RoutingMessage& sync_message);
+    SyncResponseEntryPtr GetSyncResponse(const std::string& header_hash);
+    void SendSyncResponse(
+            transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port,
+            kadmlia::RoutingTablePtr& routing,
+            const std::string& data);
+    void SendSyncBusy(
+            transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port,
+            kadmlia::RoutingTablePtr& routing,
+            uint32_t message_type,
+            const std::vector<std::string>& header_hashes);
     void RemoveHeaderBlock(const std::string& header_hash);
     bool DataExists(const std::string& header_hash);
 
-    std::map<std::string, std::shared_ptr<SyncBlockItem>> block_map_;
-    std::mutex block_map_mutex_;
+    SyncHeaderShard header_shards_[kSyncShardCount];
+    // smoothed request to response time and its variation, 0 before the first sample
+    uint64_t srtt_us_{ 0 };
+    uint64_t rttvar_us_{ 0 };
+    std::mutex rtt_mutex_;
+    // ip:port of envelope peers, cleared when it grows past kMaxEnvelopePeerCount
+    std::unordered_set<std::string> envelope_peers_;
+    std::mutex envelope_peers_mutex_;
+    // encoded responses of popular blocks, hits skip the ledger and protobuf
+    SyncResponseCache response_cache_{ kSyncResponseCacheSize };
+    SyncAdmission admission_{
+            kSyncServeRate,
+            2 * kSyncServeRate,
+            kSyncRequesterServeRate,
+            2 * kSyncRequesterServeRate };
     base::TimerRepeated timer_{base::TimerManager::Instance(), "BlockSyncManager"};
-    std::map<std::string, std::chrono::steady_clock::time_point> requested_headers_;
-    std::mutex requested_headers_mutex_;
+    uint32_t check_count_{ 0 };  // only touched by timer_
     std::shared_ptr<HeaderBlockData> header_block_data_{ nullptr };
+    // serves requests and stores blocks off the receiving thread
+    std::shared_ptr<AsyncHeaderBlockData> async_header_block_data_{ nullptr };
     kadmlia::RoutingTablePtr routing_table_;
     transport::MessageManagerIntf* message_manager_{transport::MessageManagerIntf::Instance()};
 
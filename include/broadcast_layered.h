@@ -4,11 +4,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "xtransport/transport.h"
 #include "xkad/routing_table/node_info.h"
-#include "xgossip/gossip_interface.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/gossip_policies.h"
+#include "xgossip/include/layered_tree_index.h"
+#include "xgossip/include/neighbor_liveness.h"
 
 namespace top {
 
@@ -19,37 +25,179 @@ typedef std::shared_ptr<RoutingTable> RoutingTablePtr;
 
 namespace gossip {
 
-class BroadcastLayered : public GossipInterface {
+// one relay's next hop nodes for a (membership, random_step) pair,
+// identical for every message that shares them. The membership epoch moves
+// on every routing table add or drop, see OnMembershipChanged, the local
+// hash64 keeps the plans of two tables in one process apart.
+struct LayeredPlanKey {
+    uint64_t local_hash64;
+    uint64_t membership_epoch;
+    uint64_t capacity_version;
+    uint32_t nodes_size;
+    uint32_t random_step;
+    uint32_t neighber_count;
+    bool first_hop;
+
+    bool operator==(const LayeredPlanKey& other) const {
+        return local_hash64 == other.local_hash64 &&
+                membership_epoch == other.membership_epoch &&
+                capacity_version == other.capacity_version &&
+                nodes_size == other.nodes_size &&
+                random_step == other.random_step &&
+                neighber_count == other.neighber_count &&
+                first_hop == other.first_hop;
+    }
+};
+
+struct LayeredPlanKeyHash {
+    size_t operator()(const LayeredPlanKey& key) const {
+        uint64_t hash = key.local_hash64;
+        hash = hash * 31 + key.membership_epoch;
+        hash = hash * 31 + key.capacity_version;
+        hash = hash * 31 + key.nodes_size;
+        hash = hash * 31 + key.random_step;
+        hash = hash * 31 + key.neighber_count;
+        hash = hash * 31 + (key.first_hop ? 1 : 0);
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+struct LayeredPlan {
+    std::vector<kadmlia::NodeInfoPtr> nodes;
+    // bypass_nodes[i] are the children of nodes[i], sent to when it is suspect
+    std::vector<std::vector<kadmlia::NodeInfoPtr>> bypass_nodes;
+};
+typedef std::shared_ptr<const LayeredPlan> LayeredPlanPtr;
+
+enum LayeredTreeMode {
+    // tree position follows the routing table sort order
+    kLayeredTreeSorted = 0,
+    // high upload capacity nodes take the interior levels, see NodeCapacityManager
+    kLayeredTreeCapacity = 1,
+};
+
+// stop: hop to live, evil node
+struct GossipLayeredStop {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        auto& message = pass.message;
+        if (message.hop_num() >= kadmlia::kHopToLive) {
+            TOP_WARN2("message hop_num(%d) beyond max_hop", message.hop_num());
+            pass.trace.set_outcome(kGossipTraceHopLimit);
+            return false;
+        }
+
+        if (engine.ThisNodeIsEvil(message)) {
+            TOP_WARN2("this node(%s) is evil", HexEncode(global_xid->Get()).c_str());
+            return false;
+        }
+        BlockSyncManager::Instance()->NewBroadcastMessage(message);
+        return true;
+    }
+};
+
+// select: children of this node in the cached tree plan, no filter to
+// carry on as the plan fixes them
+struct GossipLayeredPlanSelect {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        if (!pass.context.routing_table) {
+            TOP_WARN2("layered broadcast without routing table, msg.type(%d)", pass.message.type());
+            pass.trace.set_outcome(kGossipTraceNoNeighbor);
+            return false;
+        }
+        kadmlia::RoutingTablePtr routing_table = pass.context.routing_table;
+        pass.plan = engine.GetBroadcastPlan(pass.message, routing_table);
+        if (!pass.plan) {
+            pass.trace.set_outcome(kGossipTraceNoNeighbor);
+            return false;
+        }
+        return true;
+    }
+};
+
+// send: the children, and the children of a suspect child whose subtree
+// would be lost
+struct GossipLayeredPlanSend {
+    template <class Engine>
+    static uint32_t Run(Engine& engine, GossipPass& pass) {
+        auto& plan = *pass.plan;
+        engine.Send(pass.message, plan.nodes, &pass.stage);
+        if (!NeighborLiveness::Instance()->HasSuspect()) {
+            return plan.nodes.size();
+        }
+
+        std::vector<kadmlia::NodeInfoPtr> bypass_nodes;
+        for (uint32_t i = 0; i < plan.nodes.size(); ++i) {
+            auto& node = plan.nodes[i];
+            if (NeighborLiveness::Instance()->IsSuspect(node->public_ip, node->public_port)) {
+                bypass_nodes.insert(
+                        bypass_nodes.end(),
+                        plan.bypass_nodes[i].begin(),
+                        plan.bypass_nodes[i].end());
+            }
+        }
+        if (!bypass_nodes.empty()) {
+            TOP_DEBUG("layered broadcast bypass suspect children, %u more nodes",
+                    static_cast<uint32_t>(bypass_nodes.size()));
+            engine.Send(pass.message, bypass_nodes, &pass.stage);
+        }
+        return plan.nodes.size() + bypass_nodes.size();
+    }
+};
+
+class BroadcastLayered;
+typedef GossipEngine<
+        BroadcastLayered,
+        GossipLayeredStop,
+        GossipLayeredPlanSelect,
+        GossipNoFilterUpdate,
+        GossipLayeredPlanSend> BroadcastLayeredEngine;
+
+// kGossipLayeredBroadcast and kGossipLayeredCapacity: a tree over the
+// routing table, rotated by message id
+class BroadcastLayered : public BroadcastLayeredEngine {
 public:
-    explicit BroadcastLayered(transport::TransportPtr transport_ptr);
+    explicit BroadcastLayered(
+            transport::TransportPtr transport_ptr,
+            LayeredTreeMode tree_mode = kLayeredTreeSorted);
     virtual ~BroadcastLayered();
-    virtual void Broadcast(
-            uint64_t local_hash64,
-            transport::protobuf::RoutingMessage& message,
-            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors) { return; }
 
-    virtual void Broadcast(
-            transport::protobuf::RoutingMessage& message,
-            kadmlia::RoutingTablePtr& routing_table);
+    // every routing table add or drop calls this, plans cached under the
+    // old membership are not used again
+    static void OnMembershipChanged();
+    static uint64_t membership_epoch() { return membership_epoch_.load(std::memory_order_acquire); }
+    // drops every cached plan of this instance
+    void OnRoutingTableChanged();
+    void GetPlanCacheStat(uint64_t& hit_count, uint64_t& miss_count) const;
 
 private:
-    void GetNextBroadcastNodes(
+    friend struct GossipLayeredPlanSelect;
+
+    LayeredPlanPtr GetBroadcastPlan(
             transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table);
+    bool GetNextBroadcastNodes(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table,
+            LayeredPlan& plan);
+    bool GetCapacityBroadcastNodes(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table,
+            const std::vector<kadmlia::NodeInfoPtr>& members,
+            LayeredPlan& plan);
+    void AddPlanChildren(
             kadmlia::RoutingTablePtr& routing_table,
-            std::vector<kadmlia::NodeInfoPtr>& broadcast_nodes);
+            const LayeredRange& range,
+            uint32_t random_step,
+            uint32_t nodes_size,
+            uint32_t neighber_count,
+            LayeredPlan& plan);
+
+protected:
     int32_t FindSelfSortIndex(
             transport::protobuf::RoutingMessage& message,
             kadmlia::RoutingTablePtr& routing_table);
-    std::vector<uint32_t> choose_nodes(
-            int hop_num,
-            uint32_t self_sort_index,
-            uint32_t neighber_count,
-            const std::vector<uint32_t>& sort_nodes_index_vec);
-    uint32_t find_hop_num(uint32_t self_sort_index, uint32_t neighber_count);
-    std::vector<uint32_t> choose_next_nodes(
-            uint32_t count,
-            uint32_t self_node_index,
-            uint32_t neighber_count);
     uint32_t FindLogicalSelfIndex(
             uint32_t real_self_index,
             uint32_t random_step,
@@ -63,7 +211,19 @@ private:
             const uint32_t& min_index,
             const uint32_t& max_index,
             std::vector<kadmlia::NodeInfoPtr>& vec);
- 
+
+private:
+    static const uint32_t kMaxPlanCacheSize = 4096u;
+
+    LayeredTreeMode tree_mode_;
+
+    static std::atomic<uint64_t> membership_epoch_;
+
+    std::unordered_map<LayeredPlanKey, LayeredPlanPtr, LayeredPlanKeyHash> plan_map_;
+    uint64_t plan_map_epoch_{ 0 };  // newest epoch in plan_map_
+    std::mutex plan_map_mutex_;
+    std::atomic<uint64_t> plan_hit_count_{0};
+    std::atomic<uint64_t> plan_miss_count_{0};
 
 };
 
@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xgossip/include/broadcast_layered.h"
+
+namespace top {
+
+namespace gossip {
+
+#pragma pack(push, 1)
+// prefix of message.data() of every stripe message
+struct StripeHeader {
+    uint32_t magic;
+    uint32_t msg_hash;       // gossip msg_hash of the whole message
+    uint16_t stripe_index;   // also the tree the stripe travels down
+    uint16_t stripe_count;
+    uint32_t total_size;     // size of the whole message.data()
+};
+#pragma pack(pop)
+
+struct StripeItem {
+    uint32_t stripe_count;
+    uint32_t total_size;
+    uint32_t received;
+    bool delivered;
+    std::vector<std::string> stripes;
+    std::vector<bool> arrived;  // a stripe of an empty message is empty too
+    std::chrono::steady_clock::time_point create_time;
+};
+
+// SplitStream like broadcast: the originator cuts message.data() into K
+// stripes and sends stripe t down tree t (see striped_tree_index.h). Every
+// node forwards in one tree only, so upload is spread over all nodes instead
+// of the 1/K interior nodes of a single layered tree.
+class BroadcastStriped : public BroadcastLayered {
+public:
+    explicit BroadcastStriped(transport::TransportPtr transport_ptr);
+    virtual ~BroadcastStriped();
+    virtual void Broadcast(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table);
+
+    static std::string EncodeStripe(const StripeHeader& header, const std::string& stripe);
+    static bool DecodeStripe(const std::string& data, StripeHeader& header, std::string& stripe);
+
+private:
+    void SendStripes(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table);
+    bool GetStripeNodes(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table,
+            uint32_t tree_index,
+            std::vector<kadmlia::NodeInfoPtr>& stripe_nodes);
+    // true when stripe completes the message, its whole data in data
+    bool AddStripe(const StripeHeader& header, std::string& stripe, std::string& data);
+    void DropOldStripesLocked(std::chrono::steady_clock::time_point tp_now);
+    uint32_t GetStripeMessageHash(uint32_t msg_hash, uint32_t stripe_index);
+
+    static const uint32_t kStripeMagic = 0x53545250u;  // "PRTS"
+    static const uint32_t kMinStripeSize = 16u * 1024u;
+    static const uint32_t kMaxStripeMapSize = 4096u;
+    static const uint32_t kStripeTimeoutSec = 30u;
+
+    std::unordered_map<uint32_t, std::shared_ptr<StripeItem>> stripe_map_;
+    std::mutex stripe_map_mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(BroadcastStriped);
+};
+
+}  // namespace gossip
+
+}  // namespace top
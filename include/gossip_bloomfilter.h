@@ -5,20 +5,25 @@
 #pragma once
 
 #include "xtransport/transport.h"
-#include "xgossip/gossip_interface.h"
+#include "xgossip/include/gossip_policies.h"
 
 namespace top {
 
 namespace gossip {
 
-class GossipBloomfilter : public GossipInterface {
+class GossipBloomfilter;
+typedef GossipEngine<
+        GossipBloomfilter,
+        GossipBloomfilterStop,
+        GossipBloomfilterSelect,
+        GossipBloomfilterUpdate<0>,
+        GossipFlatSend> GossipBloomfilterEngine;
+
+// kGossipBloomfilter: random neighbors not in the bloomfilter
+class GossipBloomfilter : public GossipBloomfilterEngine {
 public:
     explicit GossipBloomfilter(transport::TransportPtr transport_ptr);
     virtual ~GossipBloomfilter();
-    virtual void Broadcast(
-            uint64_t local_hash64,
-            transport::protobuf::RoutingMessage& message,
-            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors);
 
     // just for performance test
     virtual void BroadcastWithNoFilter(
@@ -5,23 +5,25 @@
 #pragma once
 
 #include "xtransport/transport.h"
-#include "xgossip/gossip_interface.h"
+#include "xgossip/include/gossip_policies.h"
 
 namespace top {
 
 namespace gossip {
 
-class GossipBloomfilterLayer : public GossipInterface {
+class GossipBloomfilterLayer;
+typedef GossipEngine<
+        GossipBloomfilterLayer,
+        GossipLayeredBloomfilterStop,
+        GossipRangeSelect,
+        GossipBloomfilterUpdate<1>,
+        GossipSwitchLayerSend<true>> GossipBloomfilterLayerEngine;
+
+// kGossipBloomfilterAndLayered: routing table ranges and a bloomfilter
+class GossipBloomfilterLayer : public GossipBloomfilterLayerEngine {
 public:
     explicit GossipBloomfilterLayer(transport::TransportPtr transport_ptr);
     virtual ~GossipBloomfilterLayer();
-    virtual void Broadcast(
-            uint64_t local_hash64,
-            transport::protobuf::RoutingMessage& message,
-            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors);
-    virtual void Broadcast(
-            transport::protobuf::RoutingMessage& message,
-            kadmlia::RoutingTablePtr& routing_table);
 
 private:
 
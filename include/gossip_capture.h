@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "xpbase/base/top_utils.h"
+#include "xtransport/proto/transport.pb.h"
+
+namespace top {
+
+namespace gossip {
+
+// Capture file: 8 byte header "XGCP" + u32 version, then records
+//   u32 size  bytes after this field
+//   u64 arrive_us  system clock, microseconds since epoch
+//   u16 from_port
+//   u8  ip_size, then ip_size bytes of from_ip
+//   serialized RoutingMessage, the rest of the record
+// integers little endian. Records are only appended, a reader maps the file
+// and walks the size prefixes, a torn last record ends the capture.
+static const char kGossipCaptureMagic[4] = { 'X', 'G', 'C', 'P' };
+static const uint32_t kGossipCaptureVersion = 1u;
+static const uint32_t kGossipCaptureHeaderSize = 8u;
+static const uint32_t kGossipCaptureRecordFixedSize = 8u + 2u + 1u;
+
+struct GossipCaptureRecord {
+    uint64_t arrive_us;
+    std::string from_ip;
+    uint16_t from_port;
+    const char* message_data;  // in the mapping, valid while the reader is open
+    uint32_t message_size;
+};
+
+class GossipCaptureWriter {
+public:
+    GossipCaptureWriter() {}
+    ~GossipCaptureWriter();
+    bool Open(const std::string& path);
+    void Close();
+    bool Write(
+            uint64_t arrive_us,
+            const std::string& from_ip,
+            uint16_t from_port,
+            const std::string& message_data);
+    uint64_t size() const { return size_; }
+
+private:
+    FILE* file_{ nullptr };
+    uint64_t size_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(GossipCaptureWriter);
+};
+
+class GossipCaptureReader {
+public:
+    GossipCaptureReader() {}
+    ~GossipCaptureReader();
+    bool Open(const std::string& path);
+    void Close();
+    // false at the end of the capture or at a torn record
+    bool Next(GossipCaptureRecord& record);
+    void Rewind() { offset_ = kGossipCaptureHeaderSize; }
+
+private:
+    const char* base_{ nullptr };
+    uint64_t size_{ 0 };
+    uint64_t offset_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(GossipCaptureReader);
+};
+
+// Process wide capture of incoming gossip messages. GossipFilter hands every
+// message to Capture before deduplication, so duplicates are in the capture
+// as they arrived. The from address is the packet's when the caller has it,
+// pre_ip/pre_port otherwise. Off until Start, a disabled Capture is one atomic load.
+class GossipCapture {
+public:
+    static GossipCapture* Instance();
+    // capture stops by itself once the file reaches max_bytes
+    bool Start(const std::string& path, uint64_t max_bytes);
+    void Stop();
+    bool capturing() const { return capturing_.load(std::memory_order_relaxed); }
+    void Capture(
+            const transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port);
+    void GetStat(uint64_t& record_count, uint64_t& bytes);
+
+private:
+    GossipCapture() {}
+    ~GossipCapture() {}
+
+    std::atomic<bool> capturing_{ false };
+    std::mutex mutex_;
+    GossipCaptureWriter writer_;
+    uint64_t max_bytes_{ 0 };
+    uint64_t record_count_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(GossipCapture);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "xpbase/base/top_log.h"
+#include "xgossip/gossip_interface.h"
+#include "xgossip/include/gossip_pipeline.h"
+#include "xgossip/include/gossip_trace.h"
+
+namespace top {
+
+namespace gossip {
+
+struct LayeredPlan;
+
+// What a broadcast may start from. Neighbor based gossip takes neighbors,
+// or every node of routing_table when there are none, range and tree
+// based gossip need routing_table.
+struct GossipContext {
+    uint64_t local_hash64{ 0 };
+    std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors;
+    kadmlia::RoutingTablePtr routing_table;
+};
+
+// one broadcast as it goes through the stages
+struct GossipPass {
+    GossipPass(const GossipContext& in_context, transport::protobuf::RoutingMessage& in_message)
+            : context(in_context),
+              message(in_message),
+              trace(in_message),
+              stage(in_message.gossip().gossip_type(), kGossipStageStopCheck) {}
+
+    const GossipContext& context;
+    transport::protobuf::RoutingMessage& message;
+    GossipTraceScope trace;
+    GossipStageTimer stage;
+    std::shared_ptr<base::Uint64BloomFilter> bloomfilter;
+    std::unordered_set<uint32_t> passed_set;
+    std::shared_ptr<const LayeredPlan> plan;
+    std::vector<kadmlia::NodeInfoPtr> nodes;  // selected to send to
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(GossipPass);
+};
+
+// GossipInterface helpers opened up to the stage policies
+class GossipEngineBase : public GossipInterface {
+public:
+    using GossipInterface::Send;
+    using GossipInterface::SendLayered;
+    using GossipInterface::SendLayeredBypass;
+    using GossipInterface::SelectNodes;
+    using GossipInterface::GetNeighborCount;
+    using GossipInterface::GetRandomNodes;
+    using GossipInterface::CheckDiffNetwork;
+    using GossipInterface::ThisNodeIsEvil;
+
+protected:
+    explicit GossipEngineBase(transport::TransportPtr transport_ptr) : GossipInterface(transport_ptr) {}
+    virtual ~GossipEngineBase() {}
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(GossipEngineBase);
+};
+
+// A broadcast composed at compile time from stage policies, see
+// gossip_policies.h. Each policy is a type with a static
+// template <class Engine> Run(Engine& engine, GossipPass& pass):
+//   StopPolicy    bool, false ends the broadcast (hop limit, stop times)
+//   SelectPolicy  bool, fills pass.nodes, false when nothing to send to
+//   FilterPolicy  void, carries the bloomfilter or pass set on in message
+//   SendPolicy    uint32_t, encodes and transmits, returns the fanout
+// Derived is the concrete gossip, handed to the policies so they can reach
+// its own state. Dedup is left to GossipFilter, wrouter runs it before any
+// GossipType is known. Both GossipInterface entries lead to Run, which
+// calls the policies directly.
+template <class Derived, class StopPolicy, class SelectPolicy, class FilterPolicy, class SendPolicy>
+class GossipEngine : public GossipEngineBase {
+public:
+    void Run(const GossipContext& context, transport::protobuf::RoutingMessage& message) {
+        Derived& engine = static_cast<Derived&>(*this);
+        GossipPass pass(context, message);
+        if (!StopPolicy::Run(engine, pass)) {
+            return;
+        }
+        pass.stage.Enter(kGossipStageSelect);
+        if (!SelectPolicy::Run(engine, pass)) {
+            return;
+        }
+        pass.stage.Enter(kGossipStageFilterUpdate);
+        FilterPolicy::Run(engine, pass);
+        pass.trace.StartSend();
+        uint32_t fanout = SendPolicy::Run(engine, pass);
+        pass.trace.StopSend(fanout);
+    }
+
+    virtual void Broadcast(
+            uint64_t local_hash64,
+            transport::protobuf::RoutingMessage& message,
+            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors) {
+        GossipContext context;
+        context.local_hash64 = local_hash64;
+        context.neighbors = neighbors;
+        Run(context, message);
+    }
+
+    virtual void Broadcast(
+            transport::protobuf::RoutingMessage& message,
+            kadmlia::RoutingTablePtr& routing_table) {
+        if (!routing_table) {
+            TOP_WARN2("broadcast message.type(%d) without routing table", message.type());
+            return;
+        }
+        GossipContext context;
+        context.local_hash64 = routing_table->get_local_node_info()->hash64();
+        context.routing_table = routing_table;
+        Run(context, message);
+    }
+
+protected:
+    explicit GossipEngine(transport::TransportPtr transport_ptr) : GossipEngineBase(transport_ptr) {}
+    virtual ~GossipEngine() {}
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(GossipEngine);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -7,8 +7,11 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "xtransport/proto/transport.pb.h"
+#include "xgossip/include/gossip_repeat_sketch.h"
+#include "xgossip/include/lock_wait_mutex.h"
 
 namespace top {
 
@@ -20,6 +23,10 @@ namespace gossip {
 
 static const uint32_t kRepeatedValue = 1;
 static const uint64_t kClearRstPeriod = 15ll * 1000ll * 1000ll; // 5 seconds
+// repeat sketch, 1MB per kClearRstPeriod window, one spare window
+static const uint32_t kRepeatSketchWidth = 65536u;
+static const uint32_t kRepeatSketchDepth = 4u;
+static const uint32_t kRepeatWindowCount = 4u;
 typedef std::shared_ptr<std::unordered_map<uint32_t, uint32_t>> HashMapPtr;
 
 class GossipFilter {
@@ -27,14 +34,25 @@ public:
     static GossipFilter* Instance();
 
     bool Init();
+    // the receive path of wrouter, captured with pre_ip/pre_port as the
+    // best address there is
     bool FilterMessage(transport::protobuf::RoutingMessage& message);
+    // from_ip/from_port of the packet the message came in, when known
+    bool FilterMessage(
+            transport::protobuf::RoutingMessage& message,
+            const std::string& from_ip,
+            uint16_t from_port);
+    // receive times of msg_hash over the last kRepeatWindowCount periods
+    void GetRepeatStat(GossipRepeatStat& stat) { repeat_sketch_.GetStat(stat); }
+    void GetLockWaitStat(LockWaitStat& stat) { current_index_mutex_.GetStat(stat); }
 
 protected:
+    bool DoFilterMessage(transport::protobuf::RoutingMessage& message);
     bool AddData(uint32_t);
     bool FindData(uint32_t);
     void do_clear_and_reset();
     void AddRepeatMsg(uint32_t key);
-    void PrintRepeatMap();
+    void RotateRepeatStat();
 
 private:
     GossipFilter();
@@ -43,11 +61,10 @@ private:
 private:
     bool inited_{false};
     std::vector<HashMapPtr> time_filter_;
-    std::mutex current_index_mutex_;
+    LockWaitMutex current_index_mutex_;
     uint32_t current_index_;
     std::shared_ptr<base::TimerRepeated> timer_{nullptr};
-    std::mutex repeat_map_mutex_;
-    std::map<uint32_t, uint32_t> repeat_map_;
+    GossipRepeatSketch repeat_sketch_;
     std::shared_ptr<base::TimerRepeated> remap_timer_{nullptr};
 };
 
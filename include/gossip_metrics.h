@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+#include "xgossip/include/gossip_trace.h"
+
+namespace top {
+
+namespace gossip {
+
+static const uint32_t kGossipMetricStripeCount = 16u;
+// GossipType values, larger ones count as kGossipInvalid
+static const uint32_t kGossipMetricTypeCount = 8u;
+// message types, larger ones count as type 0
+static const uint32_t kGossipMetricMessageTypeCount = 1024u;
+static const uint32_t kGossipMetricOutcomeCount = kGossipTraceNoNeighbor + 1;
+
+// Counter spread over cache line padded stripes, a thread always adds to
+// the same stripe so receive threads do not share a line.
+class GossipStripedCounter {
+public:
+    GossipStripedCounter() {}
+    void Add(uint64_t value);
+    uint64_t Get() const;
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    Stripe stripes_[kGossipMetricStripeCount];
+
+    DISALLOW_COPY_AND_ASSIGN(GossipStripedCounter);
+};
+
+struct GossipHistogramSnapshot {
+    uint64_t count{ 0 };
+    uint64_t sum{ 0 };
+    uint64_t max{ 0 };
+    // lower bound of each non empty bucket and its count, ascending
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;
+
+    // lower bound of the bucket holding the rate quantile, 0 when empty
+    uint64_t Percentile(double rate) const;
+};
+
+// HDR style histogram of non negative values: exact below 8, then 8 linear
+// buckets per power of two, so any value is within 12.5% of its bucket.
+// Striped like GossipStripedCounter, GetSnapshot merges the stripes.
+class GossipHistogram {
+public:
+    static const uint32_t kSubBucketBits = 3u;
+    static const uint32_t kBucketCount = (64u - kSubBucketBits + 1u) << kSubBucketBits;
+
+    GossipHistogram() {}
+    void Add(uint64_t value);
+    void GetSnapshot(GossipHistogramSnapshot& snapshot) const;
+    static uint32_t BucketIndex(uint64_t value);
+    static uint64_t BucketLowerBound(uint32_t index);
+
+private:
+    // the count is the sum of the buckets
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> buckets[kBucketCount] = {};
+        std::atomic<uint64_t> sum{ 0 };
+        std::atomic<uint64_t> max{ 0 };
+    };
+
+    Stripe stripes_[kGossipMetricStripeCount];
+
+    DISALLOW_COPY_AND_ASSIGN(GossipHistogram);
+};
+
+struct GossipMetricsSnapshot {
+    // by GossipType, then by GossipTraceOutcome, only types seen
+    std::map<uint32_t, std::vector<uint64_t>> type_outcomes;
+    // by message type, then by GossipTraceOutcome, only types seen
+    std::map<uint32_t, std::vector<uint64_t>> message_type_outcomes;
+    GossipHistogramSnapshot fanout;  // neighbors sent to per forwarded message
+    GossipHistogramSnapshot bloomfilter_fill;  // set bits per mille of sent bloomfilters
+    uint64_t send_failed{ 0 };
+    uint64_t sync_ask{ 0 };  // headers asked for
+    uint64_t sync_fetched{ 0 };  // blocks that came by sync
+    uint64_t sync_timeout{ 0 };  // ackers and holders that did not answer in time
+
+    // one "name{labels} value" line per metric, for the monitoring agent
+    std::string ToString() const;
+};
+
+// Process wide gossip metrics, always on in release builds. Every Broadcast
+// and every GossipFilter duplicate ends up in one outcome through
+// GossipTraceScope, received is the sum over outcomes.
+class GossipMetrics {
+public:
+    static GossipMetrics* Instance();
+    void AddOutcome(uint32_t gossip_type, uint32_t message_type, uint32_t outcome, uint32_t fanout);
+    void AddBloomfilterFill(const std::vector<uint64_t>& bloomfilter);
+    void AddSendFailed() { send_failed_.Add(1); }
+    void AddSyncAsk(uint64_t header_count) { sync_ask_.Add(header_count); }
+    void AddSyncFetched() { sync_fetched_.Add(1); }
+    void AddSyncTimeout(uint64_t source_count) { sync_timeout_.Add(source_count); }
+    void GetSnapshot(GossipMetricsSnapshot& snapshot);
+
+private:
+    GossipMetrics() {}
+    ~GossipMetrics() {}
+
+    // one whole table per stripe, padding each of the 1024 x outcome
+    // counters to a line would take 16 times the memory
+    struct alignas(64) MessageTypeStripe {
+        std::atomic<uint64_t> outcomes[kGossipMetricMessageTypeCount][kGossipMetricOutcomeCount];
+    };
+
+    GossipStripedCounter type_outcomes_[kGossipMetricTypeCount][kGossipMetricOutcomeCount];
+    MessageTypeStripe message_type_outcomes_[kGossipMetricStripeCount] = {};
+    GossipHistogram fanout_;
+    GossipHistogram bloomfilter_fill_;
+    GossipStripedCounter send_failed_;
+    GossipStripedCounter sync_ask_;
+    GossipStripedCounter sync_fetched_;
+    GossipStripedCounter sync_timeout_;
+
+    DISALLOW_COPY_AND_ASSIGN(GossipMetrics);
+};
+
+}  // namespace gossip
+
+}  // namespace top
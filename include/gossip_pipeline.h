@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "xpbase/base/top_utils.h"
+#include "xgossip/include/gossip_metrics.h"
+
+namespace top {
+
+namespace gossip {
+
+// what a relay does with one message, in order
+enum GossipStage {
+    kGossipStageDedup = 0,  // GossipFilter
+    kGossipStageStopCheck = 1,  // sync announce, hop limit, evil, stop times
+    kGossipStageSelect = 2,  // candidate neighbors
+    kGossipStageFilterUpdate = 3,  // bloomfilter or pass set carried on
+    kGossipStageEncode = 4,  // serialize and packet header
+    kGossipStageTransmit = 5,  // SendData
+    kGossipStageCount = 6,
+};
+
+// cycle counter of the stage timing, the TSC where there is one
+uint64_t GossipStageCycles();
+
+// Per GossipType and stage histograms of cycles spent, filled by
+// GossipStageTimer when enabled. Off by default.
+class GossipStageStat {
+public:
+    static GossipStageStat* Instance();
+    // enabling calibrates cycles against the steady clock, about 10ms
+    void SetEnabled(bool enabled);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void Add(uint32_t gossip_type, uint32_t stage, uint64_t cycles);
+    void GetSnapshot(uint32_t gossip_type, uint32_t stage, GossipHistogramSnapshot& snapshot) const;
+    double cycles_per_us() const { return cycles_per_us_.load(std::memory_order_relaxed); }
+    // count, p50, p99 and max in microseconds of every stage run so far
+    std::string ToString() const;
+
+private:
+    GossipStageStat() {}
+    ~GossipStageStat() {}
+
+    std::atomic<bool> enabled_{ false };
+    // written by SetEnabled while ToString may run
+    std::atomic<double> cycles_per_us_{ 1000.0 };
+    GossipHistogram histograms_[kGossipMetricTypeCount][kGossipStageCount];
+
+    DISALLOW_COPY_AND_ASSIGN(GossipStageStat);
+};
+
+// Times the stages of one pass through a broadcast pipeline. Enter closes
+// the running stage and starts the next, a stage entered more than once
+// adds up, and every stage entered goes to GossipStageStat on Stop or
+// destruction. Costs one relaxed load when timing is off.
+class GossipStageTimer {
+public:
+    GossipStageTimer(uint32_t gossip_type, GossipStage stage);
+    ~GossipStageTimer() { Stop(); }
+    void Enter(GossipStage stage) {
+        if (enabled_) {
+            EnterStage(stage);
+        }
+    }
+    void Stop();
+
+private:
+    void EnterStage(GossipStage stage);
+
+    bool enabled_;
+    uint32_t gossip_type_;
+    uint32_t stage_{ kGossipStageCount };
+    uint32_t entered_{ 0 };  // bit per stage
+    uint64_t start_{ 0 };
+    uint64_t cycles_[kGossipStageCount];
+
+    DISALLOW_COPY_AND_ASSIGN(GossipStageTimer);
+};
+
+}  // namespace gossip
+
+}  // namespace top
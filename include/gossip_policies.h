@@ -0,0 +1,315 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "xbase/xhash.h"
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_utils.h"
+#include "xpbase/base/uint64_bloomfilter.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xgossip/include/block_sync_manager.h"
+#include "xgossip/include/gossip_engine.h"
+#include "xgossip/include/gossip_metrics.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/mesages_with_bloomfilter.h"
+
+namespace top {
+
+namespace gossip {
+
+// Stage policies shared by the GossipEngine instantiations. Layered tree
+// policies that need BroadcastLayered internals live in broadcast_layered.h.
+
+inline bool GossipMaxHopReached(GossipPass& pass) {
+    auto& message = pass.message;
+    if (message.gossip().max_hop_num() > 0 &&
+            message.gossip().max_hop_num() <= message.hop_num()) {
+        TOP_WARN2("message.type(%d) hop_num(%d) larger than gossip_max_hop_num(%d)",
+                message.type(),
+                message.hop_num(),
+                message.gossip().max_hop_num());
+        pass.trace.set_outcome(kGossipTraceHopLimit);
+        return true;
+    }
+    return false;
+}
+
+// pass.bloomfilter from MessageWithBloomfilter, false when stop times reached
+inline bool GossipTakeBloomfilter(GossipPass& pass) {
+    bool stop_gossip = false;
+    pass.bloomfilter = MessageWithBloomfilter::Instance()->GetMessageBloomfilter(
+            pass.message,
+            stop_gossip);
+    if (stop_gossip) {
+        pass.trace.set_outcome(kGossipTraceStopped);
+        TOP_DEBUG("stop gossip for message.type(%d) hop_num(%d)",
+                pass.message.type(),
+                pass.message.hop_num());
+        return false;
+    }
+
+    assert(pass.bloomfilter);
+    if (!pass.bloomfilter) {
+        TOP_WARN2("bloomfilter invalid");
+        return false;
+    }
+    return true;
+}
+
+// neighbors given, or every node of the routing table
+inline const std::vector<kadmlia::NodeInfoPtr>& GossipNeighbors(
+        GossipPass& pass,
+        std::vector<kadmlia::NodeInfoPtr>& table_nodes) {
+    if (pass.context.neighbors) {
+        return *pass.context.neighbors;
+    }
+    if (pass.context.routing_table) {
+        uint32_t max_index = pass.context.routing_table->nodes_size();
+        pass.context.routing_table->GetRangeNodes(0, max_index, table_nodes);
+    }
+    return table_nodes;
+}
+
+// stop: hop limit, evil node, stop times, then marks this node in the
+// bloomfilter
+struct GossipBloomfilterStop {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        BlockSyncManager::Instance()->NewBroadcastMessage(pass.message);
+        if (GossipMaxHopReached(pass)) {
+            return false;
+        }
+        if (engine.ThisNodeIsEvil(pass.message)) {
+            TOP_WARN2("this node(%s) is evil", HexEncode(global_xid->Get()).c_str());
+            return false;
+        }
+        if (!GossipTakeBloomfilter(pass)) {
+            return false;
+        }
+        pass.bloomfilter->Add(pass.context.local_hash64);
+        return true;
+    }
+};
+
+// stop: message from another network starts over, then hop limit and stop
+// times, this node marked past ign_bloomfilter_level
+struct GossipLayeredBloomfilterStop {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        engine.CheckDiffNetwork(pass.message);
+        BlockSyncManager::Instance()->NewBroadcastMessage(pass.message);
+        if (GossipMaxHopReached(pass)) {
+            return false;
+        }
+        if (!GossipTakeBloomfilter(pass)) {
+            return false;
+        }
+        if (pass.message.hop_num() >= pass.message.gossip().ign_bloomfilter_level()) {
+            pass.bloomfilter->Add(pass.context.local_hash64);
+        }
+        return true;
+    }
+};
+
+// stop: hop limit only, the pass set carries what was visited
+struct GossipSetStop {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        auto& message = pass.message;
+        BlockSyncManager::Instance()->NewBroadcastMessage(message);
+        if (GossipMaxHopReached(pass)) {
+            return false;
+        }
+        // counts the sendout, the set layer has never stopped on it
+        auto hash64 = base::xhash64_t::digest(message.xid() + std::to_string(message.id()));
+        MessageWithBloomfilter::Instance()->StopGossip(hash64, message.gossip().stop_times());
+        return true;
+    }
+};
+
+// select: random neighbors not in the bloomfilter
+struct GossipBloomfilterSelect {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        std::vector<kadmlia::NodeInfoPtr> table_nodes;
+        auto& neighbors = GossipNeighbors(pass, table_nodes);
+        TOP_DEBUG("GossipBloomfilter Broadcast neighbors size %d", neighbors.size());
+        std::vector<kadmlia::NodeInfoPtr> tmp_neighbors;
+        uint32_t filtered = 0;
+        for (auto iter = neighbors.begin(); iter != neighbors.end(); ++iter) {
+            if ((*iter)->hash64 == 0) {
+                TOP_WARN("node:%s hash64 empty, invalid", HexEncode((*iter)->xid).c_str());
+                continue;
+            }
+
+            if (pass.bloomfilter->Contain((*iter)->hash64)) {
+                ++filtered;
+                continue;
+            }
+
+            tmp_neighbors.push_back(*iter);
+        }
+        TOP_DEBUG("GossipBloomfilter Broadcast tmp_neighbors size %d, filtered %d nodes",
+                tmp_neighbors.size(),
+                filtered);
+        pass.trace.set_filtered(filtered);
+
+        pass.nodes = engine.GetRandomNodes(tmp_neighbors, engine.GetNeighborCount(pass.message));
+        if (pass.nodes.empty()) {
+            TOP_WARN2("stop Broadcast, rest_random_neighbors empty, broadcast failed, msg.hop_num(%d), msg.type(%d)",
+                    pass.message.hop_num(),
+                    pass.message.type());
+            pass.trace.set_outcome(kGossipTraceNoNeighbor);
+            return false;
+        }
+        return true;
+    }
+};
+
+// select: nodes of the message range in the routing table, not in the
+// bloomfilter
+struct GossipRangeSelect {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        if (!pass.context.routing_table) {
+            TOP_WARN2("range select without routing table, msg.type(%d)", pass.message.type());
+            pass.trace.set_outcome(kGossipTraceNoNeighbor);
+            return false;
+        }
+        kadmlia::RoutingTablePtr routing_table = pass.context.routing_table;
+        engine.SelectNodes(pass.message, routing_table, pass.bloomfilter, pass.nodes);
+        if (pass.nodes.empty()) {
+            TOP_WARN2("stop broadcast, select_nodes empty, msg.hop_num(%d), msg.type(%d)",
+                    pass.message.hop_num(),
+                    pass.message.type());
+            pass.trace.set_outcome(kGossipTraceNoNeighbor);
+            return false;
+        }
+        return true;
+    }
+};
+
+// select: neighbors not in the pass set, by range once past
+// switch_layer_hop_num, random before
+struct GossipPassSetSelect {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        auto& message = pass.message;
+        pass.passed_set.rehash(32);
+        for (int i = 0; i < message.gossip().pass_node_size(); ++i) {
+            pass.passed_set.insert(message.gossip().pass_node(i));
+        }
+
+        std::vector<kadmlia::NodeInfoPtr> table_nodes;
+        auto& neighbors = GossipNeighbors(pass, table_nodes);
+        std::vector<kadmlia::NodeInfoPtr> tmp_neighbors;
+        uint32_t filtered = 0;
+        for (auto iter = neighbors.begin(); iter != neighbors.end(); ++iter) {
+            if ((*iter)->xid.empty()) {
+                continue;
+            }
+
+            if (pass.passed_set.find(static_cast<uint32_t>((*iter)->hash64)) != pass.passed_set.end()) {
+                ++filtered;
+                continue;
+            }
+            tmp_neighbors.push_back(*iter);
+        }
+        std::random_shuffle(tmp_neighbors.begin(), tmp_neighbors.end());
+        pass.trace.set_filtered(filtered);
+
+        if (message.hop_num() >= message.gossip().switch_layer_hop_num()) {
+            engine.SelectNodes(message, tmp_neighbors, pass.nodes);
+        } else {
+            pass.nodes = engine.GetRandomNodes(tmp_neighbors, engine.GetNeighborCount(message));
+        }
+        return true;
+    }
+};
+
+// filter: selected nodes into the bloomfilter once hop_num + kHopOffset is
+// past ign_bloomfilter_level, then the bloomfilter into the message
+template <uint32_t kHopOffset>
+struct GossipBloomfilterUpdate {
+    template <class Engine>
+    static void Run(Engine& engine, GossipPass& pass) {
+        auto& message = pass.message;
+        if ((message.hop_num() + kHopOffset) > message.gossip().ign_bloomfilter_level()) {
+            for (auto iter = pass.nodes.begin(); iter != pass.nodes.end(); ++iter) {
+                pass.bloomfilter->Add((*iter)->hash64);
+            }
+        }
+
+        const std::vector<uint64_t>& bloomfilter_vec = pass.bloomfilter->Uint64Vector();
+        GossipMetrics::Instance()->AddBloomfilterFill(bloomfilter_vec);
+        message.clear_bloomfilter();
+        for (uint32_t i = 0; i < bloomfilter_vec.size(); ++i) {
+            message.add_bloomfilter(bloomfilter_vec[i]);
+        }
+    }
+};
+
+// filter: this node and the selected ones into the pass set of the message
+struct GossipPassSetUpdate {
+    template <class Engine>
+    static void Run(Engine& engine, GossipPass& pass) {
+        auto gossip_param = pass.message.mutable_gossip();
+        uint32_t local_hash = static_cast<uint32_t>(pass.context.local_hash64);
+        if (pass.passed_set.find(local_hash) == pass.passed_set.end()) {
+            gossip_param->add_pass_node(local_hash);
+        }
+        for (auto iter = pass.nodes.begin(); iter != pass.nodes.end(); ++iter) {
+            if (pass.passed_set.find(static_cast<uint32_t>((*iter)->hash64)) == pass.passed_set.end()) {
+                gossip_param->add_pass_node(static_cast<uint32_t>((*iter)->hash64));
+            }
+        }
+    }
+};
+
+struct GossipNoFilterUpdate {
+    template <class Engine>
+    static void Run(Engine& engine, GossipPass& pass) {}
+};
+
+// send: one encoded message to every selected node
+struct GossipFlatSend {
+    template <class Engine>
+    static uint32_t Run(Engine& engine, GossipPass& pass) {
+        TOP_DEBUG("gossip broadcast finally %d neighbors", pass.nodes.size());
+        engine.Send(pass.message, pass.nodes, &pass.stage);
+        return pass.nodes.size();
+    }
+};
+
+// send: past switch_layer_hop_num each node gets its own range, with
+// kBypass the children of suspect nodes are covered too
+template <bool kBypass>
+struct GossipSwitchLayerSend {
+    template <class Engine>
+    static uint32_t Run(Engine& engine, GossipPass& pass) {
+        auto& message = pass.message;
+        if (message.hop_num() < message.gossip().switch_layer_hop_num()) {
+            engine.Send(message, pass.nodes, &pass.stage);
+            return pass.nodes.size();
+        }
+
+        uint64_t min_dis = message.gossip().min_dis();
+        uint64_t max_dis = message.gossip().max_dis();
+        engine.SendLayered(message, pass.nodes, &pass.stage);
+        if (kBypass && pass.context.routing_table) {
+            kadmlia::RoutingTablePtr routing_table = pass.context.routing_table;
+            engine.SendLayeredBypass(message, routing_table, pass.bloomfilter, pass.nodes, min_dis, max_dis);
+        }
+        return pass.nodes.size();
+    }
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "xpbase/base/top_utils.h"
+#include "xtransport/transport.h"
+#include "xgossip/include/gossip_engine.h"
+
+namespace top {
+
+namespace gossip {
+
+static const uint32_t kGossipTypeCount = 8u;
+
+// Maps a GossipType to its GossipEngine instantiation over one transport:
+// one indirect call to the type's Run, the stages inside are bound at
+// compile time.
+class GossipRegistry {
+public:
+    // registers the bloomfilter, layered, bloomfilter layered, set layered
+    // and capacity layered gossip
+    explicit GossipRegistry(transport::TransportPtr transport_ptr);
+    ~GossipRegistry() {}
+
+    template <class Engine>
+    void Register(uint32_t gossip_type, std::shared_ptr<Engine> engine) {
+        if (gossip_type >= kGossipTypeCount) {
+            return;
+        }
+        entries_[gossip_type].engine = engine;
+        entries_[gossip_type].run = &RunEngine<Engine>;
+    }
+    bool Has(uint32_t gossip_type) const {
+        return gossip_type < kGossipTypeCount && entries_[gossip_type].run != nullptr;
+    }
+    // false when the GossipType of message has no engine
+    bool Broadcast(const GossipContext& context, transport::protobuf::RoutingMessage& message);
+
+private:
+    typedef void (*RunFunction)(void*, const GossipContext&, transport::protobuf::RoutingMessage&);
+
+    struct Entry {
+        std::shared_ptr<void> engine;
+        RunFunction run{ nullptr };
+    };
+
+    template <class Engine>
+    static void RunEngine(
+            void* engine,
+            const GossipContext& context,
+            transport::protobuf::RoutingMessage& message) {
+        static_cast<Engine*>(engine)->Run(context, message);
+    }
+
+    Entry entries_[kGossipTypeCount];
+
+    DISALLOW_COPY_AND_ASSIGN(GossipRegistry);
+};
+
+}  // namespace gossip
+
+}  // namespace top
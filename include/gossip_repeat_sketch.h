@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+// receive times at and above the last bucket share it
+static const uint32_t kRepeatBuckets = 32u;
+static const uint32_t kRepeatTopCount = 32u;
+
+struct GossipRepeatStat {
+    uint64_t receive_count{ 0 };
+    uint64_t message_count{ 0 };  // distinct msg_hash, estimated
+    uint32_t max_repeat{ 0 };
+    // messages by times received, index 0 unused
+    std::vector<uint64_t> repeat_distribution;
+    // most received msg_hash and their times, descending
+    std::vector<std::pair<uint32_t, uint32_t>> top_messages;
+
+    std::string ToString() const;
+};
+
+// Times each msg_hash is received, in fixed memory. A count-min sketch per
+// window counts receives and overestimates by at most
+// e * receives / width with probability 1 - e^-depth; the windows rotate
+// so the stat covers the last window_count periods. Concurrent Add only
+// takes a lock when a message enters the per window heavy hitters.
+class GossipRepeatSketch {
+public:
+    // width is rounded up to a power of two
+    GossipRepeatSketch(uint32_t width = 16384u, uint32_t depth = 4u, uint32_t window_count = 4u);
+    ~GossipRepeatSketch() {}
+    // returns the estimated times msg_hash was received in this window
+    uint32_t Add(uint32_t msg_hash);
+    // starts a new window, dropping the oldest
+    void Rotate();
+    void GetStat(GossipRepeatStat& stat);
+
+private:
+    struct Window {
+        std::unique_ptr<std::atomic<uint32_t>[]> counters;
+        // messages currently received index times, moved along as the
+        // estimate grows, may go briefly negative on collisions
+        std::atomic<int64_t> distribution[kRepeatBuckets];
+        std::atomic<uint64_t> receive_count{ 0 };
+        // receive times a message needs to enter top_messages
+        std::atomic<uint32_t> top_threshold{ 2 };
+        std::mutex top_mutex;
+        std::vector<std::pair<uint32_t, uint32_t>> top_messages;
+    };
+
+    uint32_t Index(uint32_t msg_hash, uint32_t row) const;
+    void ClearWindow(Window& window);
+    void UpdateTop(Window& window, uint32_t msg_hash, uint32_t repeat);
+
+    uint32_t width_;
+    uint32_t depth_;
+    // one spare window beyond window_count is cleared before reuse
+    std::vector<std::unique_ptr<Window>> windows_;
+    std::atomic<uint32_t> current_{ 0 };
+    std::mutex rotate_mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(GossipRepeatSketch);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -5,20 +5,25 @@
 #pragma once
 
 #include "xtransport/transport.h"
-#include "xgossip/gossip_interface.h"
+#include "xgossip/include/gossip_policies.h"
 
 namespace top {
 
 namespace gossip {
 
-class GossipSetLayer : public GossipInterface {
+class GossipSetLayer;
+typedef GossipEngine<
+        GossipSetLayer,
+        GossipSetStop,
+        GossipPassSetSelect,
+        GossipPassSetUpdate,
+        GossipSwitchLayerSend<false>> GossipSetLayerEngine;
+
+// kGossipSetFilterAndLayered: visited nodes carried as a pass set
+class GossipSetLayer : public GossipSetLayerEngine {
 public:
     explicit GossipSetLayer(transport::TransportPtr transport_ptr);
     virtual ~GossipSetLayer();
-    virtual void Broadcast(
-            uint64_t local_hash64,
-            transport::protobuf::RoutingMessage& message,
-            std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors);
 
 private:
 
@@ -0,0 +1,128 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+#include "xtransport/proto/transport.pb.h"
+
+namespace top {
+
+namespace gossip {
+
+enum GossipTraceOutcome {
+    kGossipTraceDropped = 0,  // evil node, invalid bloomfilter and the like
+    kGossipTraceForwarded = 1,
+    kGossipTraceDuplicate = 2,  // GossipFilter has seen the msg_hash
+    kGossipTraceHopLimit = 3,
+    kGossipTraceStopped = 4,  // stop times reached
+    kGossipTraceNoNeighbor = 5,  // nothing left to send to
+};
+
+// what one node did with one sampled message
+struct GossipTraceEvent {
+    uint64_t recv_us;  // system clock, microseconds since epoch
+    uint32_t msg_hash;
+    uint32_t send_us;  // spent in Send
+    uint16_t hop_num;
+    uint16_t filtered;  // neighbors skipped by bloomfilter or pass set
+    uint16_t fanout;  // neighbors sent to
+    uint8_t gossip_type;
+    uint8_t outcome;  // GossipTraceOutcome
+};
+
+// Single producer single consumer ring, written by its owning thread and
+// read by GossipTrace under its lock. Full rings drop new events.
+struct GossipTraceRing {
+    static const uint64_t kCapacity = 4096ull;
+
+    GossipTraceEvent events[kCapacity];
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> tail{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+};
+
+// Sampling hop trace of gossip broadcasts. A message is sampled when its
+// msg_hash falls in 1 / sample_rate, so every node traces the same
+// broadcasts and their events join up into the whole dissemination. Events
+// go to a ring of the recording thread, no lock on the hot path, and are
+// collected by Query, Drain or DrainToFile. Sampling is off by default and
+// then a trace point costs one relaxed atomic load.
+class GossipTrace {
+public:
+    static GossipTrace* Instance();
+    // 0 turns tracing off, 1 traces every message
+    void SetSampleRate(uint32_t sample_rate);
+    bool Sampled(uint32_t msg_hash) const {
+        uint32_t sample_rate = sample_rate_.load(std::memory_order_relaxed);
+        return sample_rate != 0 && (msg_hash * 0x9e3779b1u) % sample_rate == 0;
+    }
+    void Record(const GossipTraceEvent& event);
+    // events of one broadcast seen so far, they stay for later queries
+    void Query(uint32_t msg_hash, std::vector<GossipTraceEvent>& events);
+    // takes every collected event
+    void Drain(std::vector<GossipTraceEvent>& events);
+    // appends every collected event to path as one text line each
+    bool DrainToFile(const std::string& path);
+    void GetStat(uint64_t& record_count, uint64_t& drop_count);
+
+private:
+    GossipTrace() {}
+    ~GossipTrace() {}
+    GossipTraceRing* GetThreadRing();
+    void CollectLocked();
+
+    // events kept between collections, oldest dropped first
+    static const uint32_t kMaxTraceHistory = 65536u;
+
+    std::atomic<uint32_t> sample_rate_{ 0 };
+    std::atomic<uint64_t> record_count_{ 0 };
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<GossipTraceRing>> rings_;
+    std::deque<GossipTraceEvent> history_;
+    uint64_t drop_count_{ 0 };  // of rings_ gone and of history_
+
+    DISALLOW_COPY_AND_ASSIGN(GossipTrace);
+};
+
+// Collects one event over a Broadcast call and records it when it goes out
+// of scope, if the message is sampled. Every scope counts its outcome in
+// GossipMetrics, unsampled ones take no timestamps.
+class GossipTraceScope {
+public:
+    explicit GossipTraceScope(const transport::protobuf::RoutingMessage& message);
+    ~GossipTraceScope();
+    void set_outcome(GossipTraceOutcome outcome) { event_.outcome = outcome; }
+    void set_filtered(uint32_t filtered) { event_.filtered = filtered < 0xffffu ? filtered : 0xffffu; }
+    // around Send, counts fanout and marks the message forwarded, or
+    // no neighbor when nothing was sent
+    void StartSend() {
+        if (sampled_) {
+            send_start_ = std::chrono::steady_clock::now();
+        }
+    }
+    void StopSend(uint32_t fanout);
+
+private:
+    bool sampled_;
+    uint32_t message_type_;
+    GossipTraceEvent event_;
+    std::chrono::steady_clock::time_point send_start_;
+
+    DISALLOW_COPY_AND_ASSIGN(GossipTraceScope);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -26,6 +26,8 @@ enum GossipType {
     kGossipLayeredBroadcast = 2,
     kGossipBloomfilterAndLayered = 3,
     kGossipSetFilterAndLayered = 4,
+    kGossipLayeredCapacity = 5,
+    kGossipStripedLayered = 6,
 };
 
 /*
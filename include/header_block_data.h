@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
 #include "xledger/xledger_face.h"
+#include "xgossip/include/block_log_store.h"
 #include "xpbase/base/top_utils.h"
 
 namespace top {
@@ -14,14 +19,46 @@ namespace gossip {
 class HeaderBlockData {
 public:
     explicit HeaderBlockData(std::shared_ptr<top::ledger::xledger_face_t> ledger_face);
+    // blocks go to block_store instead of the ledger
+    explicit HeaderBlockData(std::shared_ptr<BlockLogStore> block_store);
     ~HeaderBlockData();
     void AddData(const std::string& header_hash, const std::string& block);
     void GetData(const std::string& header_hash, std::string& block);
+    // one ledger read when the index has the header, none when it does not
+    bool GetDataIfPresent(const std::string& header_hash, std::string& block);
+    // as GetDataIfPresent, a block in block_store is not copied
+    bool GetViewIfPresent(const std::string& header_hash, BlockLogView& view);
+    // answered from the index only
     bool HasData(const std::string& header_hash);
     void RemoveData(const std::string& header_hash);
+    // releases expired segments of block_store, or expired index entries
+    void DropExpired();
 
 private:
+    static const uint32_t kIndexShardCount = 16u;
+
+    // xhash64 of the header hash to the time the entry is taken as expired
+    struct IndexShard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::chrono::steady_clock::time_point> index_map;
+        uint32_t add_count{ 0 };
+    };
+
+    IndexShard& GetIndexShard(uint64_t fingerprint);
+    void IndexAdd(uint64_t fingerprint);
+    bool IndexHas(uint64_t fingerprint);
+    // as IndexHas, expire_time of the entry when it has one
+    bool IndexHas(uint64_t fingerprint, std::chrono::steady_clock::time_point& expire_time);
+    void IndexRemove(uint64_t fingerprint);
+    bool GetLedgerData(
+            const std::string& header_hash,
+            std::string& block,
+            std::chrono::steady_clock::time_point& expire_time);
+
     std::shared_ptr<top::ledger::xledger_face_t> ledger_face_;
+    std::shared_ptr<BlockLogStore> block_store_;
+    // what was added here and not expired, lookups of anything else skip the ledger
+    IndexShard index_shards_[kIndexShardCount];
 
     DISALLOW_COPY_AND_ASSIGN(HeaderBlockData);
 };
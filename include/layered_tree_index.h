@@ -0,0 +1,61 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace top {
+
+namespace gossip {
+
+// Integer index math for the K-ary tree used by layered broadcast.
+// Nodes are numbered 1..count in logical order and index 0 is the virtual
+// root (the node that starts the broadcast). Level l holds K^l nodes, so the
+// children of index i are [K*i + 1, K*i + K] and its parent is (i - 1) / K.
+// Everything is integer only and constexpr, no table or vector is built.
+
+struct LayeredRange {
+    uint32_t begin;  // first index, inclusive
+    uint32_t end;    // last index, inclusive
+
+    constexpr bool empty() const { return begin > end; }
+    constexpr uint32_t size() const { return empty() ? 0 : end - begin + 1; }
+};
+
+constexpr LayeredRange kLayeredEmptyRange = { 1u, 0u };
+
+constexpr uint32_t LayeredParentIndex(uint32_t index, uint32_t k) {
+    return (index == 0 || k == 0) ? 0 : (index - 1) / k;
+}
+
+// level of index, 0 for the root, 1 for the first K nodes and so on
+constexpr uint32_t LayeredLevel(uint32_t index, uint32_t k) {
+    return (index == 0 || k == 0) ? 0 :
+            (k == 1 ? index : 1 + LayeredLevel(LayeredParentIndex(index, k), k));
+}
+
+constexpr LayeredRange LayeredClampRange(uint64_t begin, uint64_t end, uint32_t count) {
+    return (begin > count) ? kLayeredEmptyRange :
+            LayeredRange{
+                static_cast<uint32_t>(begin),
+                static_cast<uint32_t>(end > count ? count : end) };
+}
+
+// children of index inside [1, count], empty when index is a leaf
+constexpr LayeredRange LayeredChildrenRange(uint32_t index, uint32_t k, uint32_t count) {
+    return (k == 0 || index > count) ? kLayeredEmptyRange :
+            LayeredClampRange(
+                static_cast<uint64_t>(k) * index + 1,
+                static_cast<uint64_t>(k) * index + k,
+                count);
+}
+
+constexpr bool LayeredIsLeaf(uint32_t index, uint32_t k, uint32_t count) {
+    return LayeredChildrenRange(index, k, count).empty();
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "xpbase/base/top_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+struct LockWaitStat {
+    uint64_t wait_count{ 0 };  // lock() calls that found the mutex held
+    uint64_t wait_ns{ 0 };  // time those calls blocked
+};
+
+// std::mutex that times the lock() calls which have to wait. An uncontended
+// lock is one try_lock, the clock is only read on the slow path.
+class LockWaitMutex {
+public:
+    LockWaitMutex() {}
+    void lock() {
+        if (mutex_.try_lock()) {
+            return;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        mutex_.lock();
+        wait_ns_.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count(),
+                std::memory_order_relaxed);
+        wait_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+    // adds to stat, callers sum several mutexes
+    void GetStat(LockWaitStat& stat) const {
+        stat.wait_count += wait_count_.load(std::memory_order_relaxed);
+        stat.wait_ns += wait_ns_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex mutex_;
+    std::atomic<uint64_t> wait_count_{ 0 };
+    std::atomic<uint64_t> wait_ns_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(LockWaitMutex);
+};
+
+}  // namespace gossip
+
+}  // namespace top
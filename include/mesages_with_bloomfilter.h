@@ -11,6 +11,7 @@
 #include "xpbase/base/uint64_bloomfilter.h"
 #include "xpbase/base/top_timer.h"
 #include "xtransport/proto/transport.pb.h"
+#include "xgossip/include/lock_wait_mutex.h"
 
 namespace top {
 
@@ -28,6 +29,7 @@ public:
             transport::protobuf::RoutingMessage& message,
             bool& stop_gossip);
     bool StopGossip(const uint32_t&, uint32_t);
+    void GetLockWaitStat(LockWaitStat& stat) { messsage_bloomfilter_map_mutex_.GetStat(stat); }
 
 private:
     MessageWithBloomfilter() {}
@@ -43,7 +45,7 @@ private:
     static const uint32_t kMaxMessageQueueSize = 508576u;
 
     std::unordered_map<uint32_t, uint8_t> messsage_bloomfilter_map_;
-    std::mutex messsage_bloomfilter_map_mutex_;
+    LockWaitMutex messsage_bloomfilter_map_mutex_;
 
     DISALLOW_COPY_AND_ASSIGN(MessageWithBloomfilter);
 };
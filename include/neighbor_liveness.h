@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "xpbase/base/top_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+struct LivenessItem {
+    double score;
+    bool suspect;
+    std::chrono::steady_clock::time_point update_time;
+};
+
+// per neighbor failure score fed by send failures and missing acks. the score
+// halves every kLivenessHalfLife, a neighbor is suspect while it stays above
+// kSuspectScore, an ack forgets it. relays use it to also cover a suspect
+// child's subtree.
+class NeighborLiveness {
+public:
+    static NeighborLiveness* Instance();
+    void OnSendFailed(const std::string& ip, uint16_t port);
+    void OnAckTimeout(const std::string& ip, uint16_t port);
+    void OnAck(const std::string& ip, uint16_t port);
+    bool IsSuspect(const std::string& ip, uint16_t port);
+    // cheap check before looking up single neighbors, also false once every
+    // suspect has decayed even if none of them was looked up again
+    bool HasSuspect() {
+        return HasSuspect(std::chrono::steady_clock::now());
+    }
+
+private:
+    NeighborLiveness() {}
+    ~NeighborLiveness() {}
+
+    uint64_t GetKey(const std::string& ip, uint16_t port);
+    void AddScore(
+            const std::string& ip,
+            uint16_t port,
+            double score,
+            std::chrono::steady_clock::time_point tp_now);
+    void UpdateItem(LivenessItem& item, std::chrono::steady_clock::time_point tp_now);
+    bool HasSuspect(std::chrono::steady_clock::time_point tp_now);
+    bool UpdateSuspects(std::chrono::steady_clock::time_point tp_now);
+    void MakeRoomLocked(std::chrono::steady_clock::time_point tp_now);
+
+    static const uint32_t kMaxLivenessMapSize = 10240u;
+
+    std::unordered_map<uint64_t, LivenessItem> liveness_map_;
+    std::mutex liveness_map_mutex_;
+    std::atomic<uint32_t> suspect_count_{0};
+    // steady_clock ticks by which every suspect has decayed below
+    // kSuspectScore, unless a new failure comes in
+    std::atomic<int64_t> suspect_until_{0};
+    std::atomic<uint32_t> liveness_size_{0};
+
+    DISALLOW_COPY_AND_ASSIGN(NeighborLiveness);
+};
+
+}  // namespace gossip
+
+}  // namespace top
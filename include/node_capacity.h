@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+// upload capacity a node advertises, higher class relays more
+enum UploadCapacityClass {
+    kUploadCapacityUnknown = 0,
+    kUploadCapacityLow = 1,
+    kUploadCapacityMiddle = 2,
+    kUploadCapacityHigh = 3,
+};
+
+// class a node takes in the capacity tree, one that did not advertise is
+// neither promoted nor demoted
+inline uint32_t CapacityTreeClass(uint32_t capacity_class) {
+    if (capacity_class == kUploadCapacityUnknown || capacity_class > kUploadCapacityHigh) {
+        return kUploadCapacityMiddle;
+    }
+    return capacity_class;
+}
+
+// capacity classes of shard members keyed by node hash64. filled from the
+// classes nodes advertise, so every relay sees the same values and builds
+// the same capacity aware layered tree.
+class NodeCapacityManager {
+public:
+    static NodeCapacityManager* Instance();
+    // class this node advertises to others, and places itself by
+    void SetLocalCapacity(uint32_t capacity_class);
+    uint32_t LocalCapacity() const;
+    void SetNodeCapacity(uint64_t hash64, uint32_t capacity_class);
+    void RemoveNode(uint64_t hash64);
+    uint32_t GetNodeCapacity(uint64_t hash64);
+    void GetNodesCapacity(
+            const std::vector<uint64_t>& hash64_vec,
+            std::vector<uint32_t>& capacity_vec);
+    // changes whenever any class changes, layered plans built on older
+    // versions are stale
+    uint64_t version() const {
+        return version_;
+    }
+
+private:
+    NodeCapacityManager() {}
+    ~NodeCapacityManager() {}
+
+    uint32_t GetCapacityWithLock(uint64_t hash64);
+
+    std::atomic<uint32_t> local_capacity_{kUploadCapacityUnknown};
+    std::atomic<uint64_t> version_{0};
+    std::unordered_map<uint64_t, uint32_t> capacity_map_;
+    std::mutex capacity_map_mutex_;
+
+    DISALLOW_COPY_AND_ASSIGN(NodeCapacityManager);
+};
+
+}  // namespace gossip
+
+}  // namespace top
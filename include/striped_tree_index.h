@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace top {
+
+namespace gossip {
+
+// Index math for the K trees of striped broadcast. Nodes are numbered by
+// their random_step rotated index r in [1, count], the same index the single
+// layered tree uses. Node r belongs to group r % K. Tree t lists the nodes of
+// group t first, then every other node, both in ascending r. A K-ary tree on
+// count nodes has at most (count - 1) / K interior nodes, never more than the
+// size of one group, so each node is interior in the tree of its own group
+// only and a leaf in all the others.
+
+// first rotated index of group tree_index
+inline uint32_t StripeGroupFirst(uint32_t tree_index, uint32_t k) {
+    return tree_index == 0 ? k : tree_index;
+}
+
+inline uint32_t StripeGroupSize(uint32_t tree_index, uint32_t k, uint32_t count) {
+    uint32_t first = StripeGroupFirst(tree_index, k);
+    return first > count ? 0 : (count - first) / k + 1;
+}
+
+// members of group tree_index in [1, rotated_index]
+inline uint32_t StripeGroupMembersUpTo(uint32_t rotated_index, uint32_t tree_index, uint32_t k) {
+    uint32_t first = StripeGroupFirst(tree_index, k);
+    return rotated_index < first ? 0 : (rotated_index - first) / k + 1;
+}
+
+// tree in which the node of rotated_index forwards
+inline uint32_t StripeTreeIndex(uint32_t rotated_index, uint32_t k) {
+    return k <= 1 ? 0 : rotated_index % k;
+}
+
+// position of rotated_index in tree tree_index, from 1 to count
+inline uint32_t StripedLogicalIndex(
+        uint32_t rotated_index,
+        uint32_t tree_index,
+        uint32_t k,
+        uint32_t count) {
+    if (k <= 1) {
+        return rotated_index;
+    }
+    if (rotated_index % k == tree_index) {
+        return (rotated_index - StripeGroupFirst(tree_index, k)) / k + 1;
+    }
+    return StripeGroupSize(tree_index, k, count) +
+            (rotated_index - StripeGroupMembersUpTo(rotated_index, tree_index, k));
+}
+
+// inverse of StripedLogicalIndex
+inline uint32_t StripedRotatedIndex(
+        uint32_t logical_index,
+        uint32_t tree_index,
+        uint32_t k,
+        uint32_t count) {
+    if (k <= 1) {
+        return logical_index;
+    }
+    uint32_t first = StripeGroupFirst(tree_index, k);
+    uint32_t group_size = StripeGroupSize(tree_index, k, count);
+    if (logical_index <= group_size) {
+        return first + (logical_index - 1) * k;
+    }
+    // the K - 1 values after every group member are the other nodes
+    uint32_t other_index = logical_index - group_size;
+    if (other_index < first) {
+        return other_index;
+    }
+    other_index -= first - 1;
+    return first + ((other_index - 1) / (k - 1)) * k + (other_index - 1) % (k - 1) + 1;
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+#include "xgossip/include/sync_message_codec.h"
+
+namespace top {
+
+namespace gossip {
+
+// tokens are bytes, refilled from last_time when the bucket is used
+struct SyncTokenBucket {
+    double tokens;
+    std::chrono::steady_clock::time_point last_time;
+};
+
+// Upload budget of block sync serving, one token bucket for the node and one
+// per requester, both in bytes. Also remembers a few other nodes per header
+// that should hold the block, handed out in busy replies so refused
+// requesters go elsewhere.
+class SyncAdmission {
+public:
+    SyncAdmission(
+            uint64_t global_rate,
+            uint64_t global_burst,
+            uint64_t requester_rate,
+            uint64_t requester_burst);
+    ~SyncAdmission();
+    // takes bytes from both buckets, or nothing and returns false
+    bool Admit(const std::string& ip, uint16_t port, uint64_t bytes);
+    // false when either bucket is empty, nothing is taken
+    bool HasBudget(const std::string& ip, uint16_t port);
+    void AddHolder(const std::string& header_hash, const SyncHolder& holder);
+    // up to max_count holders of header_hash other than ip:port, newest first
+    void GetHolders(
+            const std::string& header_hash,
+            const std::string& ip,
+            uint16_t port,
+            uint32_t max_count,
+            std::vector<SyncHolder>& holders);
+    void GetStat(uint64_t& admit_count, uint64_t& refuse_count, uint32_t& requester_count);
+
+private:
+    void Refill(
+            SyncTokenBucket& bucket,
+            uint64_t rate,
+            uint64_t burst,
+            std::chrono::steady_clock::time_point tp_now);
+    SyncTokenBucket& GetRequesterBucket(
+            const std::string& ip,
+            uint16_t port,
+            std::chrono::steady_clock::time_point tp_now);
+
+    const uint64_t global_rate_;
+    const uint64_t global_burst_;
+    const uint64_t requester_rate_;
+    const uint64_t requester_burst_;
+    std::mutex mutex_;
+    SyncTokenBucket global_bucket_;
+    std::unordered_map<std::string, SyncTokenBucket> requester_buckets_;
+    // holders by header hash, oldest header dropped first
+    std::unordered_map<std::string, std::vector<SyncHolder>> holder_map_;
+    std::deque<std::string> holder_order_;
+    std::atomic<uint64_t> admit_count_{ 0 };
+    std::atomic<uint64_t> refuse_count_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(SyncAdmission);
+};
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace top {
+
+namespace gossip {
+
+// Block sync messages that carry more than one header reuse the four
+// kGossipBlockSync types. Their data() is an envelope: a zero byte, "SY", a
+// kind byte, then entries of a 4 byte little endian length and the bytes.
+// A header hash never starts with a zero byte, so data() holding a single
+// header hash keeps meaning what it always did.
+enum SyncEnvelopeKind {
+    kSyncEnvelopeInvalid = 0,
+    // header hashes for ask, ack and request, GossipSyncBlockData for response
+    kSyncEnvelopeBatch = 'B',
+    // response, a block too large for one message is pulled in chunks
+    kSyncEnvelopeManifest = 'M',
+    // request for some chunks of a block
+    kSyncEnvelopeChunkRequest = 'Q',
+    // response, one chunk of a block
+    kSyncEnvelopeChunk = 'D',
+    // ack or response, the node is over its serving budget and names other holders
+    kSyncEnvelopeBusy = 'R',
+};
+
+struct SyncChunkManifest {
+    std::string header_hash;
+    uint32_t total_size;
+    uint32_t chunk_size;
+    // xhash64 of every chunk, the last chunk may be short
+    std::vector<uint64_t> chunk_hashes;
+};
+
+struct SyncChunkRequest {
+    std::string header_hash;
+    std::vector<uint32_t> chunk_indexes;
+};
+
+struct SyncChunk {
+    std::string header_hash;
+    uint32_t chunk_index;
+    std::string data;
+};
+
+struct SyncHolder {
+    std::string ip;
+    uint16_t port;
+    std::string node_id;
+};
+
+// header refused by a busy node, holders are other nodes likely to have it
+struct SyncRedirect {
+    std::string header_hash;
+    std::vector<SyncHolder> holders;
+};
+
+static const uint32_t kSyncEnvelopeHeadSize = 4u;
+static const uint32_t kSyncEnvelopeEntryHeadSize = 4u;
+
+SyncEnvelopeKind GetSyncEnvelopeKind(const std::string& data);
+void EncodeSyncEnvelope(
+        SyncEnvelopeKind kind,
+        const std::vector<std::string>& entries,
+        std::string& data);
+// false if data is not an envelope of kind or is cut short
+bool DecodeSyncEnvelope(
+        const std::string& data,
+        SyncEnvelopeKind kind,
+        std::vector<std::string>& entries);
+
+void EncodeSyncManifest(const SyncChunkManifest& manifest, std::string& data);
+bool DecodeSyncManifest(const std::string& data, SyncChunkManifest& manifest);
+void EncodeSyncChunkRequest(const SyncChunkRequest& request, std::string& data);
+bool DecodeSyncChunkRequest(const std::string& data, SyncChunkRequest& request);
+void EncodeSyncChunk(const SyncChunk& chunk, std::string& data);
+// the same bytes as EncodeSyncChunk, chunk_data copied straight into data
+void EncodeSyncChunk(
+        const std::string& header_hash,
+        uint32_t chunk_index,
+        const char* chunk_data,
+        uint32_t chunk_size,
+        std::string& data);
+bool DecodeSyncChunk(const std::string& data, SyncChunk& chunk);
+void EncodeSyncBusy(const std::vector<SyncRedirect>& redirects, std::string& data);
+bool DecodeSyncBusy(const std::string& data, std::vector<SyncRedirect>& redirects);
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "xpbase/base/top_utils.h"
+#include "xgossip/include/block_log_store.h"
+
+namespace top {
+
+namespace gossip {
+
+// what HandleSyncRequest sends for one header, built once and shared read only
+struct SyncResponseEntry {
+    // encoded GossipSyncBlockData, or the encoded manifest of a chunked block
+    std::string payload;
+    // the stored block in place, kept only for chunked blocks to cut chunks
+    // from. It holds its segment until the entry is evicted
+    BlockLogView block;
+    // the expire_time of the stored block, not served from the cache after
+    std::chrono::steady_clock::time_point expire_time{ std::chrono::steady_clock::time_point::max() };
+};
+
+typedef std::shared_ptr<const SyncResponseEntry> SyncResponseEntryPtr;
+
+// LRU of SyncResponseEntry by header hash, bounded by payload and block bytes.
+// Expired entries are a miss, DropExpired releases them and their segments
+class SyncResponseCache {
+public:
+    explicit SyncResponseCache(uint64_t max_bytes);
+    ~SyncResponseCache();
+    SyncResponseEntryPtr Get(const std::string& header_hash);
+    void Put(const std::string& header_hash, SyncResponseEntryPtr entry);
+    void Remove(const std::string& header_hash);
+    void DropExpired(std::chrono::steady_clock::time_point tp_now);
+    void GetStat(uint64_t& hit_count, uint64_t& miss_count, uint64_t& bytes);
+
+private:
+    typedef std::pair<std::string, SyncResponseEntryPtr> LruItem;
+
+    static uint64_t EntryBytes(const SyncResponseEntryPtr& entry);
+    void EraseLocked(std::unordered_map<std::string, std::list<LruItem>::iterator>::iterator iter);
+
+    const uint64_t max_bytes_;
+    uint64_t bytes_{ 0 };
+    // most recently used first
+    std::list<LruItem> lru_list_;
+    std::unordered_map<std::string, std::list<LruItem>::iterator> lru_map_;
+    std::mutex mutex_;
+    std::atomic<uint64_t> hit_count_{ 0 };
+    std::atomic<uint64_t> miss_count_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(SyncResponseCache);
+};
+
+}  // namespace gossip
+
+}  // namespace top
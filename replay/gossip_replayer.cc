@@ -0,0 +1,131 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/replay/gossip_replayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "xbase/xhash.h"
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_utils.h"
+#include "xpbase/base/check_cast.h"
+#include "xpbase/base/kad_key/platform_kadmlia_key.h"
+#include "xkad/routing_table/local_node_info.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_capture.h"
+#include "xgossip/include/gossip_filter.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace replay {
+
+GossipReplayer::GossipReplayer(const ReplayConfig& config) : config_(config) {}
+
+bool GossipReplayer::Init() {
+    std::string idtype(kadmlia::GenNodeIdType("CN", "VPN"));
+    kadmlia::LocalNodeInfoPtr local_node_info;
+    local_node_info.reset(new kadmlia::LocalNodeInfo());
+    auto kad_key = std::make_shared<base::PlatformKadmliaKey>();
+    kad_key->set_xnetwork_id(kEdgeXVPN);
+    kad_key->set_zone_id(check_cast<uint8_t>(26));
+    if (!local_node_info->Init(
+            "0.0.0.0", 0, false, false, idtype, kad_key, kad_key->xnetwork_id(), kRoleEdge)) {
+        TOP_ERROR("replay local node info init failed");
+        return false;
+    }
+    local_node_info->set_public_ip("127.0.0.1");
+    local_node_info->set_public_port(9999);
+    local_hash64_ = base::xhash64_t::digest(local_node_info->id());
+
+    transport_ = std::make_shared<ReplayTransport>();
+    routing_table_.reset(new kadmlia::RoutingTable(transport_, kadmlia::kNodeIdSize, local_node_info));
+    neighbors_ = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>();
+    for (uint32_t i = 0; i < config_.node_count; ++i) {
+        std::string id = RandomString(kadmlia::kNodeIdSize);
+        auto node_ptr = std::make_shared<kadmlia::NodeInfo>(id);
+        node_ptr->xid = id;
+        node_ptr->local_ip = "127.0.0.1";
+        node_ptr->local_port = 10000 + i;
+        node_ptr->public_ip = "127.0.0.1";
+        node_ptr->public_port = 10000 + i;
+        node_ptr->hash64 = base::xhash64_t::digest(id);
+        routing_table_->AddNode(node_ptr);
+        neighbors_->push_back(node_ptr);
+    }
+    BroadcastLayered::OnMembershipChanged();
+    context_.local_hash64 = local_hash64_;
+    context_.neighbors = neighbors_;
+    context_.routing_table = routing_table_;
+    registry_ = std::make_shared<GossipRegistry>(transport_);
+    return GossipFilter::Instance()->Init();
+}
+
+bool GossipReplayer::Forward(transport::protobuf::RoutingMessage& message) {
+    return registry_->Broadcast(context_, message);
+}
+
+bool GossipReplayer::Run(ReplayResult& result) {
+    result = ReplayResult();
+    GossipCaptureReader reader;
+    if (!reader.Open(config_.capture_path)) {
+        return false;
+    }
+
+    uint64_t first_arrive_us = 0;
+    uint64_t last_arrive_us = 0;
+    auto tp_start = std::chrono::steady_clock::now();
+    GossipCaptureRecord record;
+    while (reader.Next(record)) {
+        if (result.record_count == 0) {
+            first_arrive_us = record.arrive_us;
+        }
+        last_arrive_us = std::max(last_arrive_us, record.arrive_us);
+        ++result.record_count;
+        if (config_.speed > 0.0 && record.arrive_us > first_arrive_us) {
+            auto offset = std::chrono::microseconds(static_cast<uint64_t>(
+                    (record.arrive_us - first_arrive_us) / config_.speed));
+            std::this_thread::sleep_until(tp_start + offset);
+        }
+
+        transport::protobuf::RoutingMessage message;
+        if (!message.ParseFromArray(record.message_data, record.message_size)) {
+            ++result.parse_fail_count;
+            continue;
+        }
+        message.mutable_gossip()->set_pre_ip(record.from_ip);
+        message.mutable_gossip()->set_pre_port(record.from_port);
+        if (GossipFilter::Instance()->FilterMessage(
+                message,
+                record.from_ip,
+                record.from_port)) {
+            ++result.filtered_count;
+            continue;
+        }
+        // what wrouter does before handing the message to gossip
+        message.set_hop_num(message.hop_num() + 1);
+        if (Forward(message)) {
+            ++result.forward_count;
+            ++result.type_count[message.gossip().gossip_type()];
+        }
+    }
+
+    result.elapsed_ms = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - tp_start).count() / 1000.0;
+    result.capture_ms = (last_arrive_us - first_arrive_us) / 1000.0;
+    result.sent_packets = transport_->send_count();
+    result.sent_bytes = transport_->send_bytes();
+    return true;
+}
+
+}  // namespace replay
+
+}  // namespace gossip
+
+}  // namespace top
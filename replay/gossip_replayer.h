@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xbase/xpacket.h"
+#include "xtransport/udp_transport/udp_transport.h"
+#include "xkad/routing_table/node_info.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xgossip/include/gossip_registry.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace replay {
+
+struct ReplayConfig {
+    std::string capture_path;
+    // 0 replays as fast as possible, else recorded gaps are divided by speed
+    double speed;
+    uint32_t node_count;  // routing table size of the replaying node
+};
+
+struct ReplayResult {
+    uint64_t record_count;
+    uint64_t parse_fail_count;
+    uint64_t filtered_count;  // dropped by GossipFilter
+    uint64_t forward_count;
+    uint64_t sent_packets;
+    uint64_t sent_bytes;
+    double capture_ms;  // first to last arrival in the capture
+    double elapsed_ms;
+    std::map<uint32_t, uint64_t> type_count;  // forwarded by gossip_type
+};
+
+// UdpTransport that is never started, sends only count packets and bytes
+class ReplayTransport : public transport::UdpTransport {
+public:
+    ReplayTransport() {}
+    virtual ~ReplayTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override {
+        ++send_count_;
+        send_bytes_ += packet.get_body().size();
+        return kadmlia::kKadSuccess;
+    }
+    uint64_t send_count() const { return send_count_; }
+    uint64_t send_bytes() const { return send_bytes_; }
+
+private:
+    std::atomic<uint64_t> send_count_{ 0 };
+    std::atomic<uint64_t> send_bytes_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(ReplayTransport);
+};
+
+// Feeds a GossipCapture file through what a node does with an incoming
+// gossip message: GossipFilter, then the gossip type of the message with its
+// stop times and node selection, sending to a counting transport. The
+// routing table holds node_count made up nodes, the capture does not know
+// the real neighbors.
+class GossipReplayer {
+public:
+    explicit GossipReplayer(const ReplayConfig& config);
+    ~GossipReplayer() {}
+    bool Init();
+    bool Run(ReplayResult& result);
+
+private:
+    bool Forward(transport::protobuf::RoutingMessage& message);
+
+    ReplayConfig config_;
+    uint64_t local_hash64_{ 0 };
+    std::shared_ptr<ReplayTransport> transport_;
+    kadmlia::RoutingTablePtr routing_table_;
+    std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors_;
+    GossipContext context_;
+    std::shared_ptr<GossipRegistry> registry_;
+
+    DISALLOW_COPY_AND_ASSIGN(GossipReplayer);
+};
+
+}  // namespace replay
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_config.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/replay/gossip_replayer.h"
+#include "xgossip/tool/tool_utils.h"
+
+using top::gossip::replay::ReplayConfig;
+using top::gossip::replay::ReplayResult;
+using top::gossip::replay::GossipReplayer;
+using top::gossip::tool::GetArg;
+
+static void Usage() {
+    printf("xgossip_replay --capture=path [--speed=0] [--nodes=256]\n"
+           "speed 0 replays as fast as possible, 1 at recorded speed, 2 twice as fast\n");
+}
+
+int main(int argc, char *argv[]) {
+    ReplayConfig config;
+    config.speed = 0.0;
+    config.node_count = 256;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (GetArg(argv[i], "capture", value)) {
+            config.capture_path = value;
+        } else if (GetArg(argv[i], "speed", value)) {
+            config.speed = atof(value.c_str());
+        } else if (GetArg(argv[i], "nodes", value)) {
+            config.node_count = atoi(value.c_str());
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (config.capture_path.empty()) {
+        Usage();
+        return 1;
+    }
+
+    xinit_log("xgossip_replay.log", true, true);
+    xset_log_level(enum_xlog_level_error);
+    top::base::Config top_config;
+    top_config.Init("./conf.ut/test_routing_table.conf");
+    top::kadmlia::CreateGlobalXid(top_config);
+
+    GossipReplayer replayer(config);
+    if (!replayer.Init()) {
+        printf("replay init failed\n");
+        return 1;
+    }
+    ReplayResult result;
+    if (!replayer.Run(result)) {
+        printf("replay of %s failed\n", config.capture_path.c_str());
+        return 1;
+    }
+
+    double elapsed_s = result.elapsed_ms / 1000.0;
+    printf("records %llu, parse failed %llu, filtered %llu, forwarded %llu\n",
+            (unsigned long long)result.record_count,
+            (unsigned long long)result.parse_fail_count,
+            (unsigned long long)result.filtered_count,
+            (unsigned long long)result.forward_count);
+    printf("sent %llu packets, %llu bytes\n",
+            (unsigned long long)result.sent_packets,
+            (unsigned long long)result.sent_bytes);
+    printf("capture %.1f ms, replay %.1f ms, %.0f records/s, %.0f sends/s\n",
+            result.capture_ms,
+            result.elapsed_ms,
+            elapsed_s > 0.0 ? result.record_count / elapsed_s : 0.0,
+            elapsed_s > 0.0 ? result.sent_packets / elapsed_s : 0.0);
+    printf("forwarded by type:");
+    for (auto iter = result.type_count.begin(); iter != result.type_count.end(); ++iter) {
+        printf(" %u:%llu", iter->first, (unsigned long long)iter->second);
+    }
+    printf("\n");
+    return 0;
+}
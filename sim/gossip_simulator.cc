@@ -0,0 +1,318 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/sim/gossip_simulator.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <set>
+
+#include "xbase/xhash.h"
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_utils.h"
+#include "xpbase/base/check_cast.h"
+#include "xpbase/base/kad_key/platform_kadmlia_key.h"
+#include "xkad/routing_table/local_node_info.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace sim {
+
+int SimTransport::SendData(base::xpacket_t& packet) {
+    simulator_->OnSend(node_index_, packet);
+    return kadmlia::kKadSuccess;
+}
+
+static std::atomic<uint32_t> simulator_count{ 0 };
+
+GossipSimulator::GossipSimulator(const SimConfig& config)
+        : config_(config), run_salt_(++simulator_count), random_(config.seed) {}
+
+GossipSimulator::~GossipSimulator() {}
+
+bool GossipSimulator::CreateNode(uint32_t index, SimNode& node) {
+    std::string idtype(kadmlia::GenNodeIdType("CN", "VPN"));
+    kadmlia::LocalNodeInfoPtr local_node_info;
+    local_node_info.reset(new kadmlia::LocalNodeInfo());
+    auto kad_key = std::make_shared<base::PlatformKadmliaKey>();
+    kad_key->set_xnetwork_id(kEdgeXVPN);
+    kad_key->set_zone_id(check_cast<uint8_t>(26));
+    node.ip = "127.0.0.1";
+    node.port = kSimBasePort + index;
+    if (!local_node_info->Init(
+            "0.0.0.0", node.port, false, false, idtype, kad_key, kad_key->xnetwork_id(), kRoleEdge)) {
+        TOP_ERROR("sim node(%u) local node info init failed", index);
+        return false;
+    }
+    local_node_info->set_public_ip(node.ip);
+    local_node_info->set_public_port(node.port);
+
+    node.node_id = local_node_info->id();
+    node.hash64 = base::xhash64_t::digest(node.node_id);
+    node.online = true;
+    node.busy_until_us = 0;
+    node.transport = std::make_shared<SimTransport>(this, index);
+    node.routing_table.reset(new kadmlia::RoutingTable(
+            node.transport, kadmlia::kNodeIdSize, local_node_info));
+    node.neighbors = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>();
+    node.context.local_hash64 = node.hash64;
+    node.context.neighbors = node.neighbors;
+    node.context.routing_table = node.routing_table;
+    node.registry = std::make_shared<GossipRegistry>(node.transport);
+    if (!node.registry->Has(config_.gossip_type)) {
+        TOP_ERROR("sim gossip type(%u) not supported", config_.gossip_type);
+        return false;
+    }
+    node.recv_count = 0;
+    node.first_recv_us = 0;
+    return true;
+}
+
+bool GossipSimulator::Init() {
+    if (config_.node_count < 2 ||
+            config_.node_count > std::numeric_limits<uint16_t>::max() - kSimBasePort) {
+        TOP_ERROR("sim node count(%u) invalid", config_.node_count);
+        return false;
+    }
+
+    nodes_.resize(config_.node_count);
+    std::set<std::string> node_ids;
+    for (uint32_t i = 0; i < config_.node_count; ++i) {
+        if (!CreateNode(i, nodes_[i])) {
+            return false;
+        }
+        if (!node_ids.insert(nodes_[i].node_id).second) {
+            TOP_ERROR("sim node(%u) id not unique", i);
+            return false;
+        }
+    }
+
+    // one NodeInfo per node, shared by every routing table, full membership
+    // as in a shard network
+    std::vector<kadmlia::NodeInfoPtr> node_infos;
+    for (uint32_t i = 0; i < config_.node_count; ++i) {
+        auto node_ptr = std::make_shared<kadmlia::NodeInfo>(nodes_[i].node_id);
+        node_ptr->xid = nodes_[i].node_id;
+        node_ptr->local_ip = nodes_[i].ip;
+        node_ptr->local_port = nodes_[i].port;
+        node_ptr->public_ip = nodes_[i].ip;
+        node_ptr->public_port = nodes_[i].port;
+        node_ptr->hash64 = nodes_[i].hash64;
+        node_infos.push_back(node_ptr);
+    }
+    for (uint32_t i = 0; i < config_.node_count; ++i) {
+        for (uint32_t j = 0; j < config_.node_count; ++j) {
+            if (i == j) {
+                continue;
+            }
+            nodes_[i].routing_table->AddNode(node_infos[j]);
+            nodes_[i].neighbors->push_back(node_infos[j]);
+        }
+    }
+    BroadcastLayered::OnMembershipChanged();
+    return true;
+}
+
+uint32_t GossipSimulator::NodeMessageHash(uint32_t msg_hash, uint32_t node_index) {
+    return base::xhash32_t::digest(
+            std::to_string(msg_hash) + ":" + std::to_string(node_index) + ":" + std::to_string(run_salt_));
+}
+
+void GossipSimulator::Forward(uint32_t node_index, transport::protobuf::RoutingMessage& message) {
+    auto& node = nodes_[node_index];
+    current_msg_hash_ = message.gossip().msg_hash();
+    message.mutable_gossip()->set_msg_hash(NodeMessageHash(current_msg_hash_, node_index));
+    node.registry->Broadcast(node.context, message);
+}
+
+void GossipSimulator::OnSend(uint32_t node_index, base::xpacket_t& packet) {
+    auto& from_node = nodes_[node_index];
+    uint32_t size = packet.get_body().size();
+    ++sent_packets_;
+    sent_bytes_ += size;
+    if (size < sizeof(_xip2_header)) {
+        return;
+    }
+
+    auto message = std::make_shared<transport::protobuf::RoutingMessage>();
+    if (!message->ParseFromArray(
+            packet.get_body().data() + sizeof(_xip2_header),
+            size - sizeof(_xip2_header))) {
+        TOP_WARN("sim packet from node(%u) parse failed", node_index);
+        return;
+    }
+    // receivers see the msg_hash the origin used
+    message->mutable_gossip()->set_msg_hash(current_msg_hash_);
+
+    uint32_t to_index = packet.get_to_ip_port() - kSimBasePort;
+    if (to_index >= nodes_.size() || to_index == node_index) {
+        return;
+    }
+
+    uint64_t depart_us = now_us_;
+    if (config_.bandwidth_kbps > 0) {
+        uint64_t send_us = static_cast<uint64_t>(size) * 8000ull / config_.bandwidth_kbps;
+        from_node.busy_until_us = std::max(from_node.busy_until_us, now_us_) + send_us;
+        depart_us = from_node.busy_until_us;
+    }
+    if (config_.loss_rate > 0.0 &&
+            std::uniform_real_distribution<double>(0.0, 1.0)(random_) < config_.loss_rate) {
+        ++lost_packets_;
+        return;
+    }
+    uint64_t latency_us = config_.latency_us;
+    if (config_.jitter_us > 0) {
+        latency_us += random_() % (config_.jitter_us + 1);
+    }
+    event_queue_.push(SimEvent{
+            depart_us + latency_us,
+            event_seq_++,
+            node_index,
+            to_index,
+            message });
+}
+
+void GossipSimulator::RunBroadcast(uint32_t broadcast_index, SimResult& result) {
+    uint32_t origin = random_() % nodes_.size();
+    uint32_t online_count = 0;
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        auto& node = nodes_[i];
+        node.online = (i == origin) || config_.churn_rate <= 0.0 ||
+                std::uniform_real_distribution<double>(0.0, 1.0)(random_) >= config_.churn_rate;
+        node.busy_until_us = 0;
+        node.recv_count = 0;
+        node.first_recv_us = 0;
+        if (node.online) {
+            ++online_count;
+        }
+    }
+    now_us_ = 0;
+
+    transport::protobuf::RoutingMessage message;
+    message.set_id(random_());
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(0);
+    message.set_src_node_id(nodes_[origin].node_id);
+    message.set_des_node_id(nodes_[origin].node_id);
+    message.set_data(std::string(config_.payload_size, 'd'));
+    auto gossip_param = message.mutable_gossip();
+    gossip_param->set_neighber_count(config_.neighbor_count);
+    gossip_param->set_stop_times(config_.stop_times);
+    gossip_param->set_gossip_type(config_.gossip_type);
+    gossip_param->set_max_hop_num(kadmlia::kHopToLive);
+    gossip_param->set_evil_rate(0);
+    gossip_param->set_switch_layer_hop_num(config_.switch_layer_hop_num);
+    gossip_param->set_ign_bloomfilter_level(config_.ign_bloomfilter_level);
+    gossip_param->set_msg_hash(random_());
+    gossip_param->set_min_dis(0);
+    gossip_param->set_max_dis(0);
+    gossip_param->set_left_min(0);
+    gossip_param->set_right_max(std::numeric_limits<uint64_t>::max());
+
+    nodes_[origin].recv_count = 1;
+    Forward(origin, message);
+
+    while (!event_queue_.empty()) {
+        SimEvent event = event_queue_.top();
+        event_queue_.pop();
+        now_us_ = event.time_us;
+        auto& node = nodes_[event.to_index];
+        if (!node.online) {
+            ++lost_packets_;
+            continue;
+        }
+        ++node.recv_count;
+        if (node.recv_count == 1) {
+            node.first_recv_us = now_us_;
+            ++result.hop_histogram[event.message->hop_num() + 1];
+        } else if (config_.filter_duplicates) {
+            continue;
+        }
+
+        // what wrouter does before handing the message to gossip
+        transport::protobuf::RoutingMessage recv_message(*event.message);
+        recv_message.set_hop_num(recv_message.hop_num() + 1);
+        recv_message.mutable_gossip()->set_pre_ip(nodes_[event.from_index].ip);
+        recv_message.mutable_gossip()->set_pre_port(nodes_[event.from_index].port);
+        Forward(event.to_index, recv_message);
+    }
+
+    uint32_t reached_count = 0;
+    uint64_t recv_count = 0;
+    uint64_t duplicate_count = 0;
+    std::vector<uint64_t> recv_times;
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        auto& node = nodes_[i];
+        if (!node.online || node.recv_count == 0) {
+            continue;
+        }
+        ++reached_count;
+        if (i == origin) {
+            // copies that came back to the origin
+            recv_count += node.recv_count - 1;
+            continue;
+        }
+        recv_count += node.recv_count;
+        duplicate_count += node.recv_count - 1;
+        result.max_duplicates = std::max(result.max_duplicates, node.recv_count - 1);
+        recv_times.push_back(node.first_recv_us);
+    }
+
+    double coverage = static_cast<double>(reached_count) / online_count;
+    result.mean_coverage += coverage;
+    result.min_coverage = std::min(result.min_coverage, coverage);
+    result.amplification += static_cast<double>(recv_count) / online_count;
+    result.mean_duplicates += reached_count > 1 ?
+            static_cast<double>(duplicate_count) / (reached_count - 1) : 0.0;
+
+    // the origin counts as reached at time 0
+    uint32_t need_count = static_cast<uint32_t>(ceil(0.99 * online_count));
+    if (reached_count >= need_count) {
+        std::sort(recv_times.begin(), recv_times.end());
+        double time_99_ms = need_count <= 1 ? 0.0 : recv_times[need_count - 2] / 1000.0;
+        ++result.reach_99_count;
+        result.mean_time_99_ms += time_99_ms;
+        result.max_time_99_ms = std::max(result.max_time_99_ms, time_99_ms);
+    }
+    TOP_DEBUG("sim broadcast(%u) origin(%u) coverage(%f) recv(%llu)",
+            broadcast_index, origin, coverage, (unsigned long long)recv_count);
+}
+
+void GossipSimulator::Run(SimResult& result) {
+    result = SimResult();
+    result.broadcast_count = config_.broadcast_count;
+    result.min_coverage = 1.0;
+    sent_packets_ = 0;
+    sent_bytes_ = 0;
+    lost_packets_ = 0;
+    for (uint32_t i = 0; i < config_.broadcast_count; ++i) {
+        RunBroadcast(i, result);
+    }
+
+    if (config_.broadcast_count > 0) {
+        result.mean_coverage /= config_.broadcast_count;
+        result.amplification /= config_.broadcast_count;
+        result.mean_duplicates /= config_.broadcast_count;
+    }
+    if (result.reach_99_count > 0) {
+        result.mean_time_99_ms /= result.reach_99_count;
+    }
+    result.sent_packets = sent_packets_;
+    result.sent_bytes = sent_bytes_;
+    result.lost_packets = lost_packets_;
+}
+
+}  // namespace sim
+
+}  // namespace gossip
+
+}  // namespace top
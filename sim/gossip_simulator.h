@@ -0,0 +1,156 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "xbase/xpacket.h"
+#include "xtransport/proto/transport.pb.h"
+#include "xtransport/udp_transport/udp_transport.h"
+#include "xkad/routing_table/node_info.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xgossip/include/gossip_registry.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace sim {
+
+struct SimConfig {
+    uint32_t node_count;
+    uint32_t gossip_type;  // GossipType
+    uint32_t broadcast_count;
+    uint32_t neighbor_count;
+    uint32_t payload_size;
+    uint32_t switch_layer_hop_num;
+    uint32_t ign_bloomfilter_level;
+    uint32_t stop_times;
+    uint32_t latency_us;  // one way, plus up to jitter_us
+    uint32_t jitter_us;
+    uint32_t bandwidth_kbps;  // upload of every node, 0 for unlimited
+    double loss_rate;  // of every packet
+    double churn_rate;  // nodes offline during one broadcast, routing tables keep them
+    // only the first copy is forwarded, as GossipFilter does in wrouter
+    bool filter_duplicates;
+    uint32_t seed;
+};
+
+struct SimResult {
+    uint32_t broadcast_count;
+    double mean_coverage;  // nodes reached / online nodes
+    double min_coverage;
+    double amplification;  // packets received / online nodes
+    double mean_duplicates;  // extra copies per reached node
+    uint32_t max_duplicates;
+    uint32_t reach_99_count;  // broadcasts that reached 99% of online nodes
+    double mean_time_99_ms;  // over those broadcasts
+    double max_time_99_ms;
+    uint64_t sent_packets;
+    uint64_t sent_bytes;
+    uint64_t lost_packets;  // dropped by loss_rate or sent to an offline node
+    std::map<uint32_t, uint64_t> hop_histogram;  // hop_num of the first copy
+};
+
+class GossipSimulator;
+
+// UdpTransport of one virtual node, never started, sends go to the event queue
+class SimTransport : public transport::UdpTransport {
+public:
+    SimTransport(GossipSimulator* simulator, uint32_t node_index)
+            : simulator_(simulator), node_index_(node_index) {}
+    virtual ~SimTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override;
+
+private:
+    GossipSimulator* simulator_;
+    uint32_t node_index_;
+
+    DISALLOW_COPY_AND_ASSIGN(SimTransport);
+};
+
+// Discrete event simulation of one gossip type over node_count virtual nodes
+// in one thread. Every node runs the real broadcast classes on its own
+// routing table and transport, only time, latency, loss and churn are
+// simulated. MessageWithBloomfilter is a process wide singleton keyed by
+// msg_hash, so each node forwards under its own msg_hash, salted per
+// simulator so that runs of several types in one process start clean, and
+// the original is put back on every packet it sends.
+class GossipSimulator {
+public:
+    explicit GossipSimulator(const SimConfig& config);
+    ~GossipSimulator();
+    bool Init();
+    void Run(SimResult& result);
+    void OnSend(uint32_t node_index, base::xpacket_t& packet);
+
+private:
+    struct SimNode {
+        std::string node_id;
+        std::string ip;
+        uint16_t port;
+        uint64_t hash64;
+        bool online;
+        uint64_t busy_until_us;  // upload queue of the node
+        std::shared_ptr<SimTransport> transport;
+        kadmlia::RoutingTablePtr routing_table;
+        std::shared_ptr<std::vector<kadmlia::NodeInfoPtr>> neighbors;
+        GossipContext context;
+        std::shared_ptr<GossipRegistry> registry;
+        // this broadcast
+        uint32_t recv_count;
+        uint64_t first_recv_us;
+    };
+
+    struct SimEvent {
+        uint64_t time_us;
+        uint64_t seq;  // keeps equal times in send order
+        uint32_t from_index;
+        uint32_t to_index;
+        std::shared_ptr<const transport::protobuf::RoutingMessage> message;
+    };
+
+    struct SimEventLater {
+        bool operator()(const SimEvent& left, const SimEvent& right) const {
+            return left.time_us != right.time_us ? left.time_us > right.time_us : left.seq > right.seq;
+        }
+    };
+
+    bool CreateNode(uint32_t index, SimNode& node);
+    void RunBroadcast(uint32_t broadcast_index, SimResult& result);
+    void Forward(uint32_t node_index, transport::protobuf::RoutingMessage& message);
+    uint32_t NodeMessageHash(uint32_t msg_hash, uint32_t node_index);
+
+    static const uint16_t kSimBasePort = 20000u;
+
+    SimConfig config_;
+    // differs for every simulator in the process, goes into NodeMessageHash
+    uint32_t run_salt_;
+    std::mt19937 random_;
+    std::vector<SimNode> nodes_;
+    std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> event_queue_;
+    uint64_t now_us_{ 0 };
+    uint64_t event_seq_{ 0 };
+    // msg_hash of the broadcast being forwarded, before the per node rewrite
+    uint32_t current_msg_hash_{ 0 };
+    uint64_t sent_packets_{ 0 };
+    uint64_t sent_bytes_{ 0 };
+    uint64_t lost_packets_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(GossipSimulator);
+};
+
+}  // namespace sim
+
+}  // namespace gossip
+
+}  // namespace top
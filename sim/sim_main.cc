@@ -0,0 +1,135 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "xpbase/base/top_log.h"
+#include "xpbase/base/top_config.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/sim/gossip_simulator.h"
+#include "xgossip/tool/tool_utils.h"
+
+using top::gossip::sim::SimConfig;
+using top::gossip::sim::SimResult;
+using top::gossip::sim::GossipSimulator;
+using top::gossip::tool::GossipTypeName;
+using top::gossip::tool::GetArg;
+using top::gossip::tool::GetGossipTypes;
+using top::gossip::tool::PrintGossipTypeUsage;
+
+static void Usage() {
+    printf("xgossip_sim [--nodes=1000] [--type=0] [--broadcasts=20] [--neighbors=3]\n"
+           "            [--payload=1024] [--switch_layer=2] [--ign_bloomfilter=1] [--stop_times=3]\n"
+           "            [--latency_ms=50] [--jitter_ms=20] [--bandwidth_kbps=0] [--loss=0]\n"
+           "            [--churn=0] [--forward_duplicates=0] [--seed=1]\n");
+    PrintGossipTypeUsage();
+}
+
+int main(int argc, char *argv[]) {
+    SimConfig config;
+    config.node_count = 1000;
+    config.gossip_type = 0;
+    config.broadcast_count = 20;
+    config.neighbor_count = 3;
+    config.payload_size = 1024;
+    config.switch_layer_hop_num = top::gossip::kGossipSwitchLayerCount;
+    config.ign_bloomfilter_level = top::gossip::kGossipBloomfilterIgnoreLevel;
+    config.stop_times = top::gossip::kGossipSendoutMaxTimes;
+    config.latency_us = 50 * 1000;
+    config.jitter_us = 20 * 1000;
+    config.bandwidth_kbps = 0;
+    config.loss_rate = 0.0;
+    config.churn_rate = 0.0;
+    config.filter_duplicates = true;
+    config.seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (GetArg(argv[i], "nodes", value)) {
+            config.node_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "type", value)) {
+            config.gossip_type = atoi(value.c_str());
+        } else if (GetArg(argv[i], "broadcasts", value)) {
+            config.broadcast_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "neighbors", value)) {
+            config.neighbor_count = atoi(value.c_str());
+        } else if (GetArg(argv[i], "payload", value)) {
+            config.payload_size = atoi(value.c_str());
+        } else if (GetArg(argv[i], "switch_layer", value)) {
+            config.switch_layer_hop_num = atoi(value.c_str());
+        } else if (GetArg(argv[i], "ign_bloomfilter", value)) {
+            config.ign_bloomfilter_level = atoi(value.c_str());
+        } else if (GetArg(argv[i], "stop_times", value)) {
+            config.stop_times = atoi(value.c_str());
+        } else if (GetArg(argv[i], "latency_ms", value)) {
+            config.latency_us = atof(value.c_str()) * 1000;
+        } else if (GetArg(argv[i], "jitter_ms", value)) {
+            config.jitter_us = atof(value.c_str()) * 1000;
+        } else if (GetArg(argv[i], "bandwidth_kbps", value)) {
+            config.bandwidth_kbps = atoi(value.c_str());
+        } else if (GetArg(argv[i], "loss", value)) {
+            config.loss_rate = atof(value.c_str());
+        } else if (GetArg(argv[i], "churn", value)) {
+            config.churn_rate = atof(value.c_str());
+        } else if (GetArg(argv[i], "forward_duplicates", value)) {
+            config.filter_duplicates = (atoi(value.c_str()) == 0);
+        } else if (GetArg(argv[i], "seed", value)) {
+            config.seed = atoi(value.c_str());
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+
+    xinit_log("xgossip_sim.log", true, true);
+    xset_log_level(enum_xlog_level_error);
+    top::base::Config top_config;
+    top_config.Init("./conf.ut/test_routing_table.conf");
+    top::kadmlia::CreateGlobalXid(top_config);
+
+    std::vector<uint32_t> gossip_types;
+    GetGossipTypes(config.gossip_type, gossip_types);
+
+    printf("nodes %u, broadcasts %u, neighbors %u, payload %u, latency %u+%u us, loss %.3f, churn %.3f\n",
+            config.node_count, config.broadcast_count, config.neighbor_count, config.payload_size,
+            config.latency_us, config.jitter_us, config.loss_rate, config.churn_rate);
+    printf("%-20s %9s %9s %9s %9s %7s %11s %11s %12s %12s\n",
+            "type", "coverage", "min_cov", "amplify", "dup/node", "max_dup",
+            "reach_99", "t99_ms", "t99_max_ms", "sent_pkts");
+    for (auto iter = gossip_types.begin(); iter != gossip_types.end(); ++iter) {
+        // same seed, same origins, churn and losses for every type. Each
+        // simulator salts its msg_hash, nothing carries over between types
+        config.gossip_type = *iter;
+        GossipSimulator simulator(config);
+        if (!simulator.Init()) {
+            printf("%-20s init failed\n", GossipTypeName(*iter));
+            return 1;
+        }
+        SimResult result;
+        simulator.Run(result);
+        printf("%-20s %9.4f %9.4f %9.3f %9.3f %7u %6u/%-4u %11.1f %12.1f %12llu\n",
+                GossipTypeName(*iter),
+                result.mean_coverage,
+                result.min_coverage,
+                result.amplification,
+                result.mean_duplicates,
+                result.max_duplicates,
+                result.reach_99_count,
+                result.broadcast_count,
+                result.mean_time_99_ms,
+                result.max_time_99_ms,
+                (unsigned long long)result.sent_packets);
+        printf("%-20s hops:", "");
+        for (auto hop_iter = result.hop_histogram.begin(); hop_iter != result.hop_histogram.end(); ++hop_iter) {
+            printf(" %u:%llu", hop_iter->first, (unsigned long long)hop_iter->second);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/async_header_block_data.h"
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+AsyncHeaderBlockData::AsyncHeaderBlockData(
+        std::shared_ptr<HeaderBlockData> header_block_data,
+        uint32_t thread_count,
+        uint32_t max_read_backlog,
+        uint32_t max_write_backlog)
+        : header_block_data_(header_block_data),
+          read_queue_(max_read_backlog),
+          write_queue_(max_write_backlog) {
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        threads_.push_back(std::thread(&AsyncHeaderBlockData::WorkerLoop, std::ref(read_queue_)));
+    }
+    threads_.push_back(std::thread(&AsyncHeaderBlockData::WorkerLoop, std::ref(write_queue_)));
+}
+
+AsyncHeaderBlockData::~AsyncHeaderBlockData() {
+    // both queues are drained before the workers return
+    Stop(read_queue_);
+    Stop(write_queue_);
+    for (auto iter = threads_.begin(); iter != threads_.end(); ++iter) {
+        iter->join();
+    }
+}
+
+bool AsyncHeaderBlockData::AsyncGetData(const std::string& header_hash, GetCallback callback) {
+    auto header_block_data = header_block_data_;
+    return Push(read_queue_, [header_block_data, header_hash, callback]() {
+        std::string block;
+        bool found = header_block_data->GetDataIfPresent(header_hash, block);
+        callback(found, block);
+    });
+}
+
+bool AsyncHeaderBlockData::AsyncAddData(
+        const std::string& header_hash,
+        const std::string& block,
+        Task callback) {
+    auto header_block_data = header_block_data_;
+    return Push(write_queue_, [header_block_data, header_hash, block, callback]() {
+        header_block_data->AddData(header_hash, block);
+        if (callback) {
+            callback();
+        }
+    });
+}
+
+bool AsyncHeaderBlockData::Post(Task task) {
+    return Push(read_queue_, task);
+}
+
+uint32_t AsyncHeaderBlockData::read_backlog() {
+    return Backlog(read_queue_);
+}
+
+uint32_t AsyncHeaderBlockData::write_backlog() {
+    return Backlog(write_queue_);
+}
+
+bool AsyncHeaderBlockData::Push(TaskQueue& queue, Task task) {
+    {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.stop || queue.tasks.size() >= queue.max_backlog) {
+            ++queue.shed_count;
+            TOP_WARN("header block data backlog full(%u), shed task", queue.max_backlog);
+            return false;
+        }
+        queue.tasks.push_back(task);
+    }
+    queue.cond.notify_one();
+    return true;
+}
+
+uint32_t AsyncHeaderBlockData::Backlog(TaskQueue& queue) {
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    return queue.tasks.size();
+}
+
+void AsyncHeaderBlockData::Stop(TaskQueue& queue) {
+    {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        queue.stop = true;
+    }
+    queue.cond.notify_all();
+}
+
+void AsyncHeaderBlockData::WorkerLoop(TaskQueue& queue) {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.cond.wait(lock, [&queue]() { return queue.stop || !queue.tasks.empty(); });
+            if (queue.tasks.empty()) {
+                return;
+            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/block_log_store.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+// key size and value size in front of every entry
+static const uint32_t kEntryHeadSize = 8u;
+
+BlockLogSegment::BlockLogSegment(
+        uint64_t id,
+        uint32_t capacity,
+        const std::string& path,
+        std::chrono::steady_clock::time_point seal_time,
+        std::chrono::steady_clock::time_point expire_time)
+        : id_(id),
+          capacity_(capacity),
+          path_(path),
+          seal_time_(seal_time),
+          expire_time_(expire_time) {
+    if (!path_.empty()) {
+        fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ >= 0 && ftruncate(fd_, capacity_) == 0) {
+            void* addr = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (addr != MAP_FAILED) {
+                base_ = static_cast<char*>(addr);
+                return;
+            }
+        }
+        TOP_WARN("block log segment %s mmap failed, keep in memory", path_.c_str());
+        if (fd_ >= 0) {
+            close(fd_);
+            unlink(path_.c_str());
+            fd_ = -1;
+        }
+    }
+    memory_.resize(capacity_);
+    base_ = memory_.data();
+}
+
+BlockLogSegment::~BlockLogSegment() {
+    if (fd_ < 0) {
+        return;
+    }
+    munmap(base_, capacity_);
+    close(fd_);
+    unlink(path_.c_str());
+}
+
+bool BlockLogSegment::Append(
+        const std::string& key,
+        const char* data,
+        uint32_t size,
+        uint32_t& value_offset) {
+    uint64_t entry_size = static_cast<uint64_t>(kEntryHeadSize) + key.size() + size;
+    if (used_ + entry_size > capacity_) {
+        return false;
+    }
+    uint32_t key_size = key.size();
+    char* pos = base_ + used_;
+    memcpy(pos, &key_size, sizeof(key_size));
+    memcpy(pos + sizeof(key_size), &size, sizeof(size));
+    memcpy(pos + kEntryHeadSize, key.data(), key_size);
+    value_offset = used_ + kEntryHeadSize + key_size;
+    memcpy(base_ + value_offset, data, size);
+    used_ += entry_size;
+    keys_.push_back(key);
+    return true;
+}
+
+BlockLogStore::BlockLogStore(const std::string& dir, uint32_t segment_size, uint32_t ttl_ms)
+        : dir_(dir),
+          segment_size_(segment_size),
+          ttl_(ttl_ms),
+          seal_period_(ttl_ms / 4) {}
+
+BlockLogStore::~BlockLogStore() {}
+
+BlockLogSegmentPtr BlockLogStore::NewSegment(
+        uint32_t capacity,
+        std::chrono::steady_clock::time_point tp_now) {
+    uint64_t id = next_segment_id_++;
+    std::string path;
+    if (!dir_.empty()) {
+        path = dir_ + "/gossip_block_" + std::to_string(getpid()) + "_" + std::to_string(id) + ".log";
+    }
+    auto segment = std::make_shared<BlockLogSegment>(
+            id,
+            capacity,
+            path,
+            tp_now + seal_period_,
+            tp_now + seal_period_ + ttl_);
+    segments_.push_back(segment);
+    return segment;
+}
+
+void BlockLogStore::Put(const std::string& key, const std::string& value) {
+    auto tp_now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    DropExpiredLocked(tp_now);
+
+    uint64_t entry_size = static_cast<uint64_t>(kEntryHeadSize) + key.size() + value.size();
+    if (entry_size > 0xffffffffull) {
+        return;
+    }
+    BlockLogSegmentPtr segment;
+    if (!segments_.empty() && segments_.back()->seal_time() > tp_now) {
+        segment = segments_.back();
+    }
+    uint32_t value_offset = 0;
+    if (!segment || !segment->Append(key, value.data(), value.size(), value_offset)) {
+        // an entry larger than segment_size_ gets a segment of its own size
+        segment = NewSegment(std::max<uint64_t>(segment_size_, entry_size), tp_now);
+        segment->Append(key, value.data(), value.size(), value_offset);
+    }
+    index_map_[key] = Location{ segment->id(), value_offset, static_cast<uint32_t>(value.size()) };
+}
+
+BlockLogSegmentPtr BlockLogStore::FindSegment(uint64_t segment_id) {
+    // ids are consecutive from the front
+    if (segments_.empty() || segment_id < segments_.front()->id()) {
+        return nullptr;
+    }
+    uint64_t pos = segment_id - segments_.front()->id();
+    if (pos >= segments_.size()) {
+        return nullptr;
+    }
+    return segments_[pos];
+}
+
+bool BlockLogStore::Get(const std::string& key, BlockLogView& view) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = index_map_.find(key);
+    if (iter == index_map_.end()) {
+        return false;
+    }
+    auto segment = FindSegment(iter->second.segment_id);
+    if (!segment || segment->expire_time() <= std::chrono::steady_clock::now()) {
+        return false;
+    }
+    view.segment = segment;
+    view.data = segment->At(iter->second.offset);
+    view.size = iter->second.size;
+    view.expire_time = segment->expire_time();
+    return true;
+}
+
+bool BlockLogStore::Has(const std::string& key) {
+    BlockLogView view;
+    return Get(key, view);
+}
+
+void BlockLogStore::Remove(const std::string& key) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    index_map_.erase(key);
+}
+
+void BlockLogStore::DropExpired() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    DropExpiredLocked(std::chrono::steady_clock::now());
+}
+
+void BlockLogStore::DropExpiredLocked(std::chrono::steady_clock::time_point tp_now) {
+    while (!segments_.empty() && segments_.front()->expire_time() <= tp_now) {
+        auto& segment = segments_.front();
+        for (auto iter = segment->keys().begin(); iter != segment->keys().end(); ++iter) {
+            auto index_iter = index_map_.find(*iter);
+            // a later Put of the key lives in a newer segment
+            if (index_iter != index_map_.end() && index_iter->second.segment_id == segment->id()) {
+                index_map_.erase(index_iter);
+            }
+        }
+        // readers still holding a view keep the bytes until they let go
+        segments_.pop_front();
+    }
+}
+
+void BlockLogStore::GetStat(uint32_t& segment_count, uint32_t& entry_count, uint64_t& bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    segment_count = segments_.size();
+    entry_count = index_map_.size();
+    bytes = 0;
+    for (auto iter = segments_.begin(); iter != segments_.end(); ++iter) {
+        bytes += (*iter)->used();
+    }
+}
+
+}  // namespace gossip
+
+}  // namespace top
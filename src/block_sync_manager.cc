@@ -4,6 +4,11 @@
 
 #include "xgossip/include/block_sync_manager.h"
 
+#include <string.h>
+
+#include <map>
+#include <set>
+
 #include "xpbase/base/top_log.h"
 #include "xpbase/base/kad_key/get_kadmlia_key.h"
 #include "xtransport/transport_message_register.h"
@@ -11,8 +16,12 @@
 #include "xkad/routing_table/routing_table.h"
 #include "xwrouter/register_routing_table.h"
 #include "xwrouter/message_handler/wrouter_message_handler.h"
+#include "xgossip/include/gossip_metrics.h"
 #include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/neighbor_liveness.h"
+#include "xgossip/include/sync_message_codec.h"
 #include "xutility/xhash.h"
+#include "xbase/xhash.h"
 #include "xpbase/base/redis_client.h"
 #include "xpbase/base/top_utils.h"
 #include "xwrouter/xwrouter.h"
@@ -22,10 +31,96 @@ namespace top {
 namespace gossip {
 
 static const uint32_t kMaxBlockQueueSize = 1024u;
-static const uint32_t kCheckHeaderHashPeriod = 1000 * 1000;  // 1s
+static const uint32_t kCheckHeaderHashPeriod = 100 * 1000;  // 100ms
 static const uint32_t kSyncAskNeighborCount = 6u;  // random ask 3 neighbors who has block
 static const uint32_t kHeaderSavePeriod = 60 * 1000;  // keep 30s
 static const uint32_t kHeaderRequestedPeriod = 2 * 1000;  // request 3s
+static const uint32_t kHeaderFetchedKeepPeriod = 5 * 1000;  // drop late responses 5s
+static const uint32_t kSyncMaxSourceCount = 8u;
+// hedge to a second acker after srtt + 4 * rttvar, within these bounds
+static const uint32_t kMinHedgeTimeout = 20 * 1000;  // 20ms in us
+static const uint32_t kDefaultHedgeTimeout = 300 * 1000;  // 300ms in us, before any sample
+static const uint32_t kMaxSyncBatchCount = 256u;  // header hashes in one ask, ack or request
+static const uint32_t kMaxSyncResponseSize = 64 * 1024;  // block bytes in one batched response
+static const uint32_t kSyncChunkSize = 16 * 1024;  // larger blocks are pulled in chunks
+static const uint32_t kMaxSyncChunkSize = 64 * 1024;
+static const uint32_t kSyncChunkWindow = 16u;  // chunks in flight per block
+static const uint32_t kMaxSyncBlockSize = 64 * 1024 * 1024;
+static const uint32_t kSyncWorkerCount = 2u;  // threads doing ledger reads, writes have their own
+static const uint32_t kMaxSyncBacklog = 1024u;  // waiting requests before shedding
+static const uint32_t kMaxSyncWriteBacklog = 4096u;  // waiting block writes before shedding
+static const uint32_t kSyncRedirectHolderCount = 4u;  // holders named in a busy reply
+
+// header hashes from begin, up to kMaxSyncBatchCount, in a batch envelope.
+// A peer that may run the old protocol gets a single hash as it is instead
+static std::string EncodeSyncHeaders(const std::vector<std::string>& header_hashes, uint32_t begin) {
+    uint32_t end = std::min<uint32_t>(header_hashes.size(), begin + kMaxSyncBatchCount);
+    std::string data;
+    EncodeSyncEnvelope(
+            kSyncEnvelopeBatch,
+            std::vector<std::string>(header_hashes.begin() + begin, header_hashes.begin() + end),
+            data);
+    return data;
+}
+
+static void BuildSyncManifest(
+        const std::string& header_hash,
+        const BlockLogView& block,
+        SyncChunkManifest& manifest) {
+    manifest.header_hash = header_hash;
+    manifest.total_size = block.size;
+    manifest.chunk_size = kSyncChunkSize;
+    manifest.chunk_hashes.clear();
+    for (uint32_t pos = 0; pos < block.size; pos += kSyncChunkSize) {
+        manifest.chunk_hashes.push_back(base::xhash64_t::digest(
+                block.data + pos,
+                std::min(kSyncChunkSize, block.size - pos)));
+    }
+}
+
+// the stored bytes are copied once, into the message
+static std::string EncodeSyncBlock(const std::string& header_hash, const BlockLogView& block) {
+    transport::protobuf::GossipSyncBlockData gossip_data;
+    gossip_data.set_header_hash(header_hash);
+    gossip_data.set_block(block.data, block.size); // get the whole message stored
+    return gossip_data.SerializeAsString();
+}
+
+// sources of a request round that ran out without an answer: the requested
+// ackers, or the holders with chunks still in flight
+static void GetOwingSources(const SyncHeaderRecord& record, std::vector<SyncSource>& sources) {
+    if (record.transfer) {
+        auto& transfer = *record.transfer;
+        std::vector<bool> owing(transfer.holders.size(), false);
+        for (uint32_t i = 0; i < transfer.chunk_states.size(); ++i) {
+            if (transfer.chunk_states[i] == kSyncChunkInFlight) {
+                owing[transfer.chunk_holders[i]] = true;
+            }
+        }
+        for (uint32_t i = 0; i < owing.size(); ++i) {
+            if (owing[i]) {
+                sources.push_back(transfer.holders[i]);
+            }
+        }
+        return;
+    }
+    if (record.state != kSyncHeaderRequested) {
+        return;
+    }
+    for (auto iter = record.sources.begin(); iter != record.sources.end(); ++iter) {
+        if (iter->requested) {
+            sources.push_back(*iter);
+        }
+    }
+}
+
+static bool DecodeSyncHeaders(const std::string& data, std::vector<std::string>& header_hashes) {
+    if (GetSyncEnvelopeKind(data) == kSyncEnvelopeBatch) {
+        return DecodeSyncEnvelope(data, kSyncEnvelopeBatch, header_hashes) && !header_hashes.empty();
+    }
+    header_hashes.push_back(data);
+    return true;
+}
 
 BlockSyncManager::BlockSyncManager() {
     wrouter::WrouterRegisterMessageHandler(kGossipBlockSyncAsk, [this](
@@ -82,14 +177,15 @@ void BlockSyncManager::NewBroadcastMessage(transport::protobuf::RoutingMessage&
         TOP_DEBUG("add block message: id(%d) header_hash(%s)",
                 message.id(),
                 HexEncode(message.gossip().header_hash()).c_str());
-        header_block_data_->AddData(message.gossip().header_hash(), message.SerializeAsString());
+        async_header_block_data_->AsyncAddData(
+                message.gossip().header_hash(),
+                message.SerializeAsString(),
+                nullptr);
+        // the block came with gossip, stop syncing it
+        RemoveHeaderBlock(message.gossip().header_hash());
         return;
     }
 
-    if (HeaderHashExists(message.gossip().header_hash())) {
-        TOP_DEBUG("blockmessage header hash already have");
-        return;
-    }
     uint64_t des_service_type;
     if (message.has_is_root() && message.is_root()) {
         des_service_type = kRoot;
@@ -97,9 +193,12 @@ void BlockSyncManager::NewBroadcastMessage(transport::protobuf::RoutingMessage&
         des_service_type = GetRoutingServiceType(message.des_node_id());
     }
 
+    // the previous hop announced the header, likely has the block
     AddHeaderHashToQueue(
             message.gossip().header_hash(),
-            des_service_type);
+            des_service_type,
+            message.gossip().pre_ip(),
+            message.gossip().pre_port());
 
 }
 
@@ -107,95 +206,493 @@ bool BlockSyncManager::DataExists(const std::string& header_hash) {
     return header_block_data_->HasData(header_hash);
 }
 
-bool BlockSyncManager::HeaderHashExists(const std::string& header_hash) {
-    std::unique_lock<std::mutex> lock(block_map_mutex_);
-    auto iter = block_map_.find(header_hash);
-    if (iter != block_map_.end()) {
-        return true;
+void BlockSyncManager::GetLockWaitStat(LockWaitStat& stat) {
+    for (uint32_t i = 0; i < kSyncShardCount; ++i) {
+        header_shards_[i].mutex.GetStat(stat);
     }
-    return false;
+}
+
+SyncHeaderKey BlockSyncManager::GetHeaderKey(const std::string& header_hash) {
+    return base::xhash64_t::digest(header_hash);
+}
+
+SyncHeaderShard& BlockSyncManager::GetShard(SyncHeaderKey key) {
+    return header_shards_[key % kSyncShardCount];
+}
+
+void BlockSyncManager::SetDeadline(
+        SyncHeaderShard& shard,
+        SyncHeaderKey key,
+        SyncHeaderRecord& record,
+        std::chrono::steady_clock::time_point time_point) {
+    // the queued entry is still the live one
+    if (record.deadline == time_point) {
+        return;
+    }
+    record.deadline = time_point;
+    shard.deadline_queue.push(SyncDeadline{ time_point, key });
 }
 
 void BlockSyncManager::AddHeaderHashToQueue(
         const std::string& header_hash,
-        uint64_t service_type) {
-    std::unique_lock<std::mutex> lock(block_map_mutex_);
-    block_map_.insert(std::make_pair(
-            header_hash,
-            std::make_shared<SyncBlockItem>(SyncBlockItem{
-            service_type,
-            header_hash,
-            std::chrono::steady_clock::now() +
-            std::chrono::milliseconds(kHeaderSavePeriod) })));
+        uint64_t service_type,
+        const std::string& announcer_ip,
+        uint16_t announcer_port) {
+    auto tp_now = std::chrono::steady_clock::now();
+    auto key = GetHeaderKey(header_hash);
+    auto& shard = GetShard(key);
+    std::unique_lock<LockWaitMutex> lock(shard.mutex);
+    auto ret = shard.header_map.insert(std::make_pair(key, SyncHeaderRecord()));
+    auto& record = ret.first->second;
+    if (ret.second) {
+        record.header_hash = header_hash;
+        record.routing_service_type = service_type;
+        record.state = kSyncHeaderAnnounced;
+        record.retry_count = 0;
+        record.request_count = 0;
+        record.expire_time = tp_now + std::chrono::milliseconds(kHeaderSavePeriod);
+        // ask at the next check
+        SetDeadline(shard, key, record, tp_now);
+    } else if (record.header_hash != header_hash) {
+        return;
+    }
+
+    if (announcer_ip.empty() ||
+            record.sources.size() >= kSyncMaxSourceCount ||
+            FindSource(record, announcer_ip, announcer_port) != nullptr) {
+        return;
+    }
+    record.sources.push_back(SyncSource{
+            announcer_ip,
+            announcer_port,
+            "",
+            false,
+            false });
+}
+
+SyncSource* BlockSyncManager::FindSource(
+        SyncHeaderRecord& record,
+        const std::string& ip,
+        uint16_t port) {
+    for (auto iter = record.sources.begin(); iter != record.sources.end(); ++iter) {
+        if (iter->ip == ip && iter->port == port) {
+            return &(*iter);
+        }
+    }
+    return nullptr;
+}
+
+std::chrono::microseconds BlockSyncManager::HedgeTimeout() {
+    std::unique_lock<std::mutex> lock(rtt_mutex_);
+    if (srtt_us_ == 0) {
+        return std::chrono::microseconds(kDefaultHedgeTimeout);
+    }
+    uint64_t timeout = srtt_us_ + 4 * rttvar_us_;
+    timeout = std::max<uint64_t>(timeout, kMinHedgeTimeout);
+    timeout = std::min<uint64_t>(timeout, kHeaderRequestedPeriod * 1000ull);
+    return std::chrono::microseconds(timeout);
+}
+
+void BlockSyncManager::UpdateResponseTime(std::chrono::microseconds response_time) {
+    uint64_t sample = std::max<int64_t>(response_time.count(), 1);
+    std::unique_lock<std::mutex> lock(rtt_mutex_);
+    if (srtt_us_ == 0) {
+        srtt_us_ = sample;
+        rttvar_us_ = sample / 2;
+        return;
+    }
+    uint64_t diff = srtt_us_ > sample ? srtt_us_ - sample : sample - srtt_us_;
+    rttvar_us_ = (3 * rttvar_us_ + diff) / 4;
+    srtt_us_ = (7 * srtt_us_ + sample) / 8;
 }
 
 void BlockSyncManager::SetRoutingTablePtr(kadmlia::RoutingTablePtr& routing_table) {
     routing_table_ = routing_table;
 }
 
-void BlockSyncManager::SendSyncAsk(std::shared_ptr<SyncBlockItem>& sync_item) {
-	TOP_INFO("SendSyncAsk: %d, header_hash:%s",sync_item->routing_service_type,HexEncode(sync_item->header_hash).c_str());
-    auto routing = wrouter::GetRoutingTable(sync_item->routing_service_type);
+void BlockSyncManager::SendSyncAsk(
+        const std::vector<std::string>& header_hashes,
+        uint64_t service_type,
+        const std::vector<SyncSource>& announcers) {
+	TOP_INFO("SendSyncAsk: %d, header count:%d",service_type,header_hashes.size());
+    auto routing = wrouter::GetRoutingTable(service_type);
     if (!routing) {
-		TOP_INFO("no routing table:%d", sync_item->routing_service_type);
+		TOP_INFO("no routing table:%d", service_type);
         return;
     }
     assert(routing);
-    transport::protobuf::RoutingMessage pbft_message;
-    routing->SetFreqMessage(pbft_message);
-    pbft_message.set_type(kGossipBlockSyncAsk);
-    pbft_message.set_id(kadmlia::CallbackManager::MessageId());
-    pbft_message.set_data(sync_item->header_hash);
-	pbft_message.set_src_service_type(sync_item->routing_service_type);
-	
-    std::set<kadmlia::NodeInfoPtr> asked_nodes;
-    for (uint32_t i = 0; i < kSyncAskNeighborCount; ++i) {
+
+    // neighbors that announced the header first, then distinct random ones
+    std::vector<kadmlia::NodeInfoPtr> ask_nodes;
+    if (!announcers.empty()) {
+        std::vector<kadmlia::NodeInfoPtr> nodes;
+        uint32_t max_index = routing->nodes_size();
+        routing->GetRangeNodes(0, max_index, nodes);
+        for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+            for (auto src_iter = announcers.begin(); src_iter != announcers.end(); ++src_iter) {
+                if ((*iter)->public_ip == src_iter->ip && (*iter)->public_port == src_iter->port) {
+                    ask_nodes.push_back(*iter);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::set<kadmlia::NodeInfoPtr> asked_nodes(ask_nodes.begin(), ask_nodes.end());
+    for (uint32_t i = 0; i < 2 * kSyncAskNeighborCount && ask_nodes.size() < kSyncAskNeighborCount; ++i) {
         auto node_ptr = routing->GetRandomNode();
         if (!node_ptr) {
-            return;
+            break;
         }
 
-        auto iter = asked_nodes.find(node_ptr);
-        if (iter != asked_nodes.end()) {
+        if (!asked_nodes.insert(node_ptr).second) {
             continue;
         }
-        pbft_message.set_des_node_id(node_ptr->node_id);
-        routing->SendData(pbft_message, node_ptr->public_ip, node_ptr->public_port);
-		TOP_DEBUG("send sync ask: %s,%d", node_ptr->public_ip.c_str(), node_ptr->public_port);
+        ask_nodes.push_back(node_ptr);
     }
 
-    TOP_DEBUG("[gossip_sync]send out ask,%d[%s].", kGossipBlockSyncAsk, HexEncode(pbft_message.data()).c_str());
+    GossipMetrics::Instance()->AddSyncAsk(header_hashes.size());
+    for (auto iter = ask_nodes.begin(); iter != ask_nodes.end(); ++iter) {
+        // one batch on top of the single asks tells a new peer that this
+        // node speaks envelopes, an old one finds no such header and stays quiet
+        if (header_hashes.size() > 1 && !IsEnvelopePeer((*iter)->public_ip, (*iter)->public_port)) {
+            transport::protobuf::RoutingMessage pbft_message;
+            routing->SetFreqMessage(pbft_message);
+            pbft_message.set_type(kGossipBlockSyncAsk);
+            pbft_message.set_id(kadmlia::CallbackManager::MessageId());
+            pbft_message.set_des_node_id((*iter)->node_id);
+            pbft_message.set_data(EncodeSyncHeaders(header_hashes, 0));
+            pbft_message.set_src_service_type(service_type);
+            routing->SendData(pbft_message, (*iter)->public_ip, (*iter)->public_port);
+        }
+        SendSyncHeaders(
+                routing,
+                kGossipBlockSyncAsk,
+                service_type,
+                (*iter)->node_id,
+                (*iter)->public_ip,
+                (*iter)->public_port,
+                header_hashes);
+        TOP_DEBUG("send sync ask: %s,%d", (*iter)->public_ip.c_str(), (*iter)->public_port);
+    }
+
+    TOP_DEBUG("[gossip_sync]send out ask,%d[%s].", kGossipBlockSyncAsk, HexEncode(header_hashes.front()).c_str());
 }
 
-void BlockSyncManager::CheckHeaderHashQueue() {
-    std::map<std::string, std::shared_ptr<SyncBlockItem>> block_map;
-    {
-        std::unique_lock<std::mutex> lock(block_map_mutex_);
-        block_map = block_map_;
+void BlockSyncManager::SendSyncRequest(
+        const std::vector<std::string>& header_hashes,
+        uint64_t service_type,
+        const SyncSource& source) {
+    auto routing = wrouter::GetRoutingTable(service_type);
+    if (!routing) {
+		TOP_INFO("no routing table:%d", service_type);
+        return;
+    }
+    assert(routing);
+    SendSyncHeaders(
+            routing,
+            kGossipBlockSyncRequest,
+            service_type,
+            source.node_id,
+            source.ip,
+            source.port,
+            header_hashes);
+    TOP_DEBUG("[gossip_sync]send request[%s] count %d to %s:%d.",
+            HexEncode(header_hashes.front()).c_str(),
+            header_hashes.size(),
+            source.ip.c_str(),
+            source.port);
+}
+
+void BlockSyncManager::SendSyncHeaders(
+        kadmlia::RoutingTablePtr& routing,
+        uint32_t message_type,
+        uint64_t service_type,
+        const std::string& des_node_id,
+        const std::string& ip,
+        uint16_t port,
+        const std::vector<std::string>& header_hashes) {
+    // batches ignored by an old peer would only time out, it gets one header a message
+    bool envelope = IsEnvelopePeer(ip, port);
+    uint32_t step = envelope ? kMaxSyncBatchCount : 1u;
+    for (uint32_t begin = 0; begin < header_hashes.size(); begin += step) {
+        transport::protobuf::RoutingMessage pbft_message;
+        routing->SetFreqMessage(pbft_message);
+        pbft_message.set_type(message_type);
+        pbft_message.set_id(kadmlia::CallbackManager::MessageId());
+        pbft_message.set_des_node_id(des_node_id);
+        pbft_message.set_data(envelope ? EncodeSyncHeaders(header_hashes, begin) : header_hashes[begin]);
+        pbft_message.set_src_service_type(service_type);
+        routing->SendData(pbft_message, ip, port);
+    }
+}
+
+void BlockSyncManager::AddEnvelopePeer(const std::string& ip, uint16_t port) {
+    std::unique_lock<std::mutex> lock(envelope_peers_mutex_);
+    if (envelope_peers_.size() >= kMaxEnvelopePeerCount) {
+        // learned again from the next envelope each of them sends
+        envelope_peers_.clear();
     }
+    envelope_peers_.insert(ip + ":" + std::to_string(port));
+}
 
+bool BlockSyncManager::IsEnvelopePeer(const std::string& ip, uint16_t port) {
+    std::unique_lock<std::mutex> lock(envelope_peers_mutex_);
+    return envelope_peers_.find(ip + ":" + std::to_string(port)) != envelope_peers_.end();
+}
+
+void BlockSyncManager::CheckHeaderHashQueue() {
+    // only records whose deadline passed, one shard locked at a time
     auto tp_now = std::chrono::steady_clock::now();
-    {
-        for (auto iter = block_map.begin(); iter != block_map.end(); ++iter) {
-            auto item = iter->second;
-            if (item->time_point <= tp_now || DataExists(item->header_hash)) {
-                RemoveHeaderBlock(item->header_hash);
-                continue;
+    std::vector<SyncAction> actions;
+    // sources of requests that expired unanswered, not the ones only hedged
+    std::vector<SyncSource> timeout_sources;
+    auto chunk_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            2 * HedgeTimeout());
+    for (uint32_t i = 0; i < kSyncShardCount; ++i) {
+        CheckShard(header_shards_[i], tp_now, chunk_timeout, actions, timeout_sources);
+    }
+
+    if (++check_count_ >= kExpireCheckCount) {
+        check_count_ = 0;
+        // the store drops segments only when written, an idle node drops them here
+        auto header_block_data = header_block_data_;
+        if (header_block_data) {
+            header_block_data->DropExpired();
+        }
+        // cached views hold their segments, release them once the store expired them
+        response_cache_.DropExpired(tp_now);
+    }
+
+    GossipMetrics::Instance()->AddSyncTimeout(timeout_sources.size());
+    for (auto iter = timeout_sources.begin(); iter != timeout_sources.end(); ++iter) {
+        NeighborLiveness::Instance()->OnAckTimeout(iter->ip, iter->port);
+    }
+
+    // headers of one service type are asked together, in batches
+    std::map<uint64_t, SyncAction> ask_map;
+    for (auto iter = actions.begin(); iter != actions.end(); ++iter) {
+        if (iter->type != kSyncActionAsk) {
+            SendSyncAction(*iter);
+            continue;
+        }
+
+        const std::string& header_hash = iter->header_hashes.front();
+        if (DataExists(header_hash)) {
+            RemoveHeaderBlock(header_hash);
+            continue;
+        }
+        auto& ask = ask_map[iter->service_type];
+        ask.header_hashes.push_back(header_hash);
+        for (auto src_iter = iter->sources.begin(); src_iter != iter->sources.end(); ++src_iter) {
+            if (ask.sources.size() >= kSyncAskNeighborCount) {
+                break;
+            }
+            bool found = false;
+            for (auto ask_iter = ask.sources.begin(); ask_iter != ask.sources.end(); ++ask_iter) {
+                if (ask_iter->ip == src_iter->ip && ask_iter->port == src_iter->port) {
+                    found = true;
+                    break;
+                }
             }
+            if (!found) {
+                ask.sources.push_back(*src_iter);
+            }
+        }
+    }
+
+    for (auto iter = ask_map.begin(); iter != ask_map.end(); ++iter) {
+        SendSyncAsk(iter->second.header_hashes, iter->first, iter->second.sources);
+    }
+}
+
+void BlockSyncManager::CheckShard(
+        SyncHeaderShard& shard,
+        std::chrono::steady_clock::time_point tp_now,
+        std::chrono::steady_clock::duration chunk_timeout,
+        std::vector<SyncAction>& actions,
+        std::vector<SyncSource>& timeout_sources) {
+    std::unique_lock<LockWaitMutex> lock(shard.mutex);
+    while (!shard.deadline_queue.empty() &&
+            shard.deadline_queue.top().time_point <= tp_now) {
+        SyncDeadline due = shard.deadline_queue.top();
+        shard.deadline_queue.pop();
+        auto iter = shard.header_map.find(due.key);
+        // stale entries of removed or rescheduled records are skipped
+        if (iter == shard.header_map.end() || iter->second.deadline != due.time_point) {
+            continue;
+        }
+
+        auto& record = iter->second;
+        if (record.state == kSyncHeaderFetched) {
+            shard.header_map.erase(iter);
+            continue;
+        }
+        if (record.expire_time <= tp_now) {
+            // given up, whoever still owes a response timed out
+            GetOwingSources(record, timeout_sources);
+            shard.header_map.erase(iter);
+            continue;
+        }
+
+        // chunks flow, only the ones that timed out are pulled again. the
+        // chunk timeout follows the hedge timeout, a slow holder is not
+        // reported for it
+        if (record.transfer) {
+            auto& transfer = *record.transfer;
+            for (uint32_t i = 0; i < transfer.chunk_states.size(); ++i) {
+                if (transfer.chunk_states[i] == kSyncChunkInFlight &&
+                        transfer.chunk_deadlines[i] <= tp_now) {
+                    transfer.chunk_states[i] = kSyncChunkMissing;
+                }
+            }
+            SetDeadline(
+                    shard,
+                    due.key,
+                    record,
+                    std::min(
+                        record.expire_time,
+                        PullChunks(record, tp_now, chunk_timeout, actions)));
+            continue;
+        }
 
-            /*
-            if ((item->time_point - std::chrono::milliseconds(kHeaderSavePeriod) +
-                    std::chrono::milliseconds(kHeaderRequestedPeriod)) > tp_now) {
+        // the first acker is slow, request the same block from another acker
+        // too. only local: the first request is still running
+        if (record.state == kSyncHeaderRequested && record.request_count == 1) {
+            SyncSource* hedge = nullptr;
+            for (auto src_iter = record.sources.begin();
+                    src_iter != record.sources.end(); ++src_iter) {
+                if (src_iter->acked && !src_iter->requested) {
+                    hedge = &(*src_iter);
+                    break;
+                }
+            }
+            if (hedge != nullptr) {
+                hedge->requested = true;
+                record.request_count = 2;
+                actions.push_back(SyncAction{
+                        kSyncActionRequest,
+                        { record.header_hash },
+                        record.routing_service_type,
+                        { *hedge },
+                        {} });
+                SetDeadline(
+                        shard,
+                        due.key,
+                        record,
+                        std::min(
+                            record.expire_time,
+                            tp_now + std::chrono::milliseconds(kHeaderRequestedPeriod)));
                 continue;
             }
-            */
 
-            if (HeaderHashExists(item->header_hash) && !HeaderRequested(item->header_hash)) {
-                SendSyncAsk(item);
+            // none to hedge to, the request gets its full time
+            auto request_expire = record.request_time + std::chrono::milliseconds(kHeaderRequestedPeriod);
+            if (tp_now < request_expire) {
+                SetDeadline(shard, due.key, record, std::min(record.expire_time, request_expire));
                 continue;
             }
         }
+
+        // not acked yet, or no requested acker answered in time
+        GetOwingSources(record, timeout_sources);
+        record.state = kSyncHeaderAsking;
+        record.request_count = 0;
+        ++record.retry_count;
+        std::vector<SyncSource> announcers;
+        for (auto src_iter = record.sources.begin();
+                src_iter != record.sources.end(); ++src_iter) {
+            src_iter->requested = false;
+            if (!src_iter->acked) {
+                announcers.push_back(*src_iter);
+            }
+        }
+        actions.push_back(SyncAction{
+                kSyncActionAsk,
+                { record.header_hash },
+                record.routing_service_type,
+                announcers,
+                {} });
+        SetDeadline(
+                shard,
+                due.key,
+                record,
+                std::min(
+                    record.expire_time,
+                    tp_now + std::chrono::milliseconds(kHeaderRequestedPeriod)));
+    }
+}
+
+std::chrono::steady_clock::time_point BlockSyncManager::PullChunks(
+        SyncHeaderRecord& record,
+        std::chrono::steady_clock::time_point tp_now,
+        std::chrono::steady_clock::duration chunk_timeout,
+        std::vector<SyncAction>& actions) {
+    auto& transfer = *record.transfer;
+    uint32_t chunk_count = transfer.chunk_states.size();
+    uint32_t in_flight = 0;
+    auto next_deadline = tp_now + chunk_timeout;
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        if (transfer.chunk_states[i] == kSyncChunkInFlight) {
+            ++in_flight;
+            next_deadline = std::min(next_deadline, transfer.chunk_deadlines[i]);
+        }
+    }
+
+    // missing chunks go round robin over the holders, up to kSyncChunkWindow in flight
+    std::vector<std::vector<uint32_t>> holder_chunks(transfer.holders.size());
+    for (uint32_t i = 0; i < chunk_count && in_flight < kSyncChunkWindow; ++i) {
+        if (transfer.chunk_states[i] != kSyncChunkMissing) {
+            continue;
+        }
+        uint32_t holder = transfer.next_holder++ % transfer.holders.size();
+        transfer.chunk_states[i] = kSyncChunkInFlight;
+        transfer.chunk_deadlines[i] = tp_now + chunk_timeout;
+        transfer.chunk_holders[i] = holder;
+        holder_chunks[holder].push_back(i);
+        ++in_flight;
+    }
+
+    for (uint32_t i = 0; i < holder_chunks.size(); ++i) {
+        if (holder_chunks[i].empty()) {
+            continue;
+        }
+        actions.push_back(SyncAction{
+                kSyncActionChunk,
+                { record.header_hash },
+                record.routing_service_type,
+                { transfer.holders[i] },
+                holder_chunks[i] });
+    }
+    return next_deadline;
+}
+
+void BlockSyncManager::SendSyncAction(const SyncAction& action) {
+    if (action.type == kSyncActionRequest) {
+        SendSyncRequest(action.header_hashes, action.service_type, action.sources.front());
+        return;
+    }
+
+    if (action.type != kSyncActionChunk) {
+        return;
+    }
+    auto routing = wrouter::GetRoutingTable(action.service_type);
+    if (!routing) {
+		TOP_INFO("no routing table:%d", action.service_type);
+        return;
     }
+    assert(routing);
+    const SyncSource& holder = action.sources.front();
+    std::string data;
+    EncodeSyncChunkRequest(SyncChunkRequest{ action.header_hashes.front(), action.chunk_indexes }, data);
+    transport::protobuf::RoutingMessage pbft_message;
+    routing->SetFreqMessage(pbft_message);
+    pbft_message.set_type(kGossipBlockSyncRequest);
+    pbft_message.set_id(kadmlia::CallbackManager::MessageId());
+    pbft_message.set_des_node_id(holder.node_id);
+    pbft_message.set_data(data);
+	pbft_message.set_src_service_type(action.service_type);
+    routing->SendData(pbft_message, holder.ip, holder.port);
 }
 
 uint64_t BlockSyncManager::GetRoutingServiceType(const std::string& des_node_id) {
@@ -205,6 +702,25 @@ uint64_t BlockSyncManager::GetRoutingServiceType(const std::string& des_node_id)
 
 void BlockSyncManager::SetLeagerFace(std::shared_ptr<top::ledger::xledger_face_t> ledger_face) {
     header_block_data_ = std::make_shared<HeaderBlockData>(ledger_face);
+    async_header_block_data_ = std::make_shared<AsyncHeaderBlockData>(
+            header_block_data_,
+            kSyncWorkerCount,
+            kMaxSyncBacklog,
+            kMaxSyncWriteBacklog);
+}
+
+void BlockSyncManager::RemoveBlock(const std::string& header_hash) {
+    header_block_data_->RemoveData(header_hash);
+    response_cache_.Remove(header_hash);
+}
+
+void BlockSyncManager::SetBlockLogStore(std::shared_ptr<BlockLogStore> block_store) {
+    header_block_data_ = std::make_shared<HeaderBlockData>(block_store);
+    async_header_block_data_ = std::make_shared<AsyncHeaderBlockData>(
+            header_block_data_,
+            kSyncWorkerCount,
+            kMaxSyncBacklog,
+            kMaxSyncWriteBacklog);
 }
 
 void BlockSyncManager::HandleSyncAsk(
@@ -219,7 +735,23 @@ void BlockSyncManager::HandleSyncAsk(
         return;
     }
 
-    if (!header_block_data_->HasData(message.data())) {
+    bool envelope = (GetSyncEnvelopeKind(message.data()) != kSyncEnvelopeInvalid);
+    if (envelope) {
+        AddEnvelopePeer(packet.get_from_ip_addr(), packet.get_from_ip_port());
+    }
+    std::vector<std::string> header_hashes;
+    if (!DecodeSyncHeaders(message.data(), header_hashes)) {
+        return;
+    }
+
+    // ack the subset held here, in the format of the ask
+    std::vector<std::string> held_hashes;
+    for (auto iter = header_hashes.begin(); iter != header_hashes.end(); ++iter) {
+        if (header_block_data_->HasData(*iter)) {
+            held_hashes.push_back(*iter);
+        }
+    }
+    if (held_hashes.empty()) {
         return;
     }
 
@@ -229,16 +761,85 @@ void BlockSyncManager::HandleSyncAsk(
         return;
     }
     assert(routing);
+    // out of upload budget, point the asker at other holders instead of acking
+    if (!admission_.HasBudget(packet.get_from_ip_addr(), packet.get_from_ip_port())) {
+        SendSyncBusy(
+                message,
+                packet.get_from_ip_addr(),
+                packet.get_from_ip_port(),
+                routing,
+                kGossipBlockSyncAck,
+                held_hashes);
+        return;
+    }
     transport::protobuf::RoutingMessage pbft_message;
     routing->SetFreqMessage(pbft_message);
     pbft_message.set_type(kGossipBlockSyncAck);
     pbft_message.set_id(message.id());
-    pbft_message.set_data(message.data());
+    pbft_message.set_data(envelope ? EncodeSyncHeaders(held_hashes, 0) : held_hashes.front());
     pbft_message.set_des_node_id(message.src_node_id());
 	pbft_message.set_src_service_type(message.src_service_type());
 
     routing->SendData(pbft_message, packet.get_from_ip_addr(), packet.get_from_ip_port());
-    TOP_DEBUG("[gossip_sync]handled ask[%s].", HexEncode(message.data()).c_str());
+    TOP_DEBUG("[gossip_sync]handled ask[%s] held %d.",
+            HexEncode(held_hashes.front()).c_str(), held_hashes.size());
+}
+
+bool BlockSyncManager::AckHeader(
+        const std::string& header_hash,
+        const SyncSource& acker_source,
+        std::chrono::steady_clock::time_point tp_now,
+        std::chrono::steady_clock::duration hedge_timeout,
+        uint64_t& service_type) {
+    auto key = GetHeaderKey(header_hash);
+    auto& shard = GetShard(key);
+    std::unique_lock<LockWaitMutex> lock(shard.mutex);
+    auto iter = shard.header_map.find(key);
+    if (iter == shard.header_map.end() || iter->second.header_hash != header_hash) {
+        return false;
+    }
+
+    auto& record = iter->second;
+    SyncSource* acker = FindSource(record, acker_source.ip, acker_source.port);
+    if (acker == nullptr) {
+        if (record.sources.size() >= kSyncMaxSourceCount) {
+            return false;
+        }
+        record.sources.push_back(acker_source);
+        acker = &record.sources.back();
+    }
+    acker->acked = true;
+    acker->node_id = acker_source.node_id;
+
+    // the first acker is already past the hedge timeout, this one is the hedge
+    if (record.state == kSyncHeaderRequested &&
+            record.request_count == 1 &&
+            !record.transfer &&
+            tp_now >= record.request_time + hedge_timeout) {
+        acker->requested = true;
+        record.request_count = 2;
+        SetDeadline(
+                shard,
+                key,
+                record,
+                std::min(
+                    record.expire_time,
+                    tp_now + std::chrono::milliseconds(kHeaderRequestedPeriod)));
+        service_type = record.routing_service_type;
+        return true;
+    }
+
+    // one request at first, the next acker is the hedge if it is slow
+    if (record.state != kSyncHeaderAnnounced && record.state != kSyncHeaderAsking) {
+        return false;
+    }
+    acker->requested = true;
+    record.state = kSyncHeaderRequested;
+    record.request_count = 1;
+    record.request_time = tp_now;
+    SetDeadline(shard, key, record, std::min(record.expire_time, tp_now + hedge_timeout));
+    service_type = record.routing_service_type;
+    return true;
 }
 
 void BlockSyncManager::HandleSyncAck(
@@ -251,33 +852,47 @@ void BlockSyncManager::HandleSyncAck(
     if (message.type() != kGossipBlockSyncAck) {
         return;
     }
+    NeighborLiveness::Instance()->OnAck(packet.get_from_ip_addr(), packet.get_from_ip_port());
 
-    /*
-    if (HeaderRequested(message.data())) {
+    SyncSource source{
+            packet.get_from_ip_addr(),
+            packet.get_from_ip_port(),
+            message.src_node_id(),
+            false,
+            false };
+    if (GetSyncEnvelopeKind(message.data()) != kSyncEnvelopeInvalid) {
+        AddEnvelopePeer(source.ip, source.port);
+    }
+    if (GetSyncEnvelopeKind(message.data()) == kSyncEnvelopeBusy) {
+        std::vector<SyncRedirect> redirects;
+        if (DecodeSyncBusy(message.data(), redirects)) {
+            HandleSyncBusy(redirects, source);
+        }
         return;
     }
-    */
 
-    if (!HeaderHashExists(message.data()) || DataExists(message.data())) {
+    std::vector<std::string> header_hashes;
+    if (!DecodeSyncHeaders(message.data(), header_hashes)) {
         return;
     }
 
-    auto routing = wrouter::GetRoutingTable(message.src_service_type());
-    if (!routing) {
-		TOP_INFO("no routing table:%d", message.src_service_type());
-        return;
+    auto tp_now = std::chrono::steady_clock::now();
+    auto hedge_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            HedgeTimeout());
+    // everything this acker gets asked for goes in one request per service type
+    std::map<uint64_t, std::vector<std::string>> request_map;
+    for (auto iter = header_hashes.begin(); iter != header_hashes.end(); ++iter) {
+        uint64_t service_type = 0;
+        if (AckHeader(*iter, source, tp_now, hedge_timeout, service_type)) {
+            request_map[service_type].push_back(*iter);
+        }
     }
-    assert(routing);
-    transport::protobuf::RoutingMessage pbft_message;
-    routing->SetFreqMessage(pbft_message);
-    pbft_message.set_type(kGossipBlockSyncRequest);
-    pbft_message.set_id(kadmlia::CallbackManager::MessageId());
-    pbft_message.set_des_node_id(message.src_node_id());
-    pbft_message.set_data(message.data());
-	pbft_message.set_src_service_type(message.src_service_type());
 
-    routing->SendData(pbft_message, packet.get_from_ip_addr(), packet.get_from_ip_port());
-    TOP_DEBUG("[gossip_sync]handled ack[%s].", HexEncode(message.data()).c_str());
+    for (auto iter = request_map.begin(); iter != request_map.end(); ++iter) {
+        SendSyncRequest(iter->second, iter->first, source);
+    }
+    TOP_DEBUG("[gossip_sync]handled ack[%s] count %d.",
+            HexEncode(header_hashes.front()).c_str(), header_hashes.size());
 }
 
 void BlockSyncManager::HandleSyncRequest(
@@ -291,11 +906,113 @@ void BlockSyncManager::HandleSyncRequest(
         return;
     }
 
-    std::string message_string;
-    header_block_data_->GetData(message.data(), message_string);
-    if (message_string.empty()) {
+    // ledger reads run on the sync workers, requests are shed when they fall behind
+    auto request = std::make_shared<transport::protobuf::RoutingMessage>(message);
+    std::string from_ip = packet.get_from_ip_addr();
+    uint16_t from_port = packet.get_from_ip_port();
+    if (GetSyncEnvelopeKind(message.data()) != kSyncEnvelopeInvalid) {
+        AddEnvelopePeer(from_ip, from_port);
+    }
+    if (!async_header_block_data_->Post([this, request, from_ip, from_port]() {
+                ServeSyncRequest(*request, from_ip, from_port);
+            })) {
+        TOP_WARN("[gossip_sync] sync workers busy, drop request from %s:%d",
+                from_ip.c_str(), from_port);
+    }
+}
+
+void BlockSyncManager::ServeSyncRequest(
+        transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port) {
+    if (GetSyncEnvelopeKind(message.data()) == kSyncEnvelopeChunkRequest) {
+        ServeSyncChunkRequest(message, from_ip, from_port);
+        return;
+    }
+
+    bool batch = (GetSyncEnvelopeKind(message.data()) == kSyncEnvelopeBatch);
+    std::vector<std::string> header_hashes;
+    if (!DecodeSyncHeaders(message.data(), header_hashes)) {
+        return;
+    }
+    if (header_hashes.size() > kMaxSyncBatchCount) {
+        header_hashes.resize(kMaxSyncBatchCount);
+    }
+
+    auto routing = wrouter::GetRoutingTable(message.src_service_type());
+    if (!routing) {
+		TOP_INFO("no routing table:%d", message.src_service_type());
+        return;
+    }
+    assert(routing);
+
+    // blocks go out in responses of up to kMaxSyncResponseSize bytes, a
+    // block larger than kSyncChunkSize is answered with its manifest when
+    // the request came in an envelope
+    std::vector<std::string> entries;
+    uint32_t entries_size = 0;
+    // headers held here but over the upload budget
+    std::vector<std::string> refused_hashes;
+    for (uint32_t i = 0; i < header_hashes.size(); ++i) {
+        auto response = GetSyncResponse(header_hashes[i]);
+        const std::string* payload = response ? &response->payload : nullptr;
+        bool manifest = response && response->block.size > 0;
+        // a requester that sent no envelope knows no manifest, it gets the whole block
+        std::string block_payload;
+        if (manifest && !batch) {
+            block_payload = EncodeSyncBlock(header_hashes[i], response->block);
+            payload = &block_payload;
+            manifest = false;
+        }
+        if (payload && !admission_.Admit(from_ip, from_port, payload->size())) {
+            refused_hashes.push_back(header_hashes[i]);
+            payload = nullptr;
+        }
+        if (payload && manifest) {
+            SendSyncResponse(message, from_ip, from_port, routing, *payload);
+        } else if (payload) {
+            entries.push_back(*payload);
+            entries_size += payload->size();
+            // the requester holds the block once this arrives
+            admission_.AddHolder(header_hashes[i], SyncHolder{ from_ip, from_port, message.src_node_id() });
+        }
+
+        bool last = (i + 1 == header_hashes.size());
+        if (entries.empty() || (!last && entries_size < kMaxSyncResponseSize)) {
+            continue;
+        }
+
+        if (batch) {
+            std::string data;
+            EncodeSyncEnvelope(kSyncEnvelopeBatch, entries, data);
+            SendSyncResponse(message, from_ip, from_port, routing, data);
+        } else {
+            SendSyncResponse(message, from_ip, from_port, routing, entries.front());
+        }
+        entries.clear();
+        entries_size = 0;
+    }
+    if (!refused_hashes.empty()) {
+        SendSyncBusy(message, from_ip, from_port, routing, kGossipBlockSyncResponse, refused_hashes);
+    }
+    TOP_DEBUG("[gossip_sync]handled request[%s] count %d refused %d.",
+            HexEncode(header_hashes.front()).c_str(), header_hashes.size(), refused_hashes.size());
+}
+
+void BlockSyncManager::ServeSyncChunkRequest(
+        transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port) {
+    SyncChunkRequest request;
+    if (!DecodeSyncChunkRequest(message.data(), request)) {
+        return;
+    }
+
+    auto response = GetSyncResponse(request.header_hash);
+    if (!response || response->block.size == 0) {
         return;
     }
+    const BlockLogView& block = response->block;
 
     auto routing = wrouter::GetRoutingTable(message.src_service_type());
     if (!routing) {
@@ -303,19 +1020,105 @@ void BlockSyncManager::HandleSyncRequest(
         return;
     }
     assert(routing);
+    uint32_t count = std::min<uint32_t>(request.chunk_indexes.size(), kSyncChunkWindow);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t offset = static_cast<uint64_t>(request.chunk_indexes[i]) * kSyncChunkSize;
+        if (offset >= block.size) {
+            continue;
+        }
+        uint64_t size = std::min<uint64_t>(kSyncChunkSize, block.size - offset);
+        if (!admission_.Admit(from_ip, from_port, size)) {
+            // the rest times out at the requester, the hint lets it add holders
+            SendSyncBusy(
+                    message,
+                    from_ip,
+                    from_port,
+                    routing,
+                    kGossipBlockSyncResponse,
+                    { request.header_hash });
+            break;
+        }
+        std::string data;
+        EncodeSyncChunk(request.header_hash, request.chunk_indexes[i], block.data + offset, size, data);
+        SendSyncResponse(message, from_ip, from_port, routing, data);
+    }
+    TOP_DEBUG("[gossip_sync]handled chunk request[%s] count %d.",
+            HexEncode(request.header_hash).c_str(), count);
+}
+
+SyncResponseEntryPtr BlockSyncManager::GetSyncResponse(const std::string& header_hash) {
+    auto response = response_cache_.Get(header_hash);
+    if (response) {
+        return response;
+    }
+
+    // the block stays where the store keeps it, chunks are cut from there
+    BlockLogView block;
+    if (!header_block_data_->GetViewIfPresent(header_hash, block) || block.size == 0) {
+        return nullptr;
+    }
+
+    // built once per header, later requests are served from response_cache_
+    auto new_response = std::make_shared<SyncResponseEntry>();
+    if (block.size > kSyncChunkSize) {
+        SyncChunkManifest manifest;
+        BuildSyncManifest(header_hash, block, manifest);
+        EncodeSyncManifest(manifest, new_response->payload);
+        new_response->block = block;
+    } else {
+        new_response->payload = EncodeSyncBlock(header_hash, block);
+    }
+    new_response->expire_time = block.expire_time;
+    response_cache_.Put(header_hash, new_response);
+    return new_response;
+}
+
+void BlockSyncManager::SendSyncResponse(
+        transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port,
+        kadmlia::RoutingTablePtr& routing,
+        const std::string& data) {
     transport::protobuf::RoutingMessage pbft_message;
     routing->SetFreqMessage(pbft_message);
     pbft_message.set_type(kGossipBlockSyncResponse);
     pbft_message.set_id(message.id());
     pbft_message.set_des_node_id(message.src_node_id());
-    transport::protobuf::GossipSyncBlockData gossip_data;
-    gossip_data.set_header_hash(message.data());
-    gossip_data.set_block(message_string); // get the whole message stored
-    pbft_message.set_data(gossip_data.SerializeAsString());
+    pbft_message.set_data(data);
 	pbft_message.set_src_service_type(message.src_service_type());
+    routing->SendData(pbft_message, from_ip, from_port);
+}
 
-    routing->SendData(pbft_message, packet.get_from_ip_addr(), packet.get_from_ip_port());
-    TOP_DEBUG("[gossip_sync]handled request[%s].", HexEncode(message.data()).c_str());
+void BlockSyncManager::SendSyncBusy(
+        transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port,
+        kadmlia::RoutingTablePtr& routing,
+        uint32_t message_type,
+        const std::vector<std::string>& header_hashes) {
+    std::vector<SyncRedirect> redirects(header_hashes.size());
+    for (uint32_t i = 0; i < header_hashes.size(); ++i) {
+        redirects[i].header_hash = header_hashes[i];
+        admission_.GetHolders(
+                header_hashes[i],
+                from_ip,
+                from_port,
+                kSyncRedirectHolderCount,
+                redirects[i].holders);
+    }
+    std::string data;
+    EncodeSyncBusy(redirects, data);
+
+    transport::protobuf::RoutingMessage pbft_message;
+    routing->SetFreqMessage(pbft_message);
+    pbft_message.set_type(message_type);
+    pbft_message.set_id(message.id());
+    pbft_message.set_des_node_id(message.src_node_id());
+    pbft_message.set_data(data);
+	pbft_message.set_src_service_type(message.src_service_type());
+    routing->SendData(pbft_message, from_ip, from_port);
+    TOP_DEBUG("[gossip_sync]busy, refused %d headers of %s:%d.",
+            header_hashes.size(), from_ip.c_str(), from_port);
 }
 
 void BlockSyncManager::HandleSyncResponse(
@@ -328,26 +1131,361 @@ void BlockSyncManager::HandleSyncResponse(
     if (message.type() != kGossipBlockSyncResponse) {
         return;
     }
+    NeighborLiveness::Instance()->OnAck(packet.get_from_ip_addr(), packet.get_from_ip_port());
+    if (GetSyncEnvelopeKind(message.data()) != kSyncEnvelopeInvalid) {
+        AddEnvelopePeer(packet.get_from_ip_addr(), packet.get_from_ip_port());
+    }
 
-    transport::protobuf::GossipSyncBlockData gossip_data;
-    if (!gossip_data.ParseFromString(message.data())) {
+    std::vector<std::string> entries;
+    switch (GetSyncEnvelopeKind(message.data())) {
+    case kSyncEnvelopeBatch:
+        if (!DecodeSyncEnvelope(message.data(), kSyncEnvelopeBatch, entries)) {
+            return;
+        }
+        break;
+    case kSyncEnvelopeManifest: {
+        SyncChunkManifest manifest;
+        if (DecodeSyncManifest(message.data(), manifest)) {
+            HandleSyncManifest(manifest, SyncSource{
+                    packet.get_from_ip_addr(),
+                    packet.get_from_ip_port(),
+                    message.src_node_id(),
+                    true,
+                    true });
+        }
+        return;
+    }
+    case kSyncEnvelopeChunk: {
+        SyncChunk chunk;
+        if (DecodeSyncChunk(message.data(), chunk)) {
+            HandleSyncChunk(chunk);
+        }
         return;
     }
+    case kSyncEnvelopeBusy: {
+        std::vector<SyncRedirect> redirects;
+        if (DecodeSyncBusy(message.data(), redirects)) {
+            HandleSyncBusy(redirects, SyncSource{
+                    packet.get_from_ip_addr(),
+                    packet.get_from_ip_port(),
+                    message.src_node_id(),
+                    false,
+                    false });
+        }
+        return;
+    }
+    default:
+        entries.push_back(message.data());
+        break;
+    }
+
+    for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+        transport::protobuf::GossipSyncBlockData gossip_data;
+        if (!gossip_data.ParseFromString(*iter)) {
+            continue;
+        }
+        // the sender is another holder to name when this node gets busy
+        admission_.AddHolder(gossip_data.header_hash(), SyncHolder{
+                packet.get_from_ip_addr(),
+                packet.get_from_ip_port(),
+                message.src_node_id() });
+        HandleSyncBlock(gossip_data);
+    }
+}
+
+void BlockSyncManager::HandleSyncBusy(
+        const std::vector<SyncRedirect>& redirects,
+        const SyncSource& busy_source) {
+    auto tp_now = std::chrono::steady_clock::now();
+    auto hedge_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            HedgeTimeout());
+    // redirected headers are requested from the holders they name, one request
+    // per holder and service type
+    std::map<std::pair<std::string, uint64_t>, SyncAction> request_map;
+    for (auto iter = redirects.begin(); iter != redirects.end(); ++iter) {
+        uint64_t service_type = 0;
+        SyncSource next_source;
+        if (!RedirectHeader(*iter, busy_source, tp_now, hedge_timeout, service_type, next_source)) {
+            continue;
+        }
+        auto key = std::make_pair(next_source.ip + ":" + std::to_string(next_source.port), service_type);
+        auto ret = request_map.insert(std::make_pair(key, SyncAction{
+                kSyncActionRequest,
+                {},
+                service_type,
+                { next_source },
+                {} }));
+        ret.first->second.header_hashes.push_back(iter->header_hash);
+    }
+
+    for (auto iter = request_map.begin(); iter != request_map.end(); ++iter) {
+        SendSyncAction(iter->second);
+    }
+    TOP_DEBUG("[gossip_sync]%s:%d busy for %d headers, redirected %d holders.",
+            busy_source.ip.c_str(), busy_source.port, redirects.size(), request_map.size());
+}
+
+bool BlockSyncManager::RedirectHeader(
+        const SyncRedirect& redirect,
+        const SyncSource& busy_source,
+        std::chrono::steady_clock::time_point tp_now,
+        std::chrono::steady_clock::duration hedge_timeout,
+        uint64_t& service_type,
+        SyncSource& next_source) {
+    auto key = GetHeaderKey(redirect.header_hash);
+    auto& shard = GetShard(key);
+    std::unique_lock<LockWaitMutex> lock(shard.mutex);
+    auto iter = shard.header_map.find(key);
+    if (iter == shard.header_map.end() || iter->second.header_hash != redirect.header_hash) {
+        return false;
+    }
+
+    auto& record = iter->second;
+    if (record.state == kSyncHeaderFetched) {
+        return false;
+    }
+    // the busy node is not a timeout, it is asked again with the announcers
+    SyncSource* busy = FindSource(record, busy_source.ip, busy_source.port);
+    if (busy != nullptr) {
+        busy->acked = false;
+        busy->requested = false;
+    }
+    for (auto holder_iter = redirect.holders.begin();
+            holder_iter != redirect.holders.end() && record.sources.size() < kSyncMaxSourceCount;
+            ++holder_iter) {
+        if (holder_iter->node_id.empty() ||
+                FindSource(record, holder_iter->ip, holder_iter->port) != nullptr) {
+            continue;
+        }
+        // named by a holder, as good as an ack
+        record.sources.push_back(SyncSource{
+                holder_iter->ip,
+                holder_iter->port,
+                holder_iter->node_id,
+                true,
+                false });
+    }
+
+    // a hedge still in flight is waited for. A chunk transfer goes on with
+    // its other holders, a redirect holder answers with the manifest and joins it
+    if (!record.transfer && record.state == kSyncHeaderRequested) {
+        for (auto src_iter = record.sources.begin(); src_iter != record.sources.end(); ++src_iter) {
+            if (src_iter->requested) {
+                return false;
+            }
+        }
+    }
+
+    SyncSource* next = nullptr;
+    for (auto src_iter = record.sources.begin(); src_iter != record.sources.end(); ++src_iter) {
+        if (src_iter->acked && !src_iter->requested) {
+            next = &(*src_iter);
+            break;
+        }
+    }
+    if (next == nullptr) {
+        return false;
+    }
+    next->requested = true;
+    if (!record.transfer) {
+        record.state = kSyncHeaderRequested;
+        record.request_count = 1;
+        record.request_time = tp_now;
+        SetDeadline(shard, key, record, std::min(record.expire_time, tp_now + hedge_timeout));
+    }
+    service_type = record.routing_service_type;
+    next_source = *next;
+    return true;
+}
+
+void BlockSyncManager::HandleSyncBlock(
+        const transport::protobuf::GossipSyncBlockData& gossip_data) {
     std::string header_hash = gossip_data.header_hash();
 
-    if (!HeaderHashExists(header_hash)) {
+    transport::protobuf::RoutingMessage sync_message;
+    if (!sync_message.ParseFromString(gossip_data.block())) {
+        TOP_WARN("SyncMessae ParseFromString failed");
+        return;
+    }
+
+    auto tp_now = std::chrono::steady_clock::now();
+    auto key = GetHeaderKey(header_hash);
+    auto& shard = GetShard(key);
+    std::chrono::microseconds response_time(0);
+    {
+        std::unique_lock<LockWaitMutex> lock(shard.mutex);
+        auto iter = shard.header_map.find(key);
+        if (iter == shard.header_map.end() || iter->second.header_hash != header_hash) {
+            return;
+        }
+
+        // the response of the losing acker arrives later and is dropped
+        auto& record = iter->second;
+        if (record.state == kSyncHeaderFetched) {
+            return;
+        }
+        // once hedged the sample is ambiguous, skip it
+        if (record.state == kSyncHeaderRequested && record.request_count == 1) {
+            response_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                    tp_now - record.request_time);
+        }
+        record.state = kSyncHeaderFetched;
+        record.transfer.reset();
+        SetDeadline(shard, key, record, tp_now + std::chrono::milliseconds(kHeaderFetchedKeepPeriod));
+    }
+
+    if (response_time.count() > 0) {
+        UpdateResponseTime(response_time);
+    }
+    StoreSyncBlock(header_hash, gossip_data.block(), sync_message);
+}
+
+void BlockSyncManager::HandleSyncManifest(
+        const SyncChunkManifest& manifest,
+        const SyncSource& holder) {
+    uint64_t chunk_count = manifest.chunk_size == 0 ? 0 :
+            (static_cast<uint64_t>(manifest.total_size) + manifest.chunk_size - 1) / manifest.chunk_size;
+    if (manifest.chunk_size == 0 ||
+            manifest.chunk_size > kMaxSyncChunkSize ||
+            manifest.total_size == 0 ||
+            manifest.total_size > kMaxSyncBlockSize ||
+            manifest.chunk_hashes.size() != chunk_count) {
+        TOP_WARN("[gossip_sync] invalid manifest of header(%s)", HexEncode(manifest.header_hash).c_str());
         return;
     }
-    if (header_block_data_->HasData(header_hash)){
+
+    auto tp_now = std::chrono::steady_clock::now();
+    auto chunk_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            2 * HedgeTimeout());
+    auto key = GetHeaderKey(manifest.header_hash);
+    auto& shard = GetShard(key);
+    std::vector<SyncAction> actions;
+    {
+        std::unique_lock<LockWaitMutex> lock(shard.mutex);
+        auto iter = shard.header_map.find(key);
+        if (iter == shard.header_map.end() || iter->second.header_hash != manifest.header_hash) {
+            return;
+        }
+
+        // a late manifest after the record went back to asking is still used
+        auto& record = iter->second;
+        if (record.state == kSyncHeaderFetched) {
+            return;
+        }
+        record.state = kSyncHeaderRequested;
+        if (!record.transfer) {
+            auto transfer = std::make_shared<SyncChunkTransfer>();
+            transfer->manifest = manifest;
+            transfer->chunks.resize(chunk_count);
+            transfer->chunk_states.assign(chunk_count, kSyncChunkMissing);
+            transfer->chunk_deadlines.assign(chunk_count, tp_now);
+            transfer->chunk_holders.assign(chunk_count, 0);
+            transfer->next_holder = 0;
+            transfer->done_count = 0;
+            record.transfer = transfer;
+        } else if (record.transfer->manifest.total_size != manifest.total_size ||
+                record.transfer->manifest.chunk_size != manifest.chunk_size ||
+                record.transfer->manifest.chunk_hashes != manifest.chunk_hashes) {
+            // the holder stored other bytes for this header, its chunks do not fit
+            return;
+        }
+
+        auto& holders = record.transfer->holders;
+        for (auto holder_iter = holders.begin(); holder_iter != holders.end(); ++holder_iter) {
+            if (holder_iter->ip == holder.ip && holder_iter->port == holder.port) {
+                return;
+            }
+        }
+        holders.push_back(holder);
+        SetDeadline(
+                shard,
+                key,
+                record,
+                std::min(record.expire_time, PullChunks(record, tp_now, chunk_timeout, actions)));
+    }
+
+    for (auto iter = actions.begin(); iter != actions.end(); ++iter) {
+        SendSyncAction(*iter);
+    }
+}
+
+void BlockSyncManager::HandleSyncChunk(const SyncChunk& chunk) {
+    // hashed before the lock is taken
+    uint64_t chunk_hash = base::xhash64_t::digest(chunk.data);
+    auto tp_now = std::chrono::steady_clock::now();
+    auto chunk_timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            2 * HedgeTimeout());
+    auto key = GetHeaderKey(chunk.header_hash);
+    auto& shard = GetShard(key);
+    std::vector<SyncAction> actions;
+    std::string block;
+    {
+        std::unique_lock<LockWaitMutex> lock(shard.mutex);
+        auto iter = shard.header_map.find(key);
+        if (iter == shard.header_map.end() || iter->second.header_hash != chunk.header_hash) {
+            return;
+        }
+
+        auto& record = iter->second;
+        if (record.state != kSyncHeaderRequested || !record.transfer) {
+            return;
+        }
+        auto& transfer = *record.transfer;
+        uint32_t chunk_count = transfer.chunk_states.size();
+        if (chunk.chunk_index >= chunk_count ||
+                transfer.chunk_states[chunk.chunk_index] == kSyncChunkDone) {
+            return;
+        }
+        uint32_t offset = chunk.chunk_index * transfer.manifest.chunk_size;
+        uint32_t size = std::min(transfer.manifest.chunk_size, transfer.manifest.total_size - offset);
+        if (chunk.data.size() != size || chunk_hash != transfer.manifest.chunk_hashes[chunk.chunk_index]) {
+            // stays in flight and is pulled again when it times out
+            TOP_WARN("[gossip_sync] bad chunk(%u) of header(%s)",
+                    chunk.chunk_index, HexEncode(chunk.header_hash).c_str());
+            return;
+        }
+        transfer.chunks[chunk.chunk_index] = chunk.data;
+        transfer.chunk_states[chunk.chunk_index] = kSyncChunkDone;
+        ++transfer.done_count;
+
+        if (transfer.done_count < chunk_count) {
+            SetDeadline(
+                    shard,
+                    key,
+                    record,
+                    std::min(record.expire_time, PullChunks(record, tp_now, chunk_timeout, actions)));
+        } else {
+            block.reserve(transfer.manifest.total_size);
+            for (auto chunk_iter = transfer.chunks.begin(); chunk_iter != transfer.chunks.end(); ++chunk_iter) {
+                block.append(*chunk_iter);
+            }
+            record.transfer.reset();
+            record.state = kSyncHeaderFetched;
+            SetDeadline(shard, key, record, tp_now + std::chrono::milliseconds(kHeaderFetchedKeepPeriod));
+        }
+    }
+
+    for (auto iter = actions.begin(); iter != actions.end(); ++iter) {
+        SendSyncAction(*iter);
+    }
+    if (block.empty()) {
         return;
     }
 
     transport::protobuf::RoutingMessage sync_message;
-    if (!sync_message.ParseFromString(gossip_data.block())) {
+    if (!sync_message.ParseFromString(block)) {
         TOP_WARN("SyncMessae ParseFromString failed");
         return;
     }
-    header_block_data_->AddData(header_hash, gossip_data.block());
+    StoreSyncBlock(chunk.header_hash, block, sync_message);
+}
+
+void BlockSyncManager::StoreSyncBlock(
+        const std::string& header_hash,
+        const std::string& block,
+        transport::protobuf::RoutingMessage& sync_message) {
+    async_header_block_data_->AsyncAddData(header_hash, block, nullptr);
+    GossipMetrics::Instance()->AddSyncFetched();
 
     // call callback
     if (sync_message.type() == kElectVhostRumorMessage) {
@@ -375,48 +1513,18 @@ void BlockSyncManager::HandleSyncResponse(
 #endif
     }
 
-    RemoveHeaderBlock(header_hash);
-    TOP_DEBUG("blockmessage add block data size(%d),hash:%s", gossip_data.block().size(), HexEncode(header_hash).c_str());
+    TOP_DEBUG("blockmessage add block data size(%d),hash:%s", block.size(), HexEncode(header_hash).c_str());
 }
 
 void BlockSyncManager::RemoveHeaderBlock(const std::string& header_hash) {
-    {
-        std::unique_lock<std::mutex> lock(requested_headers_mutex_);
-        auto iter = requested_headers_.find(header_hash);
-        if (iter != requested_headers_.end()) {
-            requested_headers_.erase(iter);
-        }
+    // the stored block is kept for asking neighbors, the ledger expires it
+    auto key = GetHeaderKey(header_hash);
+    auto& shard = GetShard(key);
+    std::unique_lock<LockWaitMutex> lock(shard.mutex);
+    auto iter = shard.header_map.find(key);
+    if (iter != shard.header_map.end() && iter->second.header_hash == header_hash) {
+        shard.header_map.erase(iter);
     }
-
-    {
-        std::unique_lock<std::mutex> lock(block_map_mutex_);
-        auto iter = block_map_.find(header_hash);
-        if (iter != block_map_.end()) {
-            block_map_.erase(iter);
-        }
-    }
-    // (delete block from db)
-    header_block_data_->RemoveData(header_hash);
-}
-
-bool BlockSyncManager::HeaderRequested(const std::string& header_hash) {
-    auto tp_now = std::chrono::steady_clock::now();
-    std::unique_lock<std::mutex> lock(requested_headers_mutex_);
-    auto iter = requested_headers_.find(header_hash);
-    if (iter != requested_headers_.end()) {
-        if (iter->second <= tp_now) {
-            requested_headers_.erase(iter);
-            return false;
-        }
-        // in kHeaderRequestPeriod seconds, have requested
-        return true;
-    }
-
-    requested_headers_.insert(std::make_pair(
-            header_hash,
-            std::chrono::steady_clock::now() +
-            std::chrono::milliseconds(kHeaderRequestedPeriod)));
-    return false;
 }
 
 }  // namespace gossip
@@ -9,7 +9,8 @@
 #include "xpbase/base/redis_client.h"
 #include "xkad/routing_table/routing_table.h"
 #include "xgossip/include/gossip_utils.h"
-#include "xgossip/include/block_sync_manager.h"
+#include "xgossip/include/layered_tree_index.h"
+#include "xgossip/include/node_capacity.h"
 
 namespace top {
 
@@ -17,31 +18,87 @@ using namespace kadmlia;
 
 namespace gossip {
 
-BroadcastLayered::BroadcastLayered(transport::TransportPtr transport_ptr)
-        : GossipInterface(transport_ptr) {}
+std::atomic<uint64_t> BroadcastLayered::membership_epoch_{ 0 };
+
+BroadcastLayered::BroadcastLayered(
+        transport::TransportPtr transport_ptr,
+        LayeredTreeMode tree_mode)
+        : BroadcastLayeredEngine(transport_ptr), tree_mode_(tree_mode) {}
 
 BroadcastLayered::~BroadcastLayered() {}
 
-void BroadcastLayered::Broadcast(
+LayeredPlanPtr BroadcastLayered::GetBroadcastPlan(
         transport::protobuf::RoutingMessage& message,
         kadmlia::RoutingTablePtr& routing_table) {
-    if (message.hop_num() >= kadmlia::kHopToLive) {
-        TOP_WARN2("message hop_num(%d) beyond max_hop", message.hop_num());
-        return;
+    uint32_t nodes_size = routing_table->nodes_size() + 1; // including self
+    uint64_t capacity_version = 0;
+    if (tree_mode_ == kLayeredTreeCapacity) {
+        capacity_version = NodeCapacityManager::Instance()->version();
+    }
+    LayeredPlanKey key{
+            routing_table->get_local_node_info()->hash64(),
+            membership_epoch(),
+            capacity_version,
+            nodes_size,
+            static_cast<uint32_t>(message.id() % nodes_size),
+            GetNeighborCount(message),
+            message.hop_num() == 0 };
+    {
+        std::unique_lock<std::mutex> lock(plan_map_mutex_);
+        if (key.membership_epoch != plan_map_epoch_) {
+            // plans of an older membership are never hit again
+            plan_map_.clear();
+            plan_map_epoch_ = key.membership_epoch;
+        }
+        auto iter = plan_map_.find(key);
+        if (iter != plan_map_.end()) {
+            ++plan_hit_count_;
+            return iter->second;
+        }
+    }
+    ++plan_miss_count_;
+
+    auto plan = std::make_shared<LayeredPlan>();
+    bool ret = false;
+    if (tree_mode_ == kLayeredTreeCapacity) {
+        std::vector<kadmlia::NodeInfoPtr> members;
+        routing_table->GetRangeNodes(0, routing_table->nodes_size(), members);
+        ret = GetCapacityBroadcastNodes(message, routing_table, members, *plan);
+    } else {
+        ret = GetNextBroadcastNodes(message, routing_table, *plan);
+    }
+    if (!ret) {
+        // self index not ready, do not remember the failure
+        return nullptr;
     }
 
-    if (ThisNodeIsEvil(message)) {
-        TOP_WARN2("this node(%s) is evil", HexEncode(global_xid->Get()).c_str());
-        return;
+    std::unique_lock<std::mutex> lock(plan_map_mutex_);
+    if (key.membership_epoch != plan_map_epoch_) {
+        // membership changed while the plan was built
+        return plan;
+    }
+    if (plan_map_.size() >= kMaxPlanCacheSize) {
+        TOP_DEBUG("layered plan cache full, clear. hit:%llu miss:%llu",
+                (unsigned long long)plan_hit_count_.load(),
+                (unsigned long long)plan_miss_count_.load());
+        plan_map_.clear();
     }
-    BlockSyncManager::Instance()->NewBroadcastMessage(message);
+    plan_map_[key] = plan;
+    return plan;
+}
+
+void BroadcastLayered::OnMembershipChanged() {
+    membership_epoch_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void BroadcastLayered::OnRoutingTableChanged() {
+    std::unique_lock<std::mutex> lock(plan_map_mutex_);
+    plan_map_.clear();
+}
 
-    std::vector<kadmlia::NodeInfoPtr> broadcast_nodes;
-    GetNextBroadcastNodes(
-            message,
-            routing_table,
-            broadcast_nodes);
-    Send(message, broadcast_nodes);
+void BroadcastLayered::GetPlanCacheStat(uint64_t& hit_count, uint64_t& miss_count) const {
+    hit_count = plan_hit_count_;
+    miss_count = plan_miss_count_;
 }
 
 uint32_t BroadcastLayered::FindLogicalSelfIndex(
@@ -81,10 +138,41 @@ void BroadcastLayered::GetRangeNodes(
     return;
 }
 
-void BroadcastLayered::GetNextBroadcastNodes(
+void BroadcastLayered::AddPlanChildren(
+        kadmlia::RoutingTablePtr& routing_table,
+        const LayeredRange& range,
+        uint32_t random_step,
+        uint32_t nodes_size,
+        uint32_t neighber_count,
+        LayeredPlan& plan) {
+    for (uint32_t i = range.begin; !range.empty() && i <= range.end; ++i) {
+        uint32_t real_index = FindRealSelfIndex(i, random_step, nodes_size) - 1;
+        std::vector<kadmlia::NodeInfoPtr> child;
+        GetRangeNodes(routing_table, real_index, real_index, child);
+        if (child.empty()) {
+            continue;
+        }
+        plan.nodes.push_back(child[0]);
+        plan.bypass_nodes.push_back(std::vector<kadmlia::NodeInfoPtr>());
+
+        // children of this child, used only when it is suspect
+        auto child_range = LayeredChildrenRange(i, neighber_count, nodes_size);
+        if (child_range.empty()) {
+            continue;
+        }
+        // attention the boundary value
+        GetRangeNodes(
+                routing_table,
+                FindRealSelfIndex(child_range.begin, random_step, nodes_size) - 1,
+                FindRealSelfIndex(child_range.end, random_step, nodes_size) - 1,
+                plan.bypass_nodes.back());
+    }
+}
+
+bool BroadcastLayered::GetNextBroadcastNodes(
         transport::protobuf::RoutingMessage& message,
         kadmlia::RoutingTablePtr& routing_table,
-        std::vector<kadmlia::NodeInfoPtr>& next_broadcast_nodes) {
+        LayeredPlan& plan) {
     uint32_t nodes_size = routing_table->nodes_size() + 1; // including self
     //uint32_t random_step = 0;
     uint32_t random_step = message.id() % nodes_size; // keep same random_step when this broadcast message alive
@@ -92,13 +180,13 @@ void BroadcastLayered::GetNextBroadcastNodes(
     if (real_self_index == -1) {
         TOP_WARN2("real_self_index: -1 error");
         //std::cout << "real_self_index: -1 error" << std::endl;
-        return;
+        return false;
     }
     real_self_index = static_cast<uint32_t>(real_self_index);
     //std::cout << "real_self_index:" << real_self_index <<" random_step:" << random_step << " nodes_size:" << nodes_size << " msgid:" << message.id() << std::endl;
     if (real_self_index <= 0 || real_self_index > nodes_size) {
         TOP_WARN2("real_self_index invalid, layerbroadcast failed");
-        return;
+        return false;
     }
 
     uint32_t logical_self_index = FindLogicalSelfIndex(real_self_index, random_step, nodes_size);
@@ -107,125 +195,145 @@ void BroadcastLayered::GetNextBroadcastNodes(
     uint32_t neighber_count = GetNeighborCount(message);
     if (message.hop_num() == 0) {
         // meaning this is the first broadcast packet, should choose the first K nodes
-        uint32_t min_real_index = FindRealSelfIndex(1, random_step, nodes_size) - 1;
-        uint32_t max_real_index = FindRealSelfIndex(neighber_count, random_step, nodes_size) - 1;
-        //std::cout << "first min_real_index:" << min_real_index << " max_real_index:" << max_real_index << std::endl;
-        GetRangeNodes(routing_table, min_real_index, max_real_index, next_broadcast_nodes);
+        auto first_range = LayeredChildrenRange(0, neighber_count, nodes_size);
+        if (first_range.empty()) {
+            return true;
+        }
+        AddPlanChildren(routing_table, first_range, random_step, nodes_size, neighber_count, plan);
         TOP_DEBUG("the first nodes of layerbroadcast");
         //std::cout << "first: next_broadcast_nodes size: " << next_broadcast_nodes.size() << std::endl;
         if (logical_self_index > neighber_count) {
-            return;
+            return true;
         }
     }
 
     // base self_sort_index choose next nodes sort_index
-    auto logical_result = choose_next_nodes(nodes_size, logical_self_index, neighber_count);
-    if (logical_result.empty()) {
-        return;
-    }
-    /*
-    for (auto& item: logical_result) {
-        std::cout << "item:" << item << "\t";
+    auto logical_range = LayeredChildrenRange(logical_self_index, neighber_count, nodes_size);
+    TOP_DEBUG("layered self_index:%d children:[%d, %d]",
+            logical_self_index, logical_range.begin, logical_range.end);
+    if (logical_range.empty()) {
+        return true;
     }
-    std::cout << std::endl;
-    */
 
     // index start from 1 to nodes_size
-    
-    uint32_t real_min_index = FindRealSelfIndex(logical_result[0], random_step, nodes_size);
-    uint32_t real_max_index = FindRealSelfIndex(logical_result[logical_result.size() - 1], random_step, nodes_size);
-
-    real_min_index -= 1;
-    real_max_index -= 1;
-
-    //std::cout << "real_min_index: " << real_min_index << " real_max_index:" << real_max_index << std::endl;
-
-    // attention the boundary value
-    GetRangeNodes(routing_table, real_min_index, real_max_index, next_broadcast_nodes);
-    //std::cout << "next_broadcast_nodes size:" << next_broadcast_nodes.size() << std::endl;
-    return;
+    AddPlanChildren(routing_table, logical_range, random_step, nodes_size, neighber_count, plan);
+    //std::cout << "next_broadcast_nodes size:" << plan.nodes.size() << std::endl;
+    return true;
 }
 
-int32_t BroadcastLayered::FindSelfSortIndex(
+bool BroadcastLayered::GetCapacityBroadcastNodes(
         transport::protobuf::RoutingMessage& message,
-        kadmlia::RoutingTablePtr& routing_table) {
-    // start from 1
-    int32_t index = routing_table->GetSelfIndex();
-    if (index == -1) {
-        return -1;
+        kadmlia::RoutingTablePtr& routing_table,
+        const std::vector<kadmlia::NodeInfoPtr>& members,
+        LayeredPlan& plan) {
+    // every relay sorts the same member set by hash64, so the tree does not
+    // depend on how a local routing table happens to order its nodes
+    uint64_t local_hash64 = routing_table->get_local_node_info()->hash64();
+    std::vector<std::pair<uint64_t, kadmlia::NodeInfoPtr>> sorted_members;
+    sorted_members.reserve(members.size() + 1);
+    sorted_members.push_back(std::make_pair(local_hash64, kadmlia::NodeInfoPtr()));
+    for (auto iter = members.begin(); iter != members.end(); ++iter) {
+        if ((*iter)->hash64 == local_hash64) {
+            continue;
+        }
+        sorted_members.push_back(std::make_pair((*iter)->hash64, *iter));
     }
-    return index + 1;
-}
+    std::sort(
+            sorted_members.begin(),
+            sorted_members.end(),
+            [](const std::pair<uint64_t, kadmlia::NodeInfoPtr>& left,
+                    const std::pair<uint64_t, kadmlia::NodeInfoPtr>& right) -> bool {
+        return left.first < right.first;
+    });
 
-std::vector<uint32_t> BroadcastLayered::choose_nodes(
-        int hop_num,
-        uint32_t self_sort_index,
-        uint32_t neighber_count,
-        const std::vector<uint32_t>& sort_nodes_index_vec) {
-    uint32_t sum1 = 0;
-    uint32_t K = neighber_count;
-    for (int i = 1; i < hop_num; ++i) {
-        // max i is hop_num -1
-        sum1 += pow(K, i);
-    }
-    uint32_t sum2 = sum1 + pow(K, hop_num);
-    if (self_sort_index <= sum1 || self_sort_index > sum2) {
-        // not right
-        return {};
-    }
-
-    uint32_t front_level_size = self_sort_index - sum1 - 1;
-    uint32_t begin  =  sum2 + front_level_size * K + 1;
-    uint32_t end = begin + K;
-    std::vector<uint32_t> result;
-    for ( uint32_t i = begin; i < end; ++i) {
-        if (i > sort_nodes_index_vec.size()) {
+    uint32_t nodes_size = sorted_members.size();
+    uint32_t random_step = message.id() % nodes_size;
+    std::vector<uint64_t> hash64_vec(nodes_size);
+    for (uint32_t i = 0; i < nodes_size; ++i) {
+        hash64_vec[i] = sorted_members[i].first;
+    }
+    std::vector<uint32_t> capacity_vec;
+    NodeCapacityManager::Instance()->GetNodesCapacity(hash64_vec, capacity_vec);
+    // this node by the class it advertises, as its peers place it; the map
+    // only holds what the others advertised
+    for (uint32_t i = 0; i < nodes_size; ++i) {
+        if (!sorted_members[i].second) {
+            capacity_vec[i] = CapacityTreeClass(NodeCapacityManager::Instance()->LocalCapacity());
             break;
         }
-        result.push_back(sort_nodes_index_vec[i-1]);
     }
-    return result;
-}
 
-uint32_t BroadcastLayered::find_hop_num(uint32_t self_sort_index, uint32_t neighber_count) {
-    uint32_t K = neighber_count;
-    uint32_t sum1 = 0;
-    uint32_t sum2 = 0;
-    uint32_t hop_num = 0;
-    for (uint32_t i = 0; ; ++i) {
-        sum1 += pow(K, i);
-        if (i == 0) {
-            sum1 = 0;
+    // logical order: higher capacity class first, inside one class the
+    // random_step rotation of the sort order, so interior load still moves
+    // between nodes of the same class from message to message
+    std::vector<uint32_t> logical_order(nodes_size);
+    std::vector<uint32_t> rotated_index(nodes_size);
+    for (uint32_t i = 0; i < nodes_size; ++i) {
+        logical_order[i] = i;
+        rotated_index[i] = FindLogicalSelfIndex(i + 1, random_step, nodes_size);
+    }
+    std::sort(
+            logical_order.begin(),
+            logical_order.end(),
+            [&capacity_vec, &rotated_index](uint32_t left, uint32_t right) -> bool {
+        if (capacity_vec[left] != capacity_vec[right]) {
+            return capacity_vec[left] > capacity_vec[right];
         }
-        sum2 = sum1 + pow(K, i+1);
-        if (self_sort_index > sum1 && self_sort_index <= sum2) {
-            hop_num = i + 1;
+        return rotated_index[left] < rotated_index[right];
+    });
+
+    uint32_t logical_self_index = 0;
+    for (uint32_t i = 0; i < nodes_size; ++i) {
+        if (!sorted_members[logical_order[i]].second) {
+            logical_self_index = i + 1;
             break;
         }
     }
-    return hop_num;
-}
+    assert(logical_self_index > 0);
 
-std::vector<uint32_t> BroadcastLayered::choose_next_nodes(
-        uint32_t count,
-        uint32_t self_node_index,
-        uint32_t neighber_count) {
-    if (self_node_index > count) {
-        return {};
-    }
-    std::vector<uint32_t> sort_nodes_index_vec;
-    // 1~64
-    for (uint32_t i = 0; i < count; ++i) {
-        sort_nodes_index_vec.push_back(i+1);
-    }
-    uint32_t hop_num = find_hop_num(self_node_index, neighber_count);
-    TOP_DEBUG("find_hop_num:%d self_index:%d", hop_num, self_node_index);
-    //std::cout << "find_hop:" << hop_num << std::endl;
+    uint32_t neighber_count = GetNeighborCount(message);
+    auto add_range = [&](const LayeredRange& range) {
+        for (uint32_t i = range.begin; !range.empty() && i <= range.end; ++i) {
+            auto& node = sorted_members[logical_order[i - 1]].second;
+            if (!node) {
+                continue;
+            }
+            plan.nodes.push_back(node);
+            plan.bypass_nodes.push_back(std::vector<kadmlia::NodeInfoPtr>());
+            auto child_range = LayeredChildrenRange(i, neighber_count, nodes_size);
+            for (uint32_t j = child_range.begin; !child_range.empty() && j <= child_range.end; ++j) {
+                auto& child = sorted_members[logical_order[j - 1]].second;
+                if (child) {
+                    plan.bypass_nodes.back().push_back(child);
+                }
+            }
+        }
+    };
 
-    auto result = choose_nodes(hop_num, self_node_index, neighber_count, sort_nodes_index_vec);
-    return result;
+    if (message.hop_num() == 0) {
+        add_range(LayeredChildrenRange(0, neighber_count, nodes_size));
+        if (logical_self_index > neighber_count) {
+            return true;
+        }
+    }
+    add_range(LayeredChildrenRange(logical_self_index, neighber_count, nodes_size));
+    TOP_DEBUG("capacity layered self_index:%u class:%u next nodes:%u",
+            logical_self_index,
+            capacity_vec[logical_order[logical_self_index - 1]],
+            static_cast<uint32_t>(plan.nodes.size()));
+    return true;
 }
 
+int32_t BroadcastLayered::FindSelfSortIndex(
+        transport::protobuf::RoutingMessage& message,
+        kadmlia::RoutingTablePtr& routing_table) {
+    // start from 1
+    int32_t index = routing_table->GetSelfIndex();
+    if (index == -1) {
+        return -1;
+    }
+    return index + 1;
+}
 
 }  // namespace gossip
 
@@ -0,0 +1,258 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/broadcast_striped.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "xbase/xhash.h"
+#include "xpbase/base/top_log.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xwrouter/xwrouter.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/layered_tree_index.h"
+#include "xgossip/include/striped_tree_index.h"
+#include "xgossip/include/block_sync_manager.h"
+#include "xgossip/include/gossip_pipeline.h"
+
+namespace top {
+
+namespace gossip {
+
+BroadcastStriped::BroadcastStriped(transport::TransportPtr transport_ptr)
+        : BroadcastLayered(transport_ptr) {}
+
+BroadcastStriped::~BroadcastStriped() {}
+
+std::string BroadcastStriped::EncodeStripe(const StripeHeader& header, const std::string& stripe) {
+    std::string data((const char*)&header, sizeof(header));
+    data.append(stripe);
+    return data;
+}
+
+bool BroadcastStriped::DecodeStripe(
+        const std::string& data,
+        StripeHeader& header,
+        std::string& stripe) {
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != kStripeMagic ||
+            header.stripe_count == 0 ||
+            header.stripe_index >= header.stripe_count) {
+        return false;
+    }
+    stripe = data.substr(sizeof(header));
+    return true;
+}
+
+void BroadcastStriped::Broadcast(
+        transport::protobuf::RoutingMessage& message,
+        kadmlia::RoutingTablePtr& routing_table) {
+    GossipStageTimer stage(message.gossip().gossip_type(), kGossipStageStopCheck);
+    if (message.hop_num() >= kadmlia::kHopToLive) {
+        TOP_WARN2("message hop_num(%d) beyond max_hop", message.hop_num());
+        return;
+    }
+
+    if (ThisNodeIsEvil(message)) {
+        TOP_WARN2("this node(%s) is evil", HexEncode(global_xid->Get()).c_str());
+        return;
+    }
+    BlockSyncManager::Instance()->NewBroadcastMessage(message);
+
+    StripeHeader header;
+    std::string stripe;
+    if (!DecodeStripe(message.data(), header, stripe)) {
+        if (message.hop_num() != 0) {
+            TOP_WARN2("striped broadcast message(%d) has no stripe header", message.type());
+            return;
+        }
+        SendStripes(message, routing_table);
+        return;
+    }
+
+    stage.Enter(kGossipStageSelect);
+    std::vector<kadmlia::NodeInfoPtr> stripe_nodes;
+    GetStripeNodes(message, routing_table, header.stripe_index, stripe_nodes);
+    Send(message, stripe_nodes, &stage);
+    std::string data;
+    if (!AddStripe(header, stripe, data)) {
+        return;
+    }
+
+    transport::protobuf::RoutingMessage whole_message = message;
+    whole_message.set_data(data);
+    whole_message.mutable_gossip()->set_msg_hash(header.msg_hash);
+    base::xpacket_t packet;
+    wrouter::Wrouter::Instance()->HandleOwnSyncPacket(whole_message, packet);
+    TOP_DEBUG("striped message msg_hash(%u) complete, size(%u)",
+            header.msg_hash, static_cast<uint32_t>(data.size()));
+}
+
+void BroadcastStriped::SendStripes(
+        transport::protobuf::RoutingMessage& message,
+        kadmlia::RoutingTablePtr& routing_table) {
+    uint32_t total_size = message.data().size();
+    uint32_t neighber_count = GetNeighborCount(message);
+    uint32_t stripe_count = (total_size + kMinStripeSize - 1) / kMinStripeSize;
+    stripe_count = std::max(1u, std::min(stripe_count, neighber_count));
+    uint32_t stripe_size = (total_size + stripe_count - 1) / stripe_count;
+    uint32_t msg_hash = message.gossip().msg_hash();
+
+    transport::protobuf::RoutingMessage stripe_template = message;
+    stripe_template.clear_data();
+    for (uint32_t i = 0; i < stripe_count; ++i) {
+        StripeHeader header;
+        header.magic = kStripeMagic;
+        header.msg_hash = msg_hash;
+        header.stripe_index = static_cast<uint16_t>(i);
+        header.stripe_count = static_cast<uint16_t>(stripe_count);
+        header.total_size = total_size;
+        uint32_t offset = std::min(i * stripe_size, total_size);
+
+        transport::protobuf::RoutingMessage stripe_message = stripe_template;
+        stripe_message.set_data(EncodeStripe(header, message.data().substr(offset, stripe_size)));
+        stripe_message.mutable_gossip()->set_msg_hash(GetStripeMessageHash(msg_hash, i));
+
+        std::vector<kadmlia::NodeInfoPtr> stripe_nodes;
+        if (!GetStripeNodes(stripe_message, routing_table, i, stripe_nodes)) {
+            return;
+        }
+        Send(stripe_message, stripe_nodes);
+    }
+    TOP_DEBUG("striped broadcast msg_hash(%u) size(%d) into %d stripes",
+            msg_hash, total_size, stripe_count);
+}
+
+bool BroadcastStriped::GetStripeNodes(
+        transport::protobuf::RoutingMessage& message,
+        kadmlia::RoutingTablePtr& routing_table,
+        uint32_t tree_index,
+        std::vector<kadmlia::NodeInfoPtr>& stripe_nodes) {
+    uint32_t nodes_size = routing_table->nodes_size() + 1; // including self
+    uint32_t random_step = message.id() % nodes_size;
+    int32_t real_self_index = FindSelfSortIndex(message, routing_table);
+    if (real_self_index <= 0 || static_cast<uint32_t>(real_self_index) > nodes_size) {
+        TOP_WARN2("real_self_index(%d) invalid, striped broadcast failed", real_self_index);
+        return false;
+    }
+
+    uint32_t neighber_count = GetNeighborCount(message);
+    uint32_t rotated_self_index = FindLogicalSelfIndex(real_self_index, random_step, nodes_size);
+    uint32_t logical_self_index = StripedLogicalIndex(
+            rotated_self_index, tree_index, neighber_count, nodes_size);
+
+    // children in the tree are scattered in the sort order, fetch one by one
+    auto add_range = [&](const LayeredRange& range) {
+        for (uint32_t i = range.begin; !range.empty() && i <= range.end; ++i) {
+            uint32_t rotated_index = StripedRotatedIndex(i, tree_index, neighber_count, nodes_size);
+            uint32_t real_index = FindRealSelfIndex(rotated_index, random_step, nodes_size) - 1;
+            GetRangeNodes(routing_table, real_index, real_index, stripe_nodes);
+        }
+    };
+
+    if (message.hop_num() == 0) {
+        add_range(LayeredChildrenRange(0, neighber_count, nodes_size));
+        if (logical_self_index > neighber_count) {
+            return true;
+        }
+    }
+    add_range(LayeredChildrenRange(logical_self_index, neighber_count, nodes_size));
+    return true;
+}
+
+bool BroadcastStriped::AddStripe(
+        const StripeHeader& header,
+        std::string& stripe,
+        std::string& data) {
+    std::shared_ptr<StripeItem> item;
+    {
+        std::unique_lock<std::mutex> lock(stripe_map_mutex_);
+        auto iter = stripe_map_.find(header.msg_hash);
+        if (iter == stripe_map_.end()) {
+            auto tp_now = std::chrono::steady_clock::now();
+            if (stripe_map_.size() >= kMaxStripeMapSize) {
+                DropOldStripesLocked(tp_now);
+            }
+            item = std::make_shared<StripeItem>();
+            item->stripe_count = header.stripe_count;
+            item->total_size = header.total_size;
+            item->received = 0;
+            item->delivered = false;
+            item->stripes.resize(header.stripe_count);
+            item->arrived.resize(header.stripe_count, false);
+            item->create_time = tp_now;
+            stripe_map_[header.msg_hash] = item;
+        } else {
+            item = iter->second;
+        }
+
+        if (item->delivered ||
+                item->stripe_count != header.stripe_count ||
+                item->total_size != header.total_size) {
+            return false;
+        }
+        if (item->arrived[header.stripe_index]) {
+            return false;
+        }
+        item->arrived[header.stripe_index] = true;
+        item->stripes[header.stripe_index].swap(stripe);
+        ++item->received;
+        if (item->received < item->stripe_count) {
+            return false;
+        }
+        item->delivered = true;
+    }
+
+    data.clear();
+    data.reserve(item->total_size);
+    for (auto iter = item->stripes.begin(); iter != item->stripes.end(); ++iter) {
+        data.append(*iter);
+    }
+    item->stripes.clear();
+    if (data.size() != item->total_size) {
+        TOP_WARN2("striped message msg_hash(%u) size(%u) not equal total_size(%u)",
+                header.msg_hash, static_cast<uint32_t>(data.size()), item->total_size);
+        return false;
+    }
+    return true;
+}
+
+void BroadcastStriped::DropOldStripesLocked(std::chrono::steady_clock::time_point tp_now) {
+    // messages past the timeout go first; if none is that old the oldest
+    // delivered one makes room, a message still being reassembled only
+    // when nothing else is left
+    auto timeout = std::chrono::seconds(kStripeTimeoutSec);
+    auto oldest = stripe_map_.end();
+    auto oldest_delivered = stripe_map_.end();
+    for (auto iter = stripe_map_.begin(); iter != stripe_map_.end();) {
+        auto& item = iter->second;
+        if (tp_now - item->create_time >= timeout) {
+            iter = stripe_map_.erase(iter);
+            continue;
+        }
+        auto& candidate = item->delivered ? oldest_delivered : oldest;
+        if (candidate == stripe_map_.end() || item->create_time < candidate->second->create_time) {
+            candidate = iter;
+        }
+        ++iter;
+    }
+    if (stripe_map_.size() < kMaxStripeMapSize) {
+        return;
+    }
+    stripe_map_.erase(oldest_delivered != stripe_map_.end() ? oldest_delivered : oldest);
+}
+
+uint32_t BroadcastStriped::GetStripeMessageHash(uint32_t msg_hash, uint32_t stripe_index) {
+    // every stripe must pass GossipFilter on its own
+    return base::xhash32_t::digest(std::to_string(msg_hash) + ":" + std::to_string(stripe_index));
+}
+
+}  // namespace gossip
+
+}  // namespace top
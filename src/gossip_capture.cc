@@ -0,0 +1,223 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_capture.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+template <typename T>
+static void PutUint(T value, std::string& data) {
+    for (uint32_t i = 0; i < sizeof(T); ++i) {
+        data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+template <typename T>
+static T GetUint(const char* data) {
+    T value = 0;
+    for (uint32_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+GossipCaptureWriter::~GossipCaptureWriter() {
+    Close();
+}
+
+bool GossipCaptureWriter::Open(const std::string& path) {
+    Close();
+    file_ = fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        TOP_ERROR("gossip capture open %s failed", path.c_str());
+        return false;
+    }
+    std::string header(kGossipCaptureMagic, sizeof(kGossipCaptureMagic));
+    PutUint<uint32_t>(kGossipCaptureVersion, header);
+    if (fwrite(header.data(), 1, header.size(), file_) != header.size()) {
+        TOP_ERROR("gossip capture write header to %s failed", path.c_str());
+        Close();
+        return false;
+    }
+    size_ = header.size();
+    return true;
+}
+
+void GossipCaptureWriter::Close() {
+    if (file_ == nullptr) {
+        return;
+    }
+    fclose(file_);
+    file_ = nullptr;
+}
+
+bool GossipCaptureWriter::Write(
+        uint64_t arrive_us,
+        const std::string& from_ip,
+        uint16_t from_port,
+        const std::string& message_data) {
+    if (file_ == nullptr || from_ip.size() > 0xff) {
+        return false;
+    }
+    uint32_t record_size = kGossipCaptureRecordFixedSize + from_ip.size() + message_data.size();
+    std::string head;
+    head.reserve(sizeof(record_size) + kGossipCaptureRecordFixedSize + from_ip.size());
+    PutUint<uint32_t>(record_size, head);
+    PutUint<uint64_t>(arrive_us, head);
+    PutUint<uint16_t>(from_port, head);
+    PutUint<uint8_t>(from_ip.size(), head);
+    head.append(from_ip);
+    if (fwrite(head.data(), 1, head.size(), file_) != head.size() ||
+            fwrite(message_data.data(), 1, message_data.size(), file_) != message_data.size()) {
+        TOP_WARN("gossip capture write failed");
+        return false;
+    }
+    size_ += head.size() + message_data.size();
+    return true;
+}
+
+GossipCaptureReader::~GossipCaptureReader() {
+    Close();
+}
+
+bool GossipCaptureReader::Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        TOP_ERROR("gossip capture open %s failed", path.c_str());
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < kGossipCaptureHeaderSize) {
+        TOP_ERROR("gossip capture %s too short", path.c_str());
+        close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        TOP_ERROR("gossip capture mmap %s failed", path.c_str());
+        return false;
+    }
+    base_ = static_cast<const char*>(addr);
+    size_ = file_stat.st_size;
+    if (memcmp(base_, kGossipCaptureMagic, sizeof(kGossipCaptureMagic)) != 0 ||
+            GetUint<uint32_t>(base_ + sizeof(kGossipCaptureMagic)) != kGossipCaptureVersion) {
+        TOP_ERROR("gossip capture %s bad header", path.c_str());
+        Close();
+        return false;
+    }
+    offset_ = kGossipCaptureHeaderSize;
+    return true;
+}
+
+void GossipCaptureReader::Close() {
+    if (base_ == nullptr) {
+        return;
+    }
+    munmap(const_cast<char*>(base_), size_);
+    base_ = nullptr;
+    size_ = 0;
+    offset_ = 0;
+}
+
+bool GossipCaptureReader::Next(GossipCaptureRecord& record) {
+    if (base_ == nullptr || offset_ + sizeof(uint32_t) > size_) {
+        return false;
+    }
+    const char* pos = base_ + offset_;
+    uint32_t record_size = GetUint<uint32_t>(pos);
+    if (record_size < kGossipCaptureRecordFixedSize ||
+            offset_ + sizeof(uint32_t) + record_size > size_) {
+        return false;
+    }
+    pos += sizeof(uint32_t);
+    uint8_t ip_size = GetUint<uint8_t>(pos + 10);
+    if (kGossipCaptureRecordFixedSize + ip_size > record_size) {
+        return false;
+    }
+    record.arrive_us = GetUint<uint64_t>(pos);
+    record.from_port = GetUint<uint16_t>(pos + 8);
+    record.from_ip.assign(pos + kGossipCaptureRecordFixedSize, ip_size);
+    record.message_data = pos + kGossipCaptureRecordFixedSize + ip_size;
+    record.message_size = record_size - kGossipCaptureRecordFixedSize - ip_size;
+    offset_ += sizeof(uint32_t) + record_size;
+    return true;
+}
+
+GossipCapture* GossipCapture::Instance() {
+    static GossipCapture ins;
+    return &ins;
+}
+
+bool GossipCapture::Start(const std::string& path, uint64_t max_bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    capturing_ = false;
+    if (!writer_.Open(path)) {
+        return false;
+    }
+    max_bytes_ = max_bytes;
+    record_count_ = 0;
+    capturing_ = true;
+    TOP_INFO("gossip capture to %s started, max bytes(%llu)", path.c_str(), (unsigned long long)max_bytes);
+    return true;
+}
+
+void GossipCapture::Stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    capturing_ = false;
+    writer_.Close();
+}
+
+void GossipCapture::Capture(
+        const transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port) {
+    if (!capturing()) {
+        return;
+    }
+    uint64_t arrive_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string message_data;
+    if (!message.SerializeToString(&message_data)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!capturing_) {
+        return;
+    }
+    if (!writer_.Write(arrive_us, from_ip, from_port, message_data)) {
+        capturing_ = false;
+        writer_.Close();
+        return;
+    }
+    ++record_count_;
+    if (max_bytes_ > 0 && writer_.size() >= max_bytes_) {
+        TOP_WARN("gossip capture reached max bytes(%llu), stopped", (unsigned long long)max_bytes_);
+        capturing_ = false;
+        writer_.Close();
+    }
+}
+
+void GossipCapture::GetStat(uint64_t& record_count, uint64_t& bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    record_count = record_count_;
+    bytes = writer_.size();
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -9,6 +9,9 @@
 #include "xpbase/base/top_log.h"
 #include "xpbase/base/top_timer.h"
 #include "xpbase/base/kad_key/kadmlia_key.h"
+#include "xgossip/include/gossip_capture.h"
+#include "xgossip/include/gossip_pipeline.h"
+#include "xgossip/include/gossip_trace.h"
 
 namespace top {
 
@@ -33,19 +36,18 @@ bool GossipFilter::Init() {
             kClearRstPeriod,
             std::bind(&GossipFilter::do_clear_and_reset, this));
 
-#ifndef NDEBUG
     remap_timer_ = std::make_shared<base::TimerRepeated>(base::TimerManager::Instance(), "GossipFilter:repeatmap");
     remap_timer_->Start(
             500ll * 1000ll,
             kClearRstPeriod,
-            std::bind(&GossipFilter::PrintRepeatMap, this));
-#endif
+            std::bind(&GossipFilter::RotateRepeatStat, this));
 
     inited_ = true;
     return true;
 }
 
-GossipFilter::GossipFilter() {
+GossipFilter::GossipFilter()
+        : repeat_sketch_(kRepeatSketchWidth, kRepeatSketchDepth, kRepeatWindowCount) {
 }
 
 GossipFilter::~GossipFilter() {
@@ -56,60 +58,55 @@ GossipFilter::~GossipFilter() {
 }
 
 void GossipFilter::AddRepeatMsg(uint32_t key) {
-#ifndef NDEBUG
-    std::unique_lock<std::mutex> lock(repeat_map_mutex_);
-    repeat_map_[key] += 1;
-#endif
+    repeat_sketch_.Add(key);
 }
 
-void GossipFilter::PrintRepeatMap() {
-#ifndef NDEBUG
-    {
-        std::unique_lock<std::mutex> lock(repeat_map_mutex_);
-        if (repeat_map_.size() <= 0) {
-            return;
-        }
-        uint32_t total_recv_count = 0;
-        uint32_t max_recv = 0;
-        for (auto& item : repeat_map_) {
-            auto key = item.first;
-            auto value = item.second;
-            total_recv_count += value;
-            if (value > max_recv) {
-                max_recv = value;
-            }
-        }
-        auto avg_recv_times = total_recv_count / repeat_map_.size();
-        TOP_DEBUG("gossipfilter repeat recv avg:%d max:%d mapsize:%d", avg_recv_times, max_recv, repeat_map_.size());
-
-        // do clear
-        if (repeat_map_.size() > 100000) {
-            repeat_map_.clear();
-        }
+void GossipFilter::RotateRepeatStat() {
+    GossipRepeatStat stat;
+    repeat_sketch_.GetStat(stat);
+    if (stat.receive_count > 0) {
+        TOP_INFO("gossipfilter repeat recv %s", stat.ToString().c_str());
     }
-#endif
+    repeat_sketch_.Rotate();
+}
+
+bool GossipFilter::FilterMessage(
+        transport::protobuf::RoutingMessage& message,
+        const std::string& from_ip,
+        uint16_t from_port) {
+    // pre_ip is whatever the sender put there, the packet says who sent it
+    GossipCapture::Instance()->Capture(message, from_ip, from_port);
+    return DoFilterMessage(message);
 }
 
 bool GossipFilter::FilterMessage(transport::protobuf::RoutingMessage& message) {
+    GossipCapture::Instance()->Capture(message, message.gossip().pre_ip(), message.gossip().pre_port());
+    return DoFilterMessage(message);
+}
+
+bool GossipFilter::DoFilterMessage(transport::protobuf::RoutingMessage& message) {
     assert(inited_);
+    GossipStageTimer stage(message.gossip().gossip_type(), kGossipStageDedup);
     auto gossip = message.gossip();
     if (!gossip.has_msg_hash()) {
         TOP_WARN("filter failed, gossip msg(%d) should set msg_hash", message.type());
         return true;;
     }
-#ifndef NDEBUG
     AddRepeatMsg(gossip.msg_hash());
-#endif
     if (message.xid() == global_xid->Get()) {
         TOP_WARN("message come back this original node,msg.type(%d)", message.type());
         return true;
     }
     if (FindData(gossip.msg_hash())) {
         TOP_DEBUG("GossipFilter FindData, filter msg");
+        GossipTraceScope trace(message);
+        trace.set_outcome(kGossipTraceDuplicate);
         return true;
     }
     if (!AddData(gossip.msg_hash())) {
         TOP_WARN("GossipFilter already exist, filter msg");
+        GossipTraceScope trace(message);
+        trace.set_outcome(kGossipTraceDuplicate);
         return true;
     }
     return false;
@@ -117,7 +114,7 @@ bool GossipFilter::FilterMessage(transport::protobuf::RoutingMessage& message) {
 
 bool GossipFilter::FindData(uint32_t key) {
     assert(current_index_ < 3 && current_index_ >= 0);
-    std::unique_lock<std::mutex> lock(current_index_mutex_);
+    std::unique_lock<LockWaitMutex> lock(current_index_mutex_);
     auto it_find = time_filter_[current_index_]->find(key);
     if (it_find != time_filter_[current_index_]->end()) {
         return it_find->second >= kRepeatedValue;
@@ -133,7 +130,7 @@ bool GossipFilter::FindData(uint32_t key) {
 
 bool GossipFilter::AddData(uint32_t key) {
     assert(current_index_ < 3 && current_index_ >= 0);
-    std::unique_lock<std::mutex> lock(current_index_mutex_);
+    std::unique_lock<LockWaitMutex> lock(current_index_mutex_);
     auto it_find = time_filter_[current_index_]->find(key);
     if (it_find != time_filter_[current_index_]->end()) {
         if (it_find->second >= kRepeatedValue) {
@@ -161,7 +158,7 @@ bool GossipFilter::AddData(uint32_t key) {
 void GossipFilter::do_clear_and_reset() {
     {
         assert(current_index_ < 3 && current_index_ >= 0);
-        std::unique_lock<std::mutex> lock(current_index_mutex_);
+        std::unique_lock<LockWaitMutex> lock(current_index_mutex_);
         uint32_t not_used_index = (current_index_ + 1) % 3;
         time_filter_[not_used_index]->clear();
         current_index_ = not_used_index;
@@ -8,7 +8,10 @@
 
 #include "xpbase/base/top_log.h"
 #include "xpbase/base/uint64_bloomfilter.h"
+#include "xgossip/include/gossip_metrics.h"
+#include "xgossip/include/gossip_pipeline.h"
 #include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/neighbor_liveness.h"
 
 namespace top {
 
@@ -69,7 +72,11 @@ uint64_t GossipInterface::GetDistance(const std::string& src, const std::string&
 
 void GossipInterface::Send(
         transport::protobuf::RoutingMessage& message,
-        const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+        const std::vector<kadmlia::NodeInfoPtr>& nodes,
+        GossipStageTimer* stage) {
+    if (stage != nullptr) {
+        stage->Enter(kGossipStageEncode);
+    }
     std::string body;
     if (!message.SerializeToString(&body)) {
         TOP_WARN2("wrouter message SerializeToString failed");
@@ -110,6 +117,10 @@ void GossipInterface::Send(
             TOP_WARN2("SendData to  endpoint(%s:%d) failed",
                     node_info_ptr->public_ip.c_str(),
                     node_info_ptr->public_port);
+            GossipMetrics::Instance()->AddSendFailed();
+            NeighborLiveness::Instance()->OnSendFailed(
+                    node_info_ptr->public_ip,
+                    node_info_ptr->public_port);
             return false;
         }
 #ifdef TOP_TESTING_PERFORMANCE
@@ -126,6 +137,9 @@ void GossipInterface::Send(
         return true;
     };
 
+    if (stage != nullptr) {
+        stage->Enter(kGossipStageTransmit);
+    }
     std::for_each(nodes.begin(), nodes.end(), each_call);
 }
 
@@ -152,12 +166,12 @@ std::vector<kadmlia::NodeInfoPtr> GossipInterface::GetRandomNodes(
             neighbors.begin() + number_to_get};
 }
 
-void GossipInterface::SelectNodes(
+void GossipInterface::GetSelectRange(
         transport::protobuf::RoutingMessage& message,
-        const std::vector<kadmlia::NodeInfoPtr>& nodes,
-        std::vector<kadmlia::NodeInfoPtr>& select_nodes) {
-    uint64_t min_dis = message.gossip().min_dis();
-    uint64_t max_dis = message.gossip().max_dis();
+        uint64_t& min_dis,
+        uint64_t& max_dis) {
+    min_dis = message.gossip().min_dis();
+    max_dis = message.gossip().max_dis();
     if (max_dis <= 0) {
         max_dis = std::numeric_limits<uint64_t>::max();
     }
@@ -185,6 +199,15 @@ void GossipInterface::SelectNodes(
             max_dis = std::numeric_limits<uint64_t>::max();
         }
     }
+}
+
+void GossipInterface::SelectNodes(
+        transport::protobuf::RoutingMessage& message,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes,
+        std::vector<kadmlia::NodeInfoPtr>& select_nodes) {
+    uint64_t min_dis = 0;
+    uint64_t max_dis = 0;
+    GetSelectRange(message, min_dis, max_dis);
 
     uint32_t select_num = GetNeighborCount(message);
     for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
@@ -210,35 +233,9 @@ void GossipInterface::SelectNodes(
         kadmlia::RoutingTablePtr& routing_table,
         std::shared_ptr<base::Uint64BloomFilter>& bloomfilter,
         std::vector<kadmlia::NodeInfoPtr>& select_nodes) {
-    uint64_t min_dis = message.gossip().min_dis();
-    uint64_t max_dis = message.gossip().max_dis();
-    if (max_dis <= 0) {
-        max_dis = std::numeric_limits<uint64_t>::max();
-    }
-    uint64_t left_min = message.gossip().left_min();
-    uint64_t right_max = message.gossip().right_max();
-    uint32_t left_overlap = message.gossip().left_overlap();
-    uint32_t right_overlap = message.gossip().right_overlap();
-    if (left_overlap > 0 && left_overlap < 20) {
-        uint64_t tmp_min_dis = min_dis;
-        double rate = (double)left_overlap / 10;
-        uint64_t step = static_cast<uint64_t>((tmp_min_dis - left_min) *  rate);
-        if (step > tmp_min_dis) {
-            min_dis = 0;
-        } else {
-            min_dis = tmp_min_dis - step;
-        }
-    }
-    if (right_overlap > 0 && right_overlap < 20) {
-        uint64_t tmp_max_dis = max_dis;
-        double rate = (double)right_overlap / 10;
-        uint64_t step = static_cast<uint64_t>((right_max -  max_dis) * rate);
-        if (std::numeric_limits<uint64_t>::max() - step > tmp_max_dis) {
-            max_dis = tmp_max_dis + step;
-        } else {
-            max_dis = std::numeric_limits<uint64_t>::max();
-        }
-    }
+    uint64_t min_dis = 0;
+    uint64_t max_dis = 0;
+    GetSelectRange(message, min_dis, max_dis);
 
     uint32_t select_num = GetNeighborCount(message);
     std::vector<kadmlia::NodeInfoPtr> nodes;
@@ -296,7 +293,8 @@ void GossipInterface::SelectNodes(
 
 void GossipInterface::SendLayered(
         transport::protobuf::RoutingMessage& message,
-        const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+        const std::vector<kadmlia::NodeInfoPtr>& nodes,
+        GossipStageTimer* stage) {
     uint64_t min_dis = message.gossip().min_dis();
     uint64_t max_dis = message.gossip().max_dis();
     if (max_dis <= 0) {
@@ -311,50 +309,20 @@ void GossipInterface::SendLayered(
     std::string xdata;
 
     for (uint32_t i = 0; i < nodes.size(); ++i) {
-        auto gossip = message.mutable_gossip();
-        if (i == 0) {
-            gossip->set_min_dis(min_dis);
-            gossip->set_left_min(min_dis);
-
-            if (nodes.size() == 1) {
-                gossip->set_max_dis(max_dis);
-                gossip->set_right_max(max_dis);
-            } else {
-                gossip->set_max_dis(nodes[0]->hash64);
-                gossip->set_right_max(nodes[1]->hash64);
-            }
+        // every child gets its own range, encode and transmit alternate
+        if (stage != nullptr) {
+            stage->Enter(kGossipStageEncode);
         }
-        
-        if (i > 0 && i < (nodes.size() - 1)) {
-            gossip->set_min_dis(nodes[i - 1]->hash64);
-            gossip->set_max_dis(nodes[i]->hash64);
-            
-            if (i == 1) {
-                gossip->set_left_min(min_dis);
-            } else {
-                gossip->set_left_min(nodes[i - 2]->hash64);
-            }
-            gossip->set_right_max(nodes[i + 1]->hash64);
-        } 
-
-        if (i > 0 && i == (nodes.size() - 1)) {
-            gossip->set_min_dis(nodes[i - 1]->hash64);
-            gossip->set_max_dis(max_dis);
-
-            if (i == 1) {
-                gossip->set_left_min(min_dis);
-            } else {
-                gossip->set_left_min(nodes[i - 2]->hash64);
-            }
-            gossip->set_right_max(max_dis);
-        }
-
+        SetLayeredRange(message, nodes, i, min_dis, max_dis);
         std::string body;
         if (!message.SerializeToString(&body)) {
             TOP_WARN2("wrouter message SerializeToString failed");
             return;
         }
         xdata = header + body;
+        if (stage != nullptr) {
+            stage->Enter(kGossipStageTransmit);
+        }
         packet.reset();
         packet.get_body().push_back((uint8_t*)xdata.data(), xdata.size());
         packet.set_to_ip_addr(nodes[i]->public_ip);
@@ -364,6 +332,8 @@ void GossipInterface::SendLayered(
             TOP_WARN2("SendData to  endpoint(%s:%d) failed",
                     nodes[i]->public_ip.c_str(),
                     nodes[i]->public_port);
+            GossipMetrics::Instance()->AddSendFailed();
+            NeighborLiveness::Instance()->OnSendFailed(nodes[i]->public_ip, nodes[i]->public_port);
             continue;
         }
 #ifdef TOP_TESTING_PERFORMANCE
@@ -376,6 +346,103 @@ void GossipInterface::SendLayered(
     };
 }
 
+void GossipInterface::SetLayeredRange(
+        transport::protobuf::RoutingMessage& message,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes,
+        uint32_t i,
+        uint64_t min_dis,
+        uint64_t max_dis) {
+    auto gossip = message.mutable_gossip();
+    if (i == 0) {
+        gossip->set_min_dis(min_dis);
+        gossip->set_left_min(min_dis);
+
+        if (nodes.size() == 1) {
+            gossip->set_max_dis(max_dis);
+            gossip->set_right_max(max_dis);
+        } else {
+            gossip->set_max_dis(nodes[0]->hash64);
+            gossip->set_right_max(nodes[1]->hash64);
+        }
+    }
+    
+    if (i > 0 && i < (nodes.size() - 1)) {
+        gossip->set_min_dis(nodes[i - 1]->hash64);
+        gossip->set_max_dis(nodes[i]->hash64);
+        
+        if (i == 1) {
+            gossip->set_left_min(min_dis);
+        } else {
+            gossip->set_left_min(nodes[i - 2]->hash64);
+        }
+        gossip->set_right_max(nodes[i + 1]->hash64);
+    } 
+
+    if (i > 0 && i == (nodes.size() - 1)) {
+        gossip->set_min_dis(nodes[i - 1]->hash64);
+        gossip->set_max_dis(max_dis);
+
+        if (i == 1) {
+            gossip->set_left_min(min_dis);
+        } else {
+            gossip->set_left_min(nodes[i - 2]->hash64);
+        }
+        gossip->set_right_max(max_dis);
+    }
+}
+
+void GossipInterface::SendLayeredBypass(
+        transport::protobuf::RoutingMessage& message,
+        kadmlia::RoutingTablePtr& routing_table,
+        std::shared_ptr<base::Uint64BloomFilter>& bloomfilter,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes,
+        uint64_t min_dis,
+        uint64_t max_dis) {
+    if (!NeighborLiveness::Instance()->HasSuspect()) {
+        return;
+    }
+
+    if (max_dis <= 0) {
+        max_dis = std::numeric_limits<uint64_t>::max();
+    }
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        if (!NeighborLiveness::Instance()->IsSuspect(nodes[i]->public_ip, nodes[i]->public_port)) {
+            continue;
+        }
+
+        // act as the suspect child: choose from its range and send to the
+        // nodes it would have chosen
+        transport::protobuf::RoutingMessage bypass_message = message;
+        SetLayeredRange(bypass_message, nodes, i, min_dis, max_dis);
+        bypass_message.set_hop_num(message.hop_num() + 1);
+        auto bypass_bloomfilter = std::make_shared<base::Uint64BloomFilter>(
+                bloomfilter->Uint64Vector(),
+                kGossipBloomfilterHashNum);
+        bypass_bloomfilter->Add(nodes[i]->hash64);
+        std::vector<kadmlia::NodeInfoPtr> bypass_nodes;
+        SelectNodes(bypass_message, routing_table, bypass_bloomfilter, bypass_nodes);
+        if (bypass_nodes.empty()) {
+            continue;
+        }
+
+        if ((bypass_message.hop_num() + 1) > bypass_message.gossip().ign_bloomfilter_level()) {
+            for (auto iter = bypass_nodes.begin(); iter != bypass_nodes.end(); ++iter) {
+                bypass_bloomfilter->Add((*iter)->hash64);
+            }
+        }
+        const std::vector<uint64_t>& bloomfilter_vec = bypass_bloomfilter->Uint64Vector();
+        bypass_message.clear_bloomfilter();
+        for (uint32_t j = 0; j < bloomfilter_vec.size(); ++j) {
+            bypass_message.add_bloomfilter(bloomfilter_vec[j]);
+        }
+        TOP_DEBUG("neighbor(%s:%u) suspect, bypass to %u nodes",
+                nodes[i]->public_ip.c_str(),
+                nodes[i]->public_port,
+                static_cast<uint32_t>(bypass_nodes.size()));
+        SendLayered(bypass_message, bypass_nodes);
+    }
+}
+
 #define OUT_NETWORK_IPS
 #ifdef OUT_NETWORK_IPS
 static const std::unordered_set<std::string> test_for_valid_ip_set{
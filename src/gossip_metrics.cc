@@ -0,0 +1,240 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_metrics.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+namespace top {
+
+namespace gossip {
+
+const uint32_t GossipHistogram::kSubBucketBits;
+const uint32_t GossipHistogram::kBucketCount;
+
+namespace {
+
+const char* const kOutcomeNames[kGossipMetricOutcomeCount] = {
+    "dropped",
+    "forwarded",
+    "duplicate",
+    "hop_limit",
+    "stopped",
+    "no_neighbor",
+};
+
+uint32_t ThreadStripe() {
+    static std::atomic<uint32_t> next_stripe{ 0 };
+    static thread_local uint32_t stripe = next_stripe.fetch_add(1) % kGossipMetricStripeCount;
+    return stripe;
+}
+
+void AppendLine(std::string& out, const char* name, const char* labels, uint64_t value) {
+    char line[256];
+    snprintf(line, sizeof(line), "%s%s %llu\n", name, labels, (unsigned long long)value);
+    out += line;
+}
+
+void AppendHistogram(std::string& out, const char* name, const GossipHistogramSnapshot& histogram) {
+    char metric[128];
+    snprintf(metric, sizeof(metric), "%s_count", name);
+    AppendLine(out, metric, "", histogram.count);
+    snprintf(metric, sizeof(metric), "%s_sum", name);
+    AppendLine(out, metric, "", histogram.sum);
+    snprintf(metric, sizeof(metric), "%s_max", name);
+    AppendLine(out, metric, "", histogram.max);
+    AppendLine(out, name, "{quantile=\"0.5\"}", histogram.Percentile(0.5));
+    AppendLine(out, name, "{quantile=\"0.99\"}", histogram.Percentile(0.99));
+}
+
+}  // namespace
+
+void GossipStripedCounter::Add(uint64_t value) {
+    stripes_[ThreadStripe()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t GossipStripedCounter::Get() const {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < kGossipMetricStripeCount; ++i) {
+        sum += stripes_[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t GossipHistogramSnapshot::Percentile(double rate) const {
+    if (count == 0 || buckets.empty()) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(rate * count);
+    uint64_t seen = 0;
+    for (auto iter = buckets.begin(); iter != buckets.end(); ++iter) {
+        seen += iter->second;
+        if (seen > rank) {
+            return iter->first;
+        }
+    }
+    return buckets.back().first;
+}
+
+uint32_t GossipHistogram::BucketIndex(uint64_t value) {
+    const uint64_t sub_count = 1ull << kSubBucketBits;
+    if (value < sub_count) {
+        return static_cast<uint32_t>(value);
+    }
+    uint32_t exponent = 63u - __builtin_clzll(value);
+    uint32_t sub_index = static_cast<uint32_t>((value >> (exponent - kSubBucketBits)) & (sub_count - 1));
+    return ((exponent - kSubBucketBits + 1u) << kSubBucketBits) + sub_index;
+}
+
+uint64_t GossipHistogram::BucketLowerBound(uint32_t index) {
+    const uint32_t sub_count = 1u << kSubBucketBits;
+    if (index < sub_count) {
+        return index;
+    }
+    uint32_t exponent = (index >> kSubBucketBits) + kSubBucketBits - 1u;
+    uint64_t sub_index = index & (sub_count - 1);
+    return (1ull << exponent) | (sub_index << (exponent - kSubBucketBits));
+}
+
+void GossipHistogram::Add(uint64_t value) {
+    auto& stripe = stripes_[ThreadStripe()];
+    stripe.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    stripe.sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = stripe.max.load(std::memory_order_relaxed);
+    while (value > max && !stripe.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void GossipHistogram::GetSnapshot(GossipHistogramSnapshot& snapshot) const {
+    snapshot.buckets.clear();
+    snapshot.count = 0;
+    snapshot.sum = 0;
+    snapshot.max = 0;
+    // count from the buckets, so percentiles agree with it under writers
+    for (uint32_t i = 0; i < kBucketCount; ++i) {
+        uint64_t bucket_count = 0;
+        for (uint32_t j = 0; j < kGossipMetricStripeCount; ++j) {
+            bucket_count += stripes_[j].buckets[i].load(std::memory_order_relaxed);
+        }
+        if (bucket_count == 0) {
+            continue;
+        }
+        snapshot.buckets.push_back(std::make_pair(BucketLowerBound(i), bucket_count));
+        snapshot.count += bucket_count;
+    }
+    for (uint32_t j = 0; j < kGossipMetricStripeCount; ++j) {
+        snapshot.sum += stripes_[j].sum.load(std::memory_order_relaxed);
+        snapshot.max = std::max(snapshot.max, stripes_[j].max.load(std::memory_order_relaxed));
+    }
+}
+
+std::string GossipMetricsSnapshot::ToString() const {
+    std::string out;
+    char labels[128];
+    for (auto iter = type_outcomes.begin(); iter != type_outcomes.end(); ++iter) {
+        for (uint32_t i = 0; i < iter->second.size() && i < kGossipMetricOutcomeCount; ++i) {
+            snprintf(labels, sizeof(labels), "{gossip_type=\"%u\",outcome=\"%s\"}",
+                    iter->first, kOutcomeNames[i]);
+            AppendLine(out, "xgossip_messages", labels, iter->second[i]);
+        }
+    }
+    for (auto iter = message_type_outcomes.begin(); iter != message_type_outcomes.end(); ++iter) {
+        for (uint32_t i = 0; i < iter->second.size() && i < kGossipMetricOutcomeCount; ++i) {
+            if (iter->second[i] == 0) {
+                continue;
+            }
+            snprintf(labels, sizeof(labels), "{message_type=\"%u\",outcome=\"%s\"}",
+                    iter->first, kOutcomeNames[i]);
+            AppendLine(out, "xgossip_message_type_messages", labels, iter->second[i]);
+        }
+    }
+    AppendHistogram(out, "xgossip_fanout", fanout);
+    AppendHistogram(out, "xgossip_bloomfilter_fill_permille", bloomfilter_fill);
+    AppendLine(out, "xgossip_send_failed", "", send_failed);
+    AppendLine(out, "xgossip_sync_ask", "", sync_ask);
+    AppendLine(out, "xgossip_sync_fetched", "", sync_fetched);
+    AppendLine(out, "xgossip_sync_timeout", "", sync_timeout);
+    return out;
+}
+
+GossipMetrics* GossipMetrics::Instance() {
+    static GossipMetrics ins;
+    return &ins;
+}
+
+void GossipMetrics::AddOutcome(
+        uint32_t gossip_type,
+        uint32_t message_type,
+        uint32_t outcome,
+        uint32_t fanout) {
+    if (outcome >= kGossipMetricOutcomeCount) {
+        return;
+    }
+    if (gossip_type >= kGossipMetricTypeCount) {
+        gossip_type = 0;
+    }
+    if (message_type >= kGossipMetricMessageTypeCount) {
+        message_type = 0;
+    }
+    type_outcomes_[gossip_type][outcome].Add(1);
+    message_type_outcomes_[ThreadStripe()].outcomes[message_type][outcome].fetch_add(
+            1,
+            std::memory_order_relaxed);
+    if (outcome == kGossipTraceForwarded) {
+        fanout_.Add(fanout);
+    }
+}
+
+void GossipMetrics::AddBloomfilterFill(const std::vector<uint64_t>& bloomfilter) {
+    if (bloomfilter.empty()) {
+        return;
+    }
+    uint64_t set_bits = 0;
+    for (auto iter = bloomfilter.begin(); iter != bloomfilter.end(); ++iter) {
+        set_bits += __builtin_popcountll(*iter);
+    }
+    bloomfilter_fill_.Add(set_bits * 1000u / (bloomfilter.size() * 64u));
+}
+
+void GossipMetrics::GetSnapshot(GossipMetricsSnapshot& snapshot) {
+    snapshot.type_outcomes.clear();
+    snapshot.message_type_outcomes.clear();
+    for (uint32_t type = 0; type < kGossipMetricTypeCount; ++type) {
+        std::vector<uint64_t> counts(kGossipMetricOutcomeCount, 0);
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < kGossipMetricOutcomeCount; ++i) {
+            counts[i] = type_outcomes_[type][i].Get();
+            total += counts[i];
+        }
+        if (total > 0) {
+            snapshot.type_outcomes[type].swap(counts);
+        }
+    }
+    for (uint32_t type = 0; type < kGossipMetricMessageTypeCount; ++type) {
+        std::vector<uint64_t> counts(kGossipMetricOutcomeCount, 0);
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < kGossipMetricOutcomeCount; ++i) {
+            for (uint32_t stripe = 0; stripe < kGossipMetricStripeCount; ++stripe) {
+                counts[i] += message_type_outcomes_[stripe].outcomes[type][i].load(
+                        std::memory_order_relaxed);
+            }
+            total += counts[i];
+        }
+        if (total > 0) {
+            snapshot.message_type_outcomes[type].swap(counts);
+        }
+    }
+    fanout_.GetSnapshot(snapshot.fanout);
+    bloomfilter_fill_.GetSnapshot(snapshot.bloomfilter_fill);
+    snapshot.send_failed = send_failed_.Get();
+    snapshot.sync_ask = sync_ask_.Get();
+    snapshot.sync_fetched = sync_fetched_.Get();
+    snapshot.sync_timeout = sync_timeout_.Get();
+}
+
+}  // namespace gossip
+
+}  // namespace top
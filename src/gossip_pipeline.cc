@@ -0,0 +1,148 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_pipeline.h"
+
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <chrono>
+#include <thread>
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace {
+
+const char* const kStageNames[kGossipStageCount] = {
+    "dedup",
+    "stop_check",
+    "select",
+    "filter_update",
+    "encode",
+    "transmit",
+};
+
+}  // namespace
+
+uint64_t GossipStageCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+GossipStageStat* GossipStageStat::Instance() {
+    static GossipStageStat ins;
+    return &ins;
+}
+
+void GossipStageStat::SetEnabled(bool enabled) {
+    if (enabled) {
+        auto tp_start = std::chrono::steady_clock::now();
+        uint64_t cycles_start = GossipStageCycles();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t cycles = GossipStageCycles() - cycles_start;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - tp_start).count();
+        if (us > 0 && cycles > 0) {
+            cycles_per_us_.store(static_cast<double>(cycles) / us, std::memory_order_relaxed);
+        }
+    }
+    enabled_.store(enabled, std::memory_order_relaxed);
+    TOP_INFO("gossip stage timing %s, %.1f cycles/us", enabled ? "on" : "off", cycles_per_us());
+}
+
+void GossipStageStat::Add(uint32_t gossip_type, uint32_t stage, uint64_t cycles) {
+    if (stage >= kGossipStageCount) {
+        return;
+    }
+    if (gossip_type >= kGossipMetricTypeCount) {
+        gossip_type = 0;
+    }
+    histograms_[gossip_type][stage].Add(cycles);
+}
+
+void GossipStageStat::GetSnapshot(
+        uint32_t gossip_type,
+        uint32_t stage,
+        GossipHistogramSnapshot& snapshot) const {
+    snapshot = GossipHistogramSnapshot();
+    if (gossip_type >= kGossipMetricTypeCount || stage >= kGossipStageCount) {
+        return;
+    }
+    histograms_[gossip_type][stage].GetSnapshot(snapshot);
+}
+
+std::string GossipStageStat::ToString() const {
+    std::string out;
+    char line[256];
+    double cycles_per_us = cycles_per_us_.load(std::memory_order_relaxed);
+    for (uint32_t type = 0; type < kGossipMetricTypeCount; ++type) {
+        for (uint32_t stage = 0; stage < kGossipStageCount; ++stage) {
+            GossipHistogramSnapshot snapshot;
+            histograms_[type][stage].GetSnapshot(snapshot);
+            if (snapshot.count == 0) {
+                continue;
+            }
+            snprintf(line, sizeof(line), "gossip_type:%u stage:%s count:%llu p50:%.2fus p99:%.2fus max:%.2fus\n",
+                    type,
+                    kStageNames[stage],
+                    (unsigned long long)snapshot.count,
+                    snapshot.Percentile(0.5) / cycles_per_us,
+                    snapshot.Percentile(0.99) / cycles_per_us,
+                    snapshot.max / cycles_per_us);
+            out += line;
+        }
+    }
+    return out;
+}
+
+GossipStageTimer::GossipStageTimer(uint32_t gossip_type, GossipStage stage)
+        : enabled_(GossipStageStat::Instance()->enabled()), gossip_type_(gossip_type) {
+    if (enabled_) {
+        EnterStage(stage);
+    }
+}
+
+void GossipStageTimer::EnterStage(GossipStage stage) {
+    uint64_t now = GossipStageCycles();
+    if (stage_ < kGossipStageCount) {
+        cycles_[stage_] += now - start_;
+    }
+    if (!(entered_ & (1u << stage))) {
+        entered_ |= (1u << stage);
+        cycles_[stage] = 0;
+    }
+    stage_ = stage;
+    start_ = now;
+}
+
+void GossipStageTimer::Stop() {
+    if (!enabled_) {
+        return;
+    }
+    if (stage_ < kGossipStageCount) {
+        cycles_[stage_] += GossipStageCycles() - start_;
+    }
+    auto stat = GossipStageStat::Instance();
+    for (uint32_t i = 0; i < kGossipStageCount; ++i) {
+        if (entered_ & (1u << i)) {
+            stat->Add(gossip_type_, i, cycles_[i]);
+        }
+    }
+    enabled_ = false;
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,41 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_registry.h"
+
+#include "xpbase/base/top_log.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_bloomfilter.h"
+#include "xgossip/include/gossip_bloomfilter_layer.h"
+#include "xgossip/include/gossip_set_layer.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+GossipRegistry::GossipRegistry(transport::TransportPtr transport_ptr) {
+    Register(kGossipBloomfilter, std::make_shared<GossipBloomfilter>(transport_ptr));
+    Register(kGossipLayeredBroadcast, std::make_shared<BroadcastLayered>(transport_ptr));
+    Register(kGossipBloomfilterAndLayered, std::make_shared<GossipBloomfilterLayer>(transport_ptr));
+    Register(kGossipSetFilterAndLayered, std::make_shared<GossipSetLayer>(transport_ptr));
+    Register(kGossipLayeredCapacity, std::make_shared<BroadcastLayered>(transport_ptr, kLayeredTreeCapacity));
+}
+
+bool GossipRegistry::Broadcast(
+        const GossipContext& context,
+        transport::protobuf::RoutingMessage& message) {
+    uint32_t gossip_type = message.gossip().gossip_type();
+    if (!Has(gossip_type)) {
+        TOP_WARN2("gossip type(%u) not registered, msg.type(%d)", gossip_type, message.type());
+        return false;
+    }
+    auto& entry = entries_[gossip_type];
+    entry.run(entry.engine.get(), context, message);
+    return true;
+}
+
+}  // namespace gossip
+
+}  // namespace top
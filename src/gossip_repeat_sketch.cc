@@ -0,0 +1,196 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_repeat_sketch.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace top {
+
+namespace gossip {
+
+namespace {
+
+bool RepeatGreater(const std::pair<uint32_t, uint32_t>& lhs, const std::pair<uint32_t, uint32_t>& rhs) {
+    return lhs.second > rhs.second;
+}
+
+bool RepeatLess(const std::pair<uint32_t, uint32_t>& lhs, const std::pair<uint32_t, uint32_t>& rhs) {
+    return lhs.second < rhs.second;
+}
+
+}  // namespace
+
+std::string GossipRepeatStat::ToString() const {
+    char line[128];
+    snprintf(line, sizeof(line), "receive:%llu message:%llu avg:%.2f max:%u dist:",
+            (unsigned long long)receive_count,
+            (unsigned long long)message_count,
+            message_count > 0 ? (double)receive_count / message_count : 0.0,
+            max_repeat);
+    std::string out(line);
+    for (uint32_t i = 1; i < repeat_distribution.size(); ++i) {
+        if (repeat_distribution[i] == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line), " %u%s=%llu",
+                i,
+                i + 1 == repeat_distribution.size() ? "+" : "",
+                (unsigned long long)repeat_distribution[i]);
+        out += line;
+    }
+    out += " top:";
+    for (uint32_t i = 0; i < top_messages.size() && i < 8; ++i) {
+        snprintf(line, sizeof(line), " %u=%u", top_messages[i].first, top_messages[i].second);
+        out += line;
+    }
+    return out;
+}
+
+GossipRepeatSketch::GossipRepeatSketch(uint32_t width, uint32_t depth, uint32_t window_count)
+        : width_(1), depth_(std::max(depth, 1u)) {
+    while (width_ < width) {
+        width_ <<= 1;
+    }
+    window_count = std::max(window_count, 1u);
+    for (uint32_t i = 0; i <= window_count; ++i) {
+        std::unique_ptr<Window> window(new Window());
+        window->counters.reset(new std::atomic<uint32_t>[width_ * depth_]);
+        ClearWindow(*window);
+        windows_.push_back(std::move(window));
+    }
+}
+
+uint32_t GossipRepeatSketch::Index(uint32_t msg_hash, uint32_t row) const {
+    uint64_t hash = (msg_hash + (row + 1) * 0x9e3779b97f4a7c15ull) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return row * width_ + static_cast<uint32_t>(hash & (width_ - 1));
+}
+
+void GossipRepeatSketch::ClearWindow(Window& window) {
+    for (uint32_t i = 0; i < width_ * depth_; ++i) {
+        window.counters[i].store(0, std::memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < kRepeatBuckets; ++i) {
+        window.distribution[i].store(0, std::memory_order_relaxed);
+    }
+    window.receive_count.store(0, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(window.top_mutex);
+    window.top_messages.clear();
+    window.top_threshold.store(2, std::memory_order_relaxed);
+}
+
+uint32_t GossipRepeatSketch::Add(uint32_t msg_hash) {
+    Window& window = *windows_[current_.load(std::memory_order_acquire)];
+    uint32_t repeat = 0xffffffffu;
+    for (uint32_t row = 0; row < depth_; ++row) {
+        uint32_t count = window.counters[Index(msg_hash, row)].fetch_add(1, std::memory_order_relaxed) + 1;
+        repeat = std::min(repeat, count);
+    }
+    window.receive_count.fetch_add(1, std::memory_order_relaxed);
+    // the message moves from the bucket of repeat - 1 to that of repeat,
+    // the last bucket keeps it
+    if (repeat < kRepeatBuckets) {
+        window.distribution[repeat].fetch_add(1, std::memory_order_relaxed);
+        if (repeat > 1) {
+            window.distribution[repeat - 1].fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    if (repeat >= window.top_threshold.load(std::memory_order_relaxed)) {
+        UpdateTop(window, msg_hash, repeat);
+    }
+    return repeat;
+}
+
+void GossipRepeatSketch::UpdateTop(Window& window, uint32_t msg_hash, uint32_t repeat) {
+    std::unique_lock<std::mutex> lock(window.top_mutex);
+    auto& top = window.top_messages;
+    auto iter = top.begin();
+    for (; iter != top.end(); ++iter) {
+        if (iter->first == msg_hash) {
+            iter->second = std::max(iter->second, repeat);
+            break;
+        }
+    }
+    if (iter == top.end()) {
+        if (top.size() < kRepeatTopCount) {
+            top.push_back(std::make_pair(msg_hash, repeat));
+        } else {
+            auto min_iter = std::min_element(top.begin(), top.end(), RepeatLess);
+            if (repeat <= min_iter->second) {
+                return;
+            }
+            *min_iter = std::make_pair(msg_hash, repeat);
+        }
+    }
+    if (top.size() < kRepeatTopCount) {
+        return;
+    }
+    // once full only messages passing the least kept one take the lock,
+    // kept ones always do as their estimate only grows
+    uint32_t min_repeat = 0xffffffffu;
+    for (auto top_iter = top.begin(); top_iter != top.end(); ++top_iter) {
+        min_repeat = std::min(min_repeat, top_iter->second);
+    }
+    window.top_threshold.store(min_repeat + 1, std::memory_order_relaxed);
+}
+
+void GossipRepeatSketch::Rotate() {
+    std::unique_lock<std::mutex> lock(rotate_mutex_);
+    uint32_t next = (current_.load(std::memory_order_relaxed) + 1) % windows_.size();
+    // the spare window, neither written nor reported
+    ClearWindow(*windows_[next]);
+    current_.store(next, std::memory_order_release);
+}
+
+void GossipRepeatSketch::GetStat(GossipRepeatStat& stat) {
+    stat = GossipRepeatStat();
+    stat.repeat_distribution.assign(kRepeatBuckets, 0);
+    std::vector<int64_t> distribution(kRepeatBuckets, 0);
+    std::unordered_map<uint32_t, uint32_t> top_map;
+    uint32_t current = current_.load(std::memory_order_acquire);
+    uint32_t window_size = windows_.size();
+    // every window but the spare one after current
+    for (uint32_t i = 0; i + 1 < window_size; ++i) {
+        Window& window = *windows_[(current + window_size - i) % window_size];
+        stat.receive_count += window.receive_count.load(std::memory_order_relaxed);
+        for (uint32_t j = 0; j < kRepeatBuckets; ++j) {
+            distribution[j] += window.distribution[j].load(std::memory_order_relaxed);
+        }
+        std::unique_lock<std::mutex> lock(window.top_mutex);
+        // a message crossing windows is summed, in the distribution it
+        // shows once per window
+        for (auto iter = window.top_messages.begin(); iter != window.top_messages.end(); ++iter) {
+            top_map[iter->first] += iter->second;
+        }
+    }
+    for (uint32_t i = 1; i < kRepeatBuckets; ++i) {
+        if (distribution[i] > 0) {
+            stat.repeat_distribution[i] = distribution[i];
+            stat.message_count += distribution[i];
+        }
+    }
+    stat.top_messages.assign(top_map.begin(), top_map.end());
+    std::sort(stat.top_messages.begin(), stat.top_messages.end(), RepeatGreater);
+    if (stat.top_messages.size() > kRepeatTopCount) {
+        stat.top_messages.resize(kRepeatTopCount);
+    }
+    if (!stat.top_messages.empty()) {
+        stat.max_repeat = stat.top_messages.front().second;
+    } else {
+        for (uint32_t i = kRepeatBuckets - 1; i > 0; --i) {
+            if (stat.repeat_distribution[i] > 0) {
+                stat.max_repeat = i;
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace gossip
+
+}  // namespace top
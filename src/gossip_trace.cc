@@ -0,0 +1,168 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/gossip_trace.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "xpbase/base/top_log.h"
+#include "xgossip/include/gossip_metrics.h"
+
+namespace top {
+
+namespace gossip {
+
+const uint64_t GossipTraceRing::kCapacity;
+
+GossipTrace* GossipTrace::Instance() {
+    static GossipTrace ins;
+    return &ins;
+}
+
+void GossipTrace::SetSampleRate(uint32_t sample_rate) {
+    sample_rate_ = sample_rate;
+    TOP_INFO("gossip trace sample rate(%u)", sample_rate);
+}
+
+GossipTraceRing* GossipTrace::GetThreadRing() {
+    // held by rings_ too, the events stay readable after the thread exits
+    static thread_local std::shared_ptr<GossipTraceRing> thread_ring;
+    if (!thread_ring) {
+        thread_ring = std::make_shared<GossipTraceRing>();
+        std::unique_lock<std::mutex> lock(mutex_);
+        rings_.push_back(thread_ring);
+    }
+    return thread_ring.get();
+}
+
+void GossipTrace::Record(const GossipTraceEvent& event) {
+    auto ring = GetThreadRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= GossipTraceRing::kCapacity) {
+        ++ring->dropped;
+        return;
+    }
+    ring->events[head % GossipTraceRing::kCapacity] = event;
+    ring->head.store(head + 1, std::memory_order_release);
+    ++record_count_;
+}
+
+void GossipTrace::CollectLocked() {
+    for (auto iter = rings_.begin(); iter != rings_.end();) {
+        auto& ring = *iter;
+        // only rings_ holds the ring of an exited thread, checked before
+        // reading so its last events are not lost
+        bool retired = (ring.use_count() == 1);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            history_.push_back(ring->events[tail % GossipTraceRing::kCapacity]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        if (retired) {
+            drop_count_ += ring->dropped;
+            iter = rings_.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    while (history_.size() > kMaxTraceHistory) {
+        history_.pop_front();
+        ++drop_count_;
+    }
+}
+
+void GossipTrace::Query(uint32_t msg_hash, std::vector<GossipTraceEvent>& events) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    CollectLocked();
+    for (auto iter = history_.begin(); iter != history_.end(); ++iter) {
+        if (iter->msg_hash == msg_hash) {
+            events.push_back(*iter);
+        }
+    }
+}
+
+void GossipTrace::Drain(std::vector<GossipTraceEvent>& events) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    CollectLocked();
+    events.insert(events.end(), history_.begin(), history_.end());
+    history_.clear();
+}
+
+bool GossipTrace::DrainToFile(const std::string& path) {
+    std::vector<GossipTraceEvent> events;
+    Drain(events);
+    FILE* file = fopen(path.c_str(), "a");
+    if (file == nullptr) {
+        TOP_ERROR("gossip trace open %s failed", path.c_str());
+        return false;
+    }
+    // recv_us msg_hash hop_num gossip_type outcome filtered fanout send_us
+    for (auto iter = events.begin(); iter != events.end(); ++iter) {
+        fprintf(file, "%llu %u %u %u %u %u %u %u\n",
+                (unsigned long long)iter->recv_us,
+                iter->msg_hash,
+                iter->hop_num,
+                iter->gossip_type,
+                iter->outcome,
+                iter->filtered,
+                iter->fanout,
+                iter->send_us);
+    }
+    fclose(file);
+    return true;
+}
+
+void GossipTrace::GetStat(uint64_t& record_count, uint64_t& drop_count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    record_count = record_count_;
+    drop_count = drop_count_;
+    for (auto iter = rings_.begin(); iter != rings_.end(); ++iter) {
+        drop_count += (*iter)->dropped;
+    }
+}
+
+GossipTraceScope::GossipTraceScope(const transport::protobuf::RoutingMessage& message)
+        : sampled_(GossipTrace::Instance()->Sampled(message.gossip().msg_hash())),
+          message_type_(message.type()) {
+    // outcome, fanout and type feed GossipMetrics, the rest only sampled events
+    event_.fanout = 0;
+    event_.gossip_type = message.gossip().gossip_type();
+    event_.outcome = kGossipTraceDropped;
+    if (!sampled_) {
+        return;
+    }
+    event_.recv_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    event_.msg_hash = message.gossip().msg_hash();
+    event_.send_us = 0;
+    event_.hop_num = std::min<uint32_t>(message.hop_num(), std::numeric_limits<uint16_t>::max());
+    event_.filtered = 0;
+}
+
+GossipTraceScope::~GossipTraceScope() {
+    GossipMetrics::Instance()->AddOutcome(
+            event_.gossip_type, message_type_, event_.outcome, event_.fanout);
+    if (sampled_) {
+        GossipTrace::Instance()->Record(event_);
+    }
+}
+
+void GossipTraceScope::StopSend(uint32_t fanout) {
+    event_.fanout = std::min<uint32_t>(event_.fanout + fanout, std::numeric_limits<uint16_t>::max());
+    event_.outcome = event_.fanout > 0 ? kGossipTraceForwarded : kGossipTraceNoNeighbor;
+    if (!sampled_) {
+        return;
+    }
+    event_.send_us += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - send_start_).count();
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -4,18 +4,81 @@
 
 #include "xgossip/include/header_block_data.h"
 
+#include "xbase/xhash.h"
 #include "xdata/xdataobject.h"
 
 namespace top {
 
 namespace gossip {
 
+// no longer than the ledger keeps entries set with the expire flag
+static const uint32_t kIndexEntryPeriod = 60 * 1000;  // 60s
+// expired entries of a shard are swept every this many adds
+static const uint32_t kIndexSweepAddCount = 1024u;
+
 HeaderBlockData::HeaderBlockData(std::shared_ptr<top::ledger::xledger_face_t> ledger_face)
         : ledger_face_(ledger_face) {}
 
+HeaderBlockData::HeaderBlockData(std::shared_ptr<BlockLogStore> block_store)
+        : block_store_(block_store) {}
+
 HeaderBlockData::~HeaderBlockData() {}
 
+HeaderBlockData::IndexShard& HeaderBlockData::GetIndexShard(uint64_t fingerprint) {
+    return index_shards_[fingerprint % kIndexShardCount];
+}
+
+void HeaderBlockData::IndexAdd(uint64_t fingerprint) {
+    auto tp_now = std::chrono::steady_clock::now();
+    auto& shard = GetIndexShard(fingerprint);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    shard.index_map[fingerprint] = tp_now + std::chrono::milliseconds(kIndexEntryPeriod);
+    if (++shard.add_count < kIndexSweepAddCount) {
+        return;
+    }
+    shard.add_count = 0;
+    for (auto iter = shard.index_map.begin(); iter != shard.index_map.end();) {
+        if (iter->second <= tp_now) {
+            iter = shard.index_map.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool HeaderBlockData::IndexHas(uint64_t fingerprint) {
+    std::chrono::steady_clock::time_point expire_time;
+    return IndexHas(fingerprint, expire_time);
+}
+
+bool HeaderBlockData::IndexHas(
+        uint64_t fingerprint,
+        std::chrono::steady_clock::time_point& expire_time) {
+    auto& shard = GetIndexShard(fingerprint);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto iter = shard.index_map.find(fingerprint);
+    if (iter == shard.index_map.end()) {
+        return false;
+    }
+    if (iter->second <= std::chrono::steady_clock::now()) {
+        shard.index_map.erase(iter);
+        return false;
+    }
+    expire_time = iter->second;
+    return true;
+}
+
+void HeaderBlockData::IndexRemove(uint64_t fingerprint) {
+    auto& shard = GetIndexShard(fingerprint);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    shard.index_map.erase(fingerprint);
+}
+
 void HeaderBlockData::AddData(const std::string& header_hash, const std::string& block) {
+    if (block_store_) {
+        block_store_->Put(header_hash, block);
+        return;
+    }
     assert(ledger_face_);
     xdataobject_string_ptr_t str_obj = make_object_ptr<xdataobject_string_t>();
     str_obj->set(block);
@@ -25,31 +88,96 @@ void HeaderBlockData::AddData(const std::string& header_hash, const std::string&
             0,
             0,
             top::ledger::enum_xledger_set_obj_expire_flag);
+    IndexAdd(base::xhash64_t::digest(header_hash));
 }
 
 void HeaderBlockData::GetData(const std::string& header_hash, std::string& block) {
-    assert(ledger_face_);
-    xdataobject_string_ptr_t str_obj = ledger_face_->get(header_hash);
-    if (str_obj == nullptr) {
-        return;
+    GetDataIfPresent(header_hash, block);
+}
+
+bool HeaderBlockData::GetDataIfPresent(const std::string& header_hash, std::string& block) {
+    if (block_store_) {
+        BlockLogView view;
+        if (!block_store_->Get(header_hash, view)) {
+            return false;
+        }
+        block.assign(view.data, view.size);
+        return true;
     }
-    block = str_obj->get();
+    std::chrono::steady_clock::time_point expire_time;
+    return GetLedgerData(header_hash, block, expire_time);
 }
 
-bool HeaderBlockData::HasData(const std::string& header_hash) {
+bool HeaderBlockData::GetViewIfPresent(const std::string& header_hash, BlockLogView& view) {
+    if (block_store_) {
+        return block_store_->Get(header_hash, view);
+    }
+    auto buffer = std::make_shared<std::string>();
+    if (!GetLedgerData(header_hash, *buffer, view.expire_time)) {
+        return false;
+    }
+    view.buffer = buffer;
+    view.data = buffer->data();
+    view.size = buffer->size();
+    return true;
+}
+
+bool HeaderBlockData::GetLedgerData(
+        const std::string& header_hash,
+        std::string& block,
+        std::chrono::steady_clock::time_point& expire_time) {
     assert(ledger_face_);
+    uint64_t fingerprint = base::xhash64_t::digest(header_hash);
+    if (!IndexHas(fingerprint, expire_time)) {
+        return false;
+    }
+
     xdataobject_string_ptr_t str_obj = ledger_face_->get(header_hash);
     if (str_obj == nullptr) {
+        // the ledger expired it first
+        IndexRemove(fingerprint);
         return false;
     }
+    block = str_obj->get();
     return true;
 }
 
+bool HeaderBlockData::HasData(const std::string& header_hash) {
+    if (block_store_) {
+        return block_store_->Has(header_hash);
+    }
+    return IndexHas(base::xhash64_t::digest(header_hash));
+}
+
 void HeaderBlockData::RemoveData(const std::string& header_hash) {
+    if (block_store_) {
+        block_store_->Remove(header_hash);
+        return;
+    }
     assert(ledger_face_);
+    IndexRemove(base::xhash64_t::digest(header_hash));
     ledger_face_->remove(header_hash);
 }
 
+void HeaderBlockData::DropExpired() {
+    if (block_store_) {
+        block_store_->DropExpired();
+        return;
+    }
+    auto tp_now = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kIndexShardCount; ++i) {
+        auto& shard = index_shards_[i];
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        for (auto iter = shard.index_map.begin(); iter != shard.index_map.end();) {
+            if (iter->second <= tp_now) {
+                iter = shard.index_map.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
+
 }  // namespace gossip
 
 }  // namespace top
@@ -92,7 +92,7 @@ bool MessageWithBloomfilter::StopGossip(const uint32_t& gossip_key, uint32_t sto
     if (stop_times <= 0) {
         stop_times = kGossipSendoutMaxTimes;
     }
-    std::unique_lock<std::mutex> lock(messsage_bloomfilter_map_mutex_);
+    std::unique_lock<LockWaitMutex> lock(messsage_bloomfilter_map_mutex_);
     auto iter = messsage_bloomfilter_map_.find(gossip_key);
     if (iter != messsage_bloomfilter_map_.end()) {
         TOP_DEBUG("msg.hash:%d stop_times:%d", gossip_key, iter->second);
@@ -0,0 +1,161 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/neighbor_liveness.h"
+
+#include <math.h>
+
+#include <functional>
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+static const double kSendFailedScore = 1.0;
+static const double kAckTimeoutScore = 1.0;
+static const double kSuspectScore = 1.5;  // two failures within about a half-life
+static const double kLivenessHalfLife = 30.0;  // seconds
+
+NeighborLiveness* NeighborLiveness::Instance() {
+    static NeighborLiveness ins;
+    return &ins;
+}
+
+uint64_t NeighborLiveness::GetKey(const std::string& ip, uint16_t port) {
+    return (static_cast<uint64_t>(std::hash<std::string>()(ip)) << 16) ^ port;
+}
+
+void NeighborLiveness::UpdateItem(
+        LivenessItem& item,
+        std::chrono::steady_clock::time_point tp_now) {
+    double elapsed = std::chrono::duration<double>(tp_now - item.update_time).count();
+    if (elapsed > 0) {
+        item.score *= pow(0.5, elapsed / kLivenessHalfLife);
+        item.update_time = tp_now;
+    }
+    bool suspect = item.score >= kSuspectScore;
+    if (suspect != item.suspect) {
+        item.suspect = suspect;
+        if (suspect) {
+            ++suspect_count_;
+        } else {
+            --suspect_count_;
+        }
+    }
+    if (!suspect) {
+        return;
+    }
+    // when the score decays below kSuspectScore with no new failure
+    auto clear_time = item.update_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(kLivenessHalfLife * log2(item.score / kSuspectScore)));
+    int64_t clear_ticks = clear_time.time_since_epoch().count();
+    if (clear_ticks > suspect_until_) {
+        suspect_until_ = clear_ticks;
+    }
+}
+
+bool NeighborLiveness::HasSuspect(std::chrono::steady_clock::time_point tp_now) {
+    if (suspect_count_ == 0) {
+        return false;
+    }
+    if (tp_now.time_since_epoch().count() < suspect_until_) {
+        return true;
+    }
+    return UpdateSuspects(tp_now);
+}
+
+bool NeighborLiveness::UpdateSuspects(std::chrono::steady_clock::time_point tp_now) {
+    // every suspect may have decayed without being looked up again
+    std::unique_lock<std::mutex> lock(liveness_map_mutex_);
+    suspect_until_ = 0;
+    for (auto iter = liveness_map_.begin(); iter != liveness_map_.end(); ++iter) {
+        if (iter->second.suspect) {
+            UpdateItem(iter->second, tp_now);
+        }
+    }
+    return suspect_count_ > 0;
+}
+
+void NeighborLiveness::MakeRoomLocked(std::chrono::steady_clock::time_point tp_now) {
+    // keep the suspects, the others only hold failures on their way out
+    for (auto iter = liveness_map_.begin(); iter != liveness_map_.end();) {
+        UpdateItem(iter->second, tp_now);
+        if (!iter->second.suspect) {
+            iter = liveness_map_.erase(iter);
+            continue;
+        }
+        ++iter;
+    }
+    if (liveness_map_.size() >= kMaxLivenessMapSize) {
+        liveness_map_.clear();
+        suspect_count_ = 0;
+        suspect_until_ = 0;
+    }
+}
+
+void NeighborLiveness::AddScore(
+        const std::string& ip,
+        uint16_t port,
+        double score,
+        std::chrono::steady_clock::time_point tp_now) {
+    std::unique_lock<std::mutex> lock(liveness_map_mutex_);
+    auto iter = liveness_map_.find(GetKey(ip, port));
+    if (iter == liveness_map_.end()) {
+        if (liveness_map_.size() >= kMaxLivenessMapSize) {
+            MakeRoomLocked(tp_now);
+        }
+        iter = liveness_map_.insert(std::make_pair(
+                GetKey(ip, port),
+                LivenessItem{ 0.0, false, tp_now })).first;
+        liveness_size_ = liveness_map_.size();
+    }
+    bool suspect = iter->second.suspect;
+    UpdateItem(iter->second, tp_now);
+    iter->second.score += score;
+    UpdateItem(iter->second, tp_now);
+    if (!suspect && iter->second.suspect) {
+        TOP_INFO("neighbor(%s:%u) suspect, score:%f", ip.c_str(), port, iter->second.score);
+    }
+}
+
+void NeighborLiveness::OnSendFailed(const std::string& ip, uint16_t port) {
+    AddScore(ip, port, kSendFailedScore, std::chrono::steady_clock::now());
+}
+
+void NeighborLiveness::OnAckTimeout(const std::string& ip, uint16_t port) {
+    AddScore(ip, port, kAckTimeoutScore, std::chrono::steady_clock::now());
+}
+
+void NeighborLiveness::OnAck(const std::string& ip, uint16_t port) {
+    if (liveness_size_ == 0) {
+        return;
+    }
+    // alive, forget earlier failures, suspect or not
+    std::unique_lock<std::mutex> lock(liveness_map_mutex_);
+    auto iter = liveness_map_.find(GetKey(ip, port));
+    if (iter == liveness_map_.end()) {
+        return;
+    }
+    if (iter->second.suspect) {
+        --suspect_count_;
+    }
+    liveness_map_.erase(iter);
+    liveness_size_ = liveness_map_.size();
+}
+
+bool NeighborLiveness::IsSuspect(const std::string& ip, uint16_t port) {
+    std::unique_lock<std::mutex> lock(liveness_map_mutex_);
+    auto iter = liveness_map_.find(GetKey(ip, port));
+    if (iter == liveness_map_.end()) {
+        return false;
+    }
+    UpdateItem(iter->second, std::chrono::steady_clock::now());
+    return iter->second.suspect;
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/node_capacity.h"
+
+#include "xpbase/base/top_log.h"
+
+namespace top {
+
+namespace gossip {
+
+NodeCapacityManager* NodeCapacityManager::Instance() {
+    static NodeCapacityManager ins;
+    return &ins;
+}
+
+void NodeCapacityManager::SetLocalCapacity(uint32_t capacity_class) {
+    if (local_capacity_.exchange(capacity_class) != capacity_class) {
+        ++version_;
+    }
+}
+
+uint32_t NodeCapacityManager::LocalCapacity() const {
+    return local_capacity_;
+}
+
+void NodeCapacityManager::SetNodeCapacity(uint64_t hash64, uint32_t capacity_class) {
+    if (capacity_class > kUploadCapacityHigh) {
+        TOP_WARN("invalid capacity class(%d) of node(%llu)",
+                capacity_class, (unsigned long long)hash64);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(capacity_map_mutex_);
+    auto iter = capacity_map_.find(hash64);
+    if (iter != capacity_map_.end() && iter->second == capacity_class) {
+        return;
+    }
+    capacity_map_[hash64] = capacity_class;
+    ++version_;
+}
+
+void NodeCapacityManager::RemoveNode(uint64_t hash64) {
+    std::unique_lock<std::mutex> lock(capacity_map_mutex_);
+    if (capacity_map_.erase(hash64) > 0) {
+        ++version_;
+    }
+}
+
+uint32_t NodeCapacityManager::GetNodeCapacity(uint64_t hash64) {
+    std::unique_lock<std::mutex> lock(capacity_map_mutex_);
+    return GetCapacityWithLock(hash64);
+}
+
+void NodeCapacityManager::GetNodesCapacity(
+        const std::vector<uint64_t>& hash64_vec,
+        std::vector<uint32_t>& capacity_vec) {
+    capacity_vec.resize(hash64_vec.size());
+    std::unique_lock<std::mutex> lock(capacity_map_mutex_);
+    for (uint32_t i = 0; i < hash64_vec.size(); ++i) {
+        capacity_vec[i] = GetCapacityWithLock(hash64_vec[i]);
+    }
+}
+
+uint32_t NodeCapacityManager::GetCapacityWithLock(uint64_t hash64) {
+    auto iter = capacity_map_.find(hash64);
+    if (iter == capacity_map_.end()) {
+        return CapacityTreeClass(kUploadCapacityUnknown);
+    }
+    return CapacityTreeClass(iter->second);
+}
+
+}  // namespace gossip
+
+}  // namespace top
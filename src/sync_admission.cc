@@ -0,0 +1,149 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/sync_admission.h"
+
+#include <algorithm>
+
+namespace top {
+
+namespace gossip {
+
+static const uint32_t kMaxRequesterBucketCount = 4096u;  // idle buckets are dropped past it
+static const uint32_t kMaxHolderHeaderCount = 4096u;
+static const uint32_t kMaxHolderCount = 8u;  // per header
+
+SyncAdmission::SyncAdmission(
+        uint64_t global_rate,
+        uint64_t global_burst,
+        uint64_t requester_rate,
+        uint64_t requester_burst)
+        : global_rate_(global_rate),
+          global_burst_(global_burst),
+          requester_rate_(requester_rate),
+          requester_burst_(requester_burst) {
+    global_bucket_.tokens = static_cast<double>(global_burst_);
+    global_bucket_.last_time = std::chrono::steady_clock::now();
+}
+
+SyncAdmission::~SyncAdmission() {}
+
+void SyncAdmission::Refill(
+        SyncTokenBucket& bucket,
+        uint64_t rate,
+        uint64_t burst,
+        std::chrono::steady_clock::time_point tp_now) {
+    if (tp_now <= bucket.last_time) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(tp_now - bucket.last_time).count();
+    bucket.tokens = std::min<double>(burst, bucket.tokens + seconds * rate);
+    bucket.last_time = tp_now;
+}
+
+SyncTokenBucket& SyncAdmission::GetRequesterBucket(
+        const std::string& ip,
+        uint16_t port,
+        std::chrono::steady_clock::time_point tp_now) {
+    std::string requester = ip + ":" + std::to_string(port);
+    auto iter = requester_buckets_.find(requester);
+    if (iter != requester_buckets_.end()) {
+        Refill(iter->second, requester_rate_, requester_burst_, tp_now);
+        return iter->second;
+    }
+
+    // a full bucket is the same as no bucket, drop those
+    if (requester_buckets_.size() >= kMaxRequesterBucketCount) {
+        for (auto bucket_iter = requester_buckets_.begin(); bucket_iter != requester_buckets_.end();) {
+            Refill(bucket_iter->second, requester_rate_, requester_burst_, tp_now);
+            if (bucket_iter->second.tokens >= requester_burst_) {
+                bucket_iter = requester_buckets_.erase(bucket_iter);
+            } else {
+                ++bucket_iter;
+            }
+        }
+    }
+    auto& bucket = requester_buckets_[requester];
+    bucket.tokens = static_cast<double>(requester_burst_);
+    bucket.last_time = tp_now;
+    return bucket;
+}
+
+bool SyncAdmission::Admit(const std::string& ip, uint16_t port, uint64_t bytes) {
+    auto tp_now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    Refill(global_bucket_, global_rate_, global_burst_, tp_now);
+    auto& bucket = GetRequesterBucket(ip, port, tp_now);
+    if (global_bucket_.tokens < bytes || bucket.tokens < bytes) {
+        ++refuse_count_;
+        return false;
+    }
+    global_bucket_.tokens -= bytes;
+    bucket.tokens -= bytes;
+    ++admit_count_;
+    return true;
+}
+
+bool SyncAdmission::HasBudget(const std::string& ip, uint16_t port) {
+    auto tp_now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    Refill(global_bucket_, global_rate_, global_burst_, tp_now);
+    auto& bucket = GetRequesterBucket(ip, port, tp_now);
+    return global_bucket_.tokens >= 1.0 && bucket.tokens >= 1.0;
+}
+
+void SyncAdmission::AddHolder(const std::string& header_hash, const SyncHolder& holder) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ret = holder_map_.insert(std::make_pair(header_hash, std::vector<SyncHolder>()));
+    if (ret.second) {
+        holder_order_.push_back(header_hash);
+        if (holder_order_.size() > kMaxHolderHeaderCount) {
+            holder_map_.erase(holder_order_.front());
+            holder_order_.pop_front();
+        }
+    }
+
+    auto& holders = ret.first->second;
+    for (auto iter = holders.begin(); iter != holders.end(); ++iter) {
+        if (iter->ip == holder.ip && iter->port == holder.port) {
+            holders.erase(iter);
+            break;
+        }
+    }
+    if (holders.size() >= kMaxHolderCount) {
+        holders.erase(holders.begin());
+    }
+    holders.push_back(holder);
+}
+
+void SyncAdmission::GetHolders(
+        const std::string& header_hash,
+        const std::string& ip,
+        uint16_t port,
+        uint32_t max_count,
+        std::vector<SyncHolder>& holders) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = holder_map_.find(header_hash);
+    if (iter == holder_map_.end()) {
+        return;
+    }
+    for (auto holder_iter = iter->second.rbegin();
+            holder_iter != iter->second.rend() && holders.size() < max_count; ++holder_iter) {
+        if (holder_iter->ip == ip && holder_iter->port == port) {
+            continue;
+        }
+        holders.push_back(*holder_iter);
+    }
+}
+
+void SyncAdmission::GetStat(uint64_t& admit_count, uint64_t& refuse_count, uint32_t& requester_count) {
+    admit_count = admit_count_;
+    refuse_count = refuse_count_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    requester_count = requester_buckets_.size();
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,240 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/sync_message_codec.h"
+
+namespace top {
+
+namespace gossip {
+
+static const char kSyncEnvelopeMagic[] = { '\0', 'S', 'Y' };
+
+// little endian fixed width integers inside entries
+template <typename T>
+static void PutUint(T value, std::string& data) {
+    for (uint32_t i = 0; i < sizeof(T); ++i) {
+        data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+template <typename T>
+static T GetUint(const std::string& data, uint32_t pos) {
+    T value = 0;
+    for (uint32_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+    }
+    return value;
+}
+
+SyncEnvelopeKind GetSyncEnvelopeKind(const std::string& data) {
+    if (data.size() < kSyncEnvelopeHeadSize ||
+            data.compare(0, sizeof(kSyncEnvelopeMagic), kSyncEnvelopeMagic, sizeof(kSyncEnvelopeMagic)) != 0) {
+        return kSyncEnvelopeInvalid;
+    }
+
+    switch (data[sizeof(kSyncEnvelopeMagic)]) {
+    case kSyncEnvelopeBatch:
+        return kSyncEnvelopeBatch;
+    case kSyncEnvelopeManifest:
+        return kSyncEnvelopeManifest;
+    case kSyncEnvelopeChunkRequest:
+        return kSyncEnvelopeChunkRequest;
+    case kSyncEnvelopeChunk:
+        return kSyncEnvelopeChunk;
+    case kSyncEnvelopeBusy:
+        return kSyncEnvelopeBusy;
+    default:
+        return kSyncEnvelopeInvalid;
+    }
+}
+
+void EncodeSyncEnvelope(
+        SyncEnvelopeKind kind,
+        const std::vector<std::string>& entries,
+        std::string& data) {
+    uint32_t size = kSyncEnvelopeHeadSize;
+    for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+        size += kSyncEnvelopeEntryHeadSize + iter->size();
+    }
+    data.clear();
+    data.reserve(size);
+    data.append(kSyncEnvelopeMagic, sizeof(kSyncEnvelopeMagic));
+    data.push_back(static_cast<char>(kind));
+    for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+        PutUint<uint32_t>(iter->size(), data);
+        data.append(*iter);
+    }
+}
+
+bool DecodeSyncEnvelope(
+        const std::string& data,
+        SyncEnvelopeKind kind,
+        std::vector<std::string>& entries) {
+    if (GetSyncEnvelopeKind(data) != kind) {
+        return false;
+    }
+
+    uint32_t pos = kSyncEnvelopeHeadSize;
+    while (pos < data.size()) {
+        if (data.size() - pos < kSyncEnvelopeEntryHeadSize) {
+            return false;
+        }
+        uint32_t len = GetUint<uint32_t>(data, pos);
+        pos += kSyncEnvelopeEntryHeadSize;
+        if (data.size() - pos < len) {
+            return false;
+        }
+        entries.push_back(data.substr(pos, len));
+        pos += len;
+    }
+    return true;
+}
+
+void EncodeSyncManifest(const SyncChunkManifest& manifest, std::string& data) {
+    std::vector<std::string> entries(3);
+    entries[0] = manifest.header_hash;
+    PutUint<uint32_t>(manifest.total_size, entries[1]);
+    PutUint<uint32_t>(manifest.chunk_size, entries[1]);
+    entries[2].reserve(manifest.chunk_hashes.size() * sizeof(uint64_t));
+    for (auto iter = manifest.chunk_hashes.begin(); iter != manifest.chunk_hashes.end(); ++iter) {
+        PutUint<uint64_t>(*iter, entries[2]);
+    }
+    EncodeSyncEnvelope(kSyncEnvelopeManifest, entries, data);
+}
+
+bool DecodeSyncManifest(const std::string& data, SyncChunkManifest& manifest) {
+    std::vector<std::string> entries;
+    if (!DecodeSyncEnvelope(data, kSyncEnvelopeManifest, entries) ||
+            entries.size() != 3 ||
+            entries[1].size() != 2 * sizeof(uint32_t) ||
+            entries[2].size() % sizeof(uint64_t) != 0) {
+        return false;
+    }
+    manifest.header_hash = entries[0];
+    manifest.total_size = GetUint<uint32_t>(entries[1], 0);
+    manifest.chunk_size = GetUint<uint32_t>(entries[1], sizeof(uint32_t));
+    manifest.chunk_hashes.clear();
+    for (uint32_t pos = 0; pos < entries[2].size(); pos += sizeof(uint64_t)) {
+        manifest.chunk_hashes.push_back(GetUint<uint64_t>(entries[2], pos));
+    }
+    return true;
+}
+
+void EncodeSyncChunkRequest(const SyncChunkRequest& request, std::string& data) {
+    std::vector<std::string> entries(2);
+    entries[0] = request.header_hash;
+    for (auto iter = request.chunk_indexes.begin(); iter != request.chunk_indexes.end(); ++iter) {
+        PutUint<uint32_t>(*iter, entries[1]);
+    }
+    EncodeSyncEnvelope(kSyncEnvelopeChunkRequest, entries, data);
+}
+
+bool DecodeSyncChunkRequest(const std::string& data, SyncChunkRequest& request) {
+    std::vector<std::string> entries;
+    if (!DecodeSyncEnvelope(data, kSyncEnvelopeChunkRequest, entries) ||
+            entries.size() != 2 ||
+            entries[1].size() % sizeof(uint32_t) != 0) {
+        return false;
+    }
+    request.header_hash = entries[0];
+    request.chunk_indexes.clear();
+    for (uint32_t pos = 0; pos < entries[1].size(); pos += sizeof(uint32_t)) {
+        request.chunk_indexes.push_back(GetUint<uint32_t>(entries[1], pos));
+    }
+    return true;
+}
+
+void EncodeSyncChunk(const SyncChunk& chunk, std::string& data) {
+    EncodeSyncChunk(chunk.header_hash, chunk.chunk_index, chunk.data.data(), chunk.data.size(), data);
+}
+
+void EncodeSyncChunk(
+        const std::string& header_hash,
+        uint32_t chunk_index,
+        const char* chunk_data,
+        uint32_t chunk_size,
+        std::string& data) {
+    data.clear();
+    data.reserve(
+            kSyncEnvelopeHeadSize +
+            3 * kSyncEnvelopeEntryHeadSize +
+            header_hash.size() +
+            sizeof(uint32_t) +
+            chunk_size);
+    data.append(kSyncEnvelopeMagic, sizeof(kSyncEnvelopeMagic));
+    data.push_back(static_cast<char>(kSyncEnvelopeChunk));
+    PutUint<uint32_t>(header_hash.size(), data);
+    data.append(header_hash);
+    PutUint<uint32_t>(sizeof(uint32_t), data);
+    PutUint<uint32_t>(chunk_index, data);
+    PutUint<uint32_t>(chunk_size, data);
+    data.append(chunk_data, chunk_size);
+}
+
+bool DecodeSyncChunk(const std::string& data, SyncChunk& chunk) {
+    std::vector<std::string> entries;
+    if (!DecodeSyncEnvelope(data, kSyncEnvelopeChunk, entries) ||
+            entries.size() != 3 ||
+            entries[1].size() != sizeof(uint32_t)) {
+        return false;
+    }
+    chunk.header_hash = entries[0];
+    chunk.chunk_index = GetUint<uint32_t>(entries[1], 0);
+    chunk.data.swap(entries[2]);
+    return true;
+}
+
+// every redirect is a header hash entry and a holder count entry, followed
+// by ip, port and node id entries of each holder
+void EncodeSyncBusy(const std::vector<SyncRedirect>& redirects, std::string& data) {
+    std::vector<std::string> entries;
+    for (auto iter = redirects.begin(); iter != redirects.end(); ++iter) {
+        entries.push_back(iter->header_hash);
+        entries.push_back(std::string());
+        PutUint<uint32_t>(iter->holders.size(), entries.back());
+        for (auto holder_iter = iter->holders.begin(); holder_iter != iter->holders.end(); ++holder_iter) {
+            entries.push_back(holder_iter->ip);
+            entries.push_back(std::string());
+            PutUint<uint16_t>(holder_iter->port, entries.back());
+            entries.push_back(holder_iter->node_id);
+        }
+    }
+    EncodeSyncEnvelope(kSyncEnvelopeBusy, entries, data);
+}
+
+bool DecodeSyncBusy(const std::string& data, std::vector<SyncRedirect>& redirects) {
+    std::vector<std::string> entries;
+    if (!DecodeSyncEnvelope(data, kSyncEnvelopeBusy, entries)) {
+        return false;
+    }
+    redirects.clear();
+    uint32_t pos = 0;
+    while (pos < entries.size()) {
+        if (entries.size() - pos < 2 || entries[pos + 1].size() != sizeof(uint32_t)) {
+            return false;
+        }
+        SyncRedirect redirect;
+        redirect.header_hash = entries[pos];
+        uint32_t holder_count = GetUint<uint32_t>(entries[pos + 1], 0);
+        pos += 2;
+        if ((entries.size() - pos) / 3 < holder_count) {
+            return false;
+        }
+        for (uint32_t i = 0; i < holder_count; ++i, pos += 3) {
+            if (entries[pos + 1].size() != sizeof(uint16_t)) {
+                return false;
+            }
+            redirect.holders.push_back(SyncHolder{
+                    entries[pos],
+                    GetUint<uint16_t>(entries[pos + 1], 0),
+                    entries[pos + 2] });
+        }
+        redirects.push_back(redirect);
+    }
+    return true;
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/include/sync_response_cache.h"
+
+namespace top {
+
+namespace gossip {
+
+SyncResponseCache::SyncResponseCache(uint64_t max_bytes) : max_bytes_(max_bytes) {}
+
+SyncResponseCache::~SyncResponseCache() {}
+
+uint64_t SyncResponseCache::EntryBytes(const SyncResponseEntryPtr& entry) {
+    return entry->payload.size() + entry->block.size;
+}
+
+SyncResponseEntryPtr SyncResponseCache::Get(const std::string& header_hash) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = lru_map_.find(header_hash);
+    if (iter == lru_map_.end()) {
+        ++miss_count_;
+        return nullptr;
+    }
+    if (iter->second->second->expire_time <= std::chrono::steady_clock::now()) {
+        EraseLocked(iter);
+        ++miss_count_;
+        return nullptr;
+    }
+    ++hit_count_;
+    lru_list_.splice(lru_list_.begin(), lru_list_, iter->second);
+    return iter->second->second;
+}
+
+void SyncResponseCache::Put(const std::string& header_hash, SyncResponseEntryPtr entry) {
+    uint64_t entry_bytes = EntryBytes(entry);
+    if (entry_bytes > max_bytes_) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = lru_map_.find(header_hash);
+    if (iter != lru_map_.end()) {
+        EraseLocked(iter);
+    }
+
+    while (!lru_list_.empty() && bytes_ + entry_bytes > max_bytes_) {
+        bytes_ -= EntryBytes(lru_list_.back().second);
+        lru_map_.erase(lru_list_.back().first);
+        lru_list_.pop_back();
+    }
+    lru_list_.push_front(LruItem(header_hash, entry));
+    lru_map_[header_hash] = lru_list_.begin();
+    bytes_ += entry_bytes;
+}
+
+void SyncResponseCache::Remove(const std::string& header_hash) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = lru_map_.find(header_hash);
+    if (iter == lru_map_.end()) {
+        return;
+    }
+    EraseLocked(iter);
+}
+
+void SyncResponseCache::DropExpired(std::chrono::steady_clock::time_point tp_now) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto iter = lru_list_.begin(); iter != lru_list_.end();) {
+        if (iter->second->expire_time > tp_now) {
+            ++iter;
+            continue;
+        }
+        bytes_ -= EntryBytes(iter->second);
+        lru_map_.erase(iter->first);
+        iter = lru_list_.erase(iter);
+    }
+}
+
+void SyncResponseCache::EraseLocked(
+        std::unordered_map<std::string, std::list<LruItem>::iterator>::iterator iter) {
+    bytes_ -= EntryBytes(iter->second->second);
+    lru_list_.erase(iter->second);
+    lru_map_.erase(iter);
+}
+
+void SyncResponseCache::GetStat(uint64_t& hit_count, uint64_t& miss_count, uint64_t& bytes) {
+    hit_count = hit_count_;
+    miss_count = miss_count_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    bytes = bytes_;
+}
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "xgossip/include/async_header_block_data.h"
+#include "xgossip/include/block_log_store.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static std::shared_ptr<HeaderBlockData> NewHeaderBlockData() {
+    auto block_store = std::make_shared<BlockLogStore>("", 64 * 1024, 60 * 1000);
+    return std::make_shared<HeaderBlockData>(block_store);
+}
+
+TEST(TestAsyncHeaderBlockData, AddThenGet) {
+    AsyncHeaderBlockData async_data(NewHeaderBlockData(), 2, 16, 16);
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool added = false;
+    async_data.AsyncAddData("hash", "block", [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        added = true;
+        cond.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cond.wait_for(lock, std::chrono::seconds(5), [&]() { return added; }));
+    }
+
+    bool done = false;
+    bool found = false;
+    std::string block;
+    ASSERT_TRUE(async_data.AsyncGetData("hash", [&](bool get_found, const std::string& get_block) {
+        std::unique_lock<std::mutex> lock(mutex);
+        found = get_found;
+        block = get_block;
+        done = true;
+        cond.notify_one();
+    }));
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cond.wait_for(lock, std::chrono::seconds(5), [&]() { return done; }));
+    ASSERT_TRUE(found);
+    ASSERT_EQ(block, "block");
+}
+
+// sets release when the scope is left, before the workers are joined, so a
+// failed assertion does not leave a parked worker hanging the join
+class ReleaseGuard {
+public:
+    explicit ReleaseGuard(std::atomic<bool>& release) : release_(release) {}
+    ~ReleaseGuard() { release_ = true; }
+
+private:
+    std::atomic<bool>& release_;
+};
+
+static void WaitRelease(std::atomic<bool>& release) {
+    while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(TestAsyncHeaderBlockData, ReadsShedApartFromWrites) {
+    auto header_block_data = NewHeaderBlockData();
+    std::atomic<bool> release{ false };
+    AsyncHeaderBlockData async_data(header_block_data, 1, 4, 4);
+    ReleaseGuard guard(release);
+    // park the only reader so reads pile up
+    ASSERT_TRUE(async_data.Post([&]() { WaitRelease(release); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < 10; ++i) {
+        if (async_data.Post([]() {})) {
+            ++accepted;
+        }
+    }
+    ASSERT_EQ(accepted, 4u);
+    ASSERT_EQ(async_data.shed_count(), 6u);
+    ASSERT_EQ(async_data.read_backlog(), 4u);
+
+    // the writer does not wait behind the reads
+    std::atomic<bool> added{ false };
+    ASSERT_TRUE(async_data.AsyncAddData("hash", "block", [&]() { added = true; }));
+    for (uint32_t i = 0; i < 5000 && !added; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(added);
+    ASSERT_TRUE(header_block_data->HasData("hash"));
+}
+
+TEST(TestAsyncHeaderBlockData, WritesBounded) {
+    auto header_block_data = NewHeaderBlockData();
+    std::atomic<bool> release{ false };
+    {
+        AsyncHeaderBlockData async_data(header_block_data, 1, 4, 4);
+        ReleaseGuard guard(release);
+        // park the writer so writes pile up
+        ASSERT_TRUE(async_data.AsyncAddData("parked", "block", [&]() { WaitRelease(release); }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint32_t accepted = 0;
+        for (uint32_t i = 0; i < 10; ++i) {
+            if (async_data.AsyncAddData(std::to_string(i), "block", nullptr)) {
+                ++accepted;
+            }
+        }
+        ASSERT_EQ(accepted, 4u);
+        ASSERT_EQ(async_data.shed_count(), 6u);
+        ASSERT_EQ(async_data.write_backlog(), 4u);
+        ASSERT_EQ(async_data.read_backlog(), 0u);
+    }
+    // the destructor drained the queue, the accepted writes are stored
+    for (uint32_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(header_block_data->HasData(std::to_string(i)));
+    }
+    ASSERT_FALSE(header_block_data->HasData("4"));
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "xgossip/include/block_log_store.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestBlockLogStore, PutGetRemove) {
+    BlockLogStore store("", 1024, 60 * 1000);
+    store.Put("a", "block a");
+    store.Put("b", std::string(3000, 'b'));  // larger than a segment
+    store.Put("c", "block c");
+
+    BlockLogView view;
+    ASSERT_TRUE(store.Get("a", view));
+    ASSERT_EQ(view.ToString(), "block a");
+    ASSERT_TRUE(store.Get("b", view));
+    ASSERT_EQ(view.size, 3000u);
+    ASSERT_TRUE(store.Has("c"));
+
+    store.Remove("a");
+    ASSERT_FALSE(store.Has("a"));
+    store.Put("c", "block c2");
+    ASSERT_TRUE(store.Get("c", view));
+    ASSERT_EQ(view.ToString(), "block c2");
+
+    uint32_t segment_count = 0;
+    uint32_t entry_count = 0;
+    uint64_t bytes = 0;
+    store.GetStat(segment_count, entry_count, bytes);
+    ASSERT_EQ(entry_count, 2u);
+    ASSERT_GE(segment_count, 2u);
+}
+
+TEST(TestBlockLogStore, SegmentsExpireWhole) {
+    BlockLogStore store("/tmp", 1024, 40);
+    store.Put("a", "block a");
+    BlockLogView held;
+    ASSERT_TRUE(store.Get("a", held));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    store.DropExpired();
+    ASSERT_FALSE(store.Has("a"));
+    // the view keeps the dropped segment mapped
+    ASSERT_EQ(held.ToString(), "block a");
+
+    uint32_t segment_count = 0;
+    uint32_t entry_count = 0;
+    uint64_t bytes = 0;
+    store.GetStat(segment_count, entry_count, bytes);
+    ASSERT_EQ(segment_count, 0u);
+    ASSERT_EQ(entry_count, 0u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,420 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xpbase/base/top_utils.h"
+#include "xwrouter/register_routing_table.h"
+
+#define private public
+#include "xgossip/include/block_sync_manager.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/tests/test_gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static const uint64_t kTestServiceType = 1ull;
+// kHeaderRequestedPeriod, the wait for an ack or block after each ask
+static const std::chrono::milliseconds kTestRequestedPeriod(2 * 1000);
+static const uint32_t kTestNodeIdSize = 36u;
+
+class TestBlockSyncManager : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+        // the tests run the header checks themselves, the timer would race them
+        BlockSyncManager::Instance()->timer_.Join();
+    }
+    virtual void SetUp() override {
+        ClearShards();
+    }
+    virtual void TearDown() override {
+        ClearShards();
+    }
+    void ClearShards() {
+        for (uint32_t i = 0; i < BlockSyncManager::kSyncShardCount; ++i) {
+            auto& shard = manager_->header_shards_[i];
+            std::unique_lock<LockWaitMutex> lock(shard.mutex);
+            shard.header_map.clear();
+            while (!shard.deadline_queue.empty()) {
+                shard.deadline_queue.pop();
+            }
+        }
+        std::unique_lock<std::mutex> lock(manager_->envelope_peers_mutex_);
+        manager_->envelope_peers_.clear();
+    }
+    // a copy taken under the shard lock, the map entry may go any time after
+    std::shared_ptr<SyncHeaderRecord> FindRecord(const std::string& header_hash) {
+        auto key = manager_->GetHeaderKey(header_hash);
+        auto& shard = manager_->GetShard(key);
+        std::unique_lock<LockWaitMutex> lock(shard.mutex);
+        auto iter = shard.header_map.find(key);
+        if (iter == shard.header_map.end()) {
+            return nullptr;
+        }
+        return std::make_shared<SyncHeaderRecord>(iter->second);
+    }
+    void CheckShard(
+            const std::string& header_hash,
+            std::chrono::steady_clock::time_point tp_now,
+            std::vector<SyncAction>& actions,
+            std::vector<SyncSource>& timeout_sources) {
+        auto& shard = manager_->GetShard(manager_->GetHeaderKey(header_hash));
+        manager_->CheckShard(shard, tp_now, std::chrono::seconds(1), actions, timeout_sources);
+    }
+
+    BlockSyncManager* manager_{ BlockSyncManager::Instance() };
+};
+
+TEST_F(TestBlockSyncManager, ShardLookup) {
+    std::vector<std::string> header_hashes;
+    std::set<uint32_t> used_shards;
+    for (uint32_t i = 0; i < 64; ++i) {
+        header_hashes.push_back(RandomString(32));
+        manager_->AddHeaderHashToQueue(header_hashes.back(), kTestServiceType, "10.0.0.1", 9000);
+        auto key = manager_->GetHeaderKey(header_hashes.back());
+        uint32_t shard_index = key % BlockSyncManager::kSyncShardCount;
+        ASSERT_EQ(&manager_->GetShard(key), &manager_->header_shards_[shard_index]);
+        used_shards.insert(shard_index);
+    }
+    ASSERT_GT(used_shards.size(), 1u);
+
+    // every record lives in its own shard only
+    uint32_t record_count = 0;
+    for (uint32_t i = 0; i < BlockSyncManager::kSyncShardCount; ++i) {
+        auto& header_map = manager_->header_shards_[i].header_map;
+        for (auto iter = header_map.begin(); iter != header_map.end(); ++iter) {
+            ASSERT_EQ(iter->first % BlockSyncManager::kSyncShardCount, i);
+            ASSERT_EQ(manager_->GetHeaderKey(iter->second.header_hash), iter->first);
+            ++record_count;
+        }
+    }
+    ASSERT_EQ(record_count, header_hashes.size());
+
+    // the same header again only adds a source
+    manager_->AddHeaderHashToQueue(header_hashes[0], kTestServiceType, "10.0.0.2", 9000);
+    manager_->AddHeaderHashToQueue(header_hashes[0], kTestServiceType, "10.0.0.2", 9000);
+    ASSERT_EQ(FindRecord(header_hashes[0])->sources.size(), 2u);
+
+    manager_->RemoveHeaderBlock(header_hashes[0]);
+    ASSERT_TRUE(FindRecord(header_hashes[0]) == nullptr);
+    for (uint32_t i = 1; i < header_hashes.size(); ++i) {
+        ASSERT_TRUE(FindRecord(header_hashes[i]) != nullptr);
+    }
+}
+
+TEST_F(TestBlockSyncManager, StaleDeadlineSkipped) {
+    std::string header_hash = RandomString(32);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+    auto key = manager_->GetHeaderKey(header_hash);
+    auto& shard = manager_->GetShard(key);
+    auto record = FindRecord(header_hash);
+    ASSERT_TRUE(record != nullptr);
+    auto first_deadline = record->deadline;
+    ASSERT_EQ(shard.deadline_queue.size(), 1u);
+
+    // re-arming pushes a new entry, the same time does not
+    auto tp_later = first_deadline + std::chrono::seconds(1);
+    {
+        std::unique_lock<LockWaitMutex> lock(shard.mutex);
+        auto& live_record = shard.header_map.at(key);
+        manager_->SetDeadline(shard, key, live_record, tp_later);
+        manager_->SetDeadline(shard, key, live_record, tp_later);
+        ASSERT_EQ(shard.deadline_queue.size(), 2u);
+    }
+
+    std::vector<SyncAction> actions;
+    std::vector<SyncSource> timeout_sources;
+    CheckShard(header_hash, first_deadline + std::chrono::milliseconds(1), actions, timeout_sources);
+    ASSERT_TRUE(actions.empty());
+    ASSERT_EQ(FindRecord(header_hash)->state, kSyncHeaderAnnounced);
+    ASSERT_EQ(shard.deadline_queue.size(), 1u);
+
+    // the live entry asks, then arms the next ask
+    CheckShard(header_hash, tp_later, actions, timeout_sources);
+    ASSERT_EQ(actions.size(), 1u);
+    ASSERT_EQ(actions[0].type, kSyncActionAsk);
+    ASSERT_EQ(actions[0].header_hashes[0], header_hash);
+    ASSERT_EQ(actions[0].sources.size(), 1u);
+    record = FindRecord(header_hash);
+    ASSERT_EQ(record->state, kSyncHeaderAsking);
+    ASSERT_EQ(record->retry_count, 1u);
+    ASSERT_EQ(record->deadline, tp_later + kTestRequestedPeriod);
+    ASSERT_EQ(shard.deadline_queue.size(), 1u);
+    ASSERT_EQ(shard.deadline_queue.top().time_point, record->deadline);
+    ASSERT_TRUE(timeout_sources.empty());
+}
+
+TEST_F(TestBlockSyncManager, RemovedRecordSkipped) {
+    std::string header_hash = RandomString(32);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+    auto deadline = FindRecord(header_hash)->deadline;
+    manager_->RemoveHeaderBlock(header_hash);
+
+    std::vector<SyncAction> actions;
+    std::vector<SyncSource> timeout_sources;
+    CheckShard(header_hash, deadline, actions, timeout_sources);
+    ASSERT_TRUE(actions.empty());
+    ASSERT_TRUE(manager_->GetShard(manager_->GetHeaderKey(header_hash)).deadline_queue.empty());
+}
+
+TEST_F(TestBlockSyncManager, ExpiredRecordDropped) {
+    std::string header_hash = RandomString(32);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+    auto expire_time = FindRecord(header_hash)->expire_time;
+
+    std::vector<SyncAction> actions;
+    std::vector<SyncSource> timeout_sources;
+    CheckShard(header_hash, expire_time, actions, timeout_sources);
+    ASSERT_TRUE(actions.empty());
+    ASSERT_TRUE(FindRecord(header_hash) == nullptr);
+}
+
+static SyncSource CreateSource(const std::string& ip) {
+    return SyncSource{ ip, 9000, RandomString(kTestNodeIdSize), false, false };
+}
+
+TEST_F(TestBlockSyncManager, HedgeStaysLocal) {
+    std::string header_hash = RandomString(32);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+    auto tp_now = FindRecord(header_hash)->deadline;
+    auto hedge_timeout = std::chrono::milliseconds(20);
+    uint64_t service_type = 0;
+    ASSERT_TRUE(manager_->AckHeader(
+            header_hash, CreateSource("10.0.0.1"), tp_now, hedge_timeout, service_type));
+    ASSERT_EQ(service_type, kTestServiceType);
+    // a second acker inside the hedge timeout is only remembered
+    ASSERT_FALSE(manager_->AckHeader(
+            header_hash, CreateSource("10.0.0.2"), tp_now, hedge_timeout, service_type));
+
+    // the hedge asks the second acker, nobody is blamed yet
+    std::vector<SyncAction> actions;
+    std::vector<SyncSource> timeout_sources;
+    auto tp_hedge = tp_now + hedge_timeout;
+    CheckShard(header_hash, tp_hedge, actions, timeout_sources);
+    ASSERT_EQ(actions.size(), 1u);
+    ASSERT_EQ(actions[0].type, kSyncActionRequest);
+    ASSERT_EQ(actions[0].sources[0].ip, "10.0.0.2");
+    ASSERT_TRUE(timeout_sources.empty());
+
+    // both requests expire unanswered
+    actions.clear();
+    CheckShard(header_hash, tp_hedge + kTestRequestedPeriod, actions, timeout_sources);
+    ASSERT_EQ(actions.size(), 1u);
+    ASSERT_EQ(actions[0].type, kSyncActionAsk);
+    ASSERT_EQ(timeout_sources.size(), 2u);
+}
+
+TEST_F(TestBlockSyncManager, RequestWaitsWithoutHedge) {
+    std::string header_hash = RandomString(32);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+    auto tp_now = FindRecord(header_hash)->deadline;
+    auto hedge_timeout = std::chrono::milliseconds(20);
+    uint64_t service_type = 0;
+    ASSERT_TRUE(manager_->AckHeader(
+            header_hash, CreateSource("10.0.0.1"), tp_now, hedge_timeout, service_type));
+
+    // nobody to hedge to, keep waiting on the first acker
+    std::vector<SyncAction> actions;
+    std::vector<SyncSource> timeout_sources;
+    CheckShard(header_hash, tp_now + hedge_timeout, actions, timeout_sources);
+    ASSERT_TRUE(actions.empty());
+    ASSERT_TRUE(timeout_sources.empty());
+    ASSERT_EQ(FindRecord(header_hash)->deadline, tp_now + kTestRequestedPeriod);
+
+    // an acker after the hedge timeout is the hedge right away
+    ASSERT_TRUE(manager_->AckHeader(
+            header_hash,
+            CreateSource("10.0.0.2"),
+            tp_now + 2 * hedge_timeout,
+            hedge_timeout,
+            service_type));
+    ASSERT_EQ(FindRecord(header_hash)->request_count, 2u);
+
+    // the record expires with both requests out
+    auto expire_time = FindRecord(header_hash)->expire_time;
+    CheckShard(header_hash, expire_time, actions, timeout_sources);
+    ASSERT_TRUE(FindRecord(header_hash) == nullptr);
+    ASSERT_EQ(timeout_sources.size(), 2u);
+}
+
+TEST_F(TestBlockSyncManager, RemoveKeepsStoredBlock) {
+    manager_->SetBlockLogStore(std::make_shared<BlockLogStore>("", 64 * 1024, 60 * 1000));
+    std::string header_hash = RandomString(32);
+    manager_->header_block_data_->AddData(header_hash, "block data");
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "10.0.0.1", 9000);
+
+    // dropping the sync record keeps the block for neighbors that ask
+    manager_->RemoveHeaderBlock(header_hash);
+    ASSERT_TRUE(FindRecord(header_hash) == nullptr);
+    ASSERT_TRUE(manager_->DataExists(header_hash));
+    std::string block;
+    manager_->header_block_data_->GetData(header_hash, block);
+    ASSERT_EQ(block, "block data");
+}
+
+TEST_F(TestBlockSyncManager, CachedResponseFollowsStore) {
+    auto block_store = std::make_shared<BlockLogStore>("", 64 * 1024, 60 * 1000);
+    manager_->SetBlockLogStore(block_store);
+    std::string header_hash = RandomString(32);
+    manager_->header_block_data_->AddData(header_hash, "block data");
+    auto response = manager_->GetSyncResponse(header_hash);
+    ASSERT_TRUE(response != nullptr);
+    BlockLogView view;
+    ASSERT_TRUE(block_store->Get(header_hash, view));
+    ASSERT_TRUE(response->expire_time == view.expire_time);
+
+    // the cached response goes with the block
+    manager_->RemoveBlock(header_hash);
+    ASSERT_FALSE(manager_->DataExists(header_hash));
+    ASSERT_TRUE(manager_->GetSyncResponse(header_hash) == nullptr);
+}
+
+TEST_F(TestBlockSyncManager, IdleStoreDropsExpiredSegments) {
+    auto block_store = std::make_shared<BlockLogStore>("", 64 * 1024, 40);
+    manager_->SetBlockLogStore(block_store);
+    std::string header_hash = RandomString(32);
+    manager_->header_block_data_->AddData(header_hash, "block data");
+    ASSERT_TRUE(manager_->GetSyncResponse(header_hash) != nullptr);
+
+    // no writes after this one, only the header checks run
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    for (uint32_t i = 0; i < BlockSyncManager::kExpireCheckCount; ++i) {
+        manager_->CheckHeaderHashQueue();
+    }
+    uint32_t segment_count = 0;
+    uint32_t entry_count = 0;
+    uint64_t bytes = 0;
+    block_store->GetStat(segment_count, entry_count, bytes);
+    ASSERT_EQ(segment_count, 0u);
+    ASSERT_EQ(entry_count, 0u);
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    manager_->response_cache_.GetStat(hit, miss, bytes);
+    ASSERT_EQ(bytes, 0u);
+}
+
+TEST_F(TestBlockSyncManager, UnknownPeerGetsSingleHeaders) {
+    auto transport = std::make_shared<TestTransport>();
+    auto routing_table = CreateTestRoutingTable(
+            transport, CreateTestLocalNode(9000), CreateTestNodes(2, 10000));
+    std::vector<std::string> header_hashes;
+    for (uint32_t i = 0; i < 3; ++i) {
+        header_hashes.push_back(RandomString(32));
+    }
+
+    // the peer may run the old protocol, one raw header hash a request
+    manager_->SendSyncHeaders(
+            routing_table, kGossipBlockSyncRequest, kTestServiceType, "", "127.0.0.1", 10000, header_hashes);
+    ASSERT_EQ(transport->sent().size(), header_hashes.size());
+    for (uint32_t i = 0; i < header_hashes.size(); ++i) {
+        ASSERT_EQ(transport->sent()[i].message.data(), header_hashes[i]);
+    }
+
+    // once it sent an envelope it gets batches
+    transport->sent().clear();
+    manager_->AddEnvelopePeer("127.0.0.1", 10000);
+    ASSERT_FALSE(manager_->IsEnvelopePeer("127.0.0.1", 10001));
+    manager_->SendSyncHeaders(
+            routing_table, kGossipBlockSyncRequest, kTestServiceType, "", "127.0.0.1", 10000, header_hashes);
+    ASSERT_EQ(transport->sent().size(), 1u);
+    std::vector<std::string> entries;
+    ASSERT_TRUE(DecodeSyncEnvelope(transport->sent()[0].message.data(), kSyncEnvelopeBatch, entries));
+    ASSERT_EQ(entries, header_hashes);
+}
+
+// a block over kSyncChunkSize, stored here for header_hash
+static std::string CreateLargeBlock(BlockSyncManager* manager, const std::string& header_hash) {
+    transport::protobuf::RoutingMessage block_message;
+    block_message.set_type(kTestChainTrade);
+    block_message.set_data(RandomString(40 * 1024));
+    std::string block = block_message.SerializeAsString();
+    manager->header_block_data_->AddData(header_hash, block);
+    return block;
+}
+
+TEST_F(TestBlockSyncManager, ManifestOnlyForEnvelopeRequests) {
+    manager_->SetBlockLogStore(std::make_shared<BlockLogStore>("", 64 * 1024, 60 * 1000));
+    auto transport = std::make_shared<TestTransport>();
+    auto routing_table = CreateTestRoutingTable(
+            transport, CreateTestLocalNode(9000), CreateTestNodes(2, 10000));
+    wrouter::RegisterRoutingTable(kTestServiceType, routing_table);
+    std::string header_hash = RandomString(32);
+    std::string block = CreateLargeBlock(manager_, header_hash);
+    // chunks are cut from the bytes in the store, not from a copy
+    BlockLogView view;
+    ASSERT_TRUE(manager_->header_block_data_->block_store_->Get(header_hash, view));
+    ASSERT_EQ(manager_->GetSyncResponse(header_hash)->block.data, view.data);
+
+    // an old requester asks with the raw hash and gets the whole block
+    transport::protobuf::RoutingMessage request;
+    request.set_type(kGossipBlockSyncRequest);
+    request.set_src_service_type(kTestServiceType);
+    request.set_data(header_hash);
+    manager_->ServeSyncRequest(request, "127.0.0.1", 10000);
+    ASSERT_EQ(transport->sent().size(), 1u);
+    transport::protobuf::GossipSyncBlockData gossip_data;
+    ASSERT_TRUE(gossip_data.ParseFromString(transport->sent()[0].message.data()));
+    ASSERT_EQ(gossip_data.header_hash(), header_hash);
+    ASSERT_EQ(gossip_data.block(), block);
+
+    // an envelope request gets the manifest
+    transport->sent().clear();
+    std::string data;
+    EncodeSyncEnvelope(kSyncEnvelopeBatch, { header_hash }, data);
+    request.set_data(data);
+    manager_->ServeSyncRequest(request, "127.0.0.1", 10001);
+    ASSERT_EQ(transport->sent().size(), 1u);
+    SyncChunkManifest manifest;
+    ASSERT_TRUE(DecodeSyncManifest(transport->sent()[0].message.data(), manifest));
+    ASSERT_EQ(manifest.total_size, block.size());
+    wrouter::UnregisterRoutingTable(kTestServiceType);
+}
+
+TEST_F(TestBlockSyncManager, ChunksKeptAsReceived) {
+    manager_->SetBlockLogStore(std::make_shared<BlockLogStore>("", 64 * 1024, 60 * 1000));
+    auto routing_table = CreateTestRoutingTable(
+            std::make_shared<TestTransport>(), CreateTestLocalNode(9000), CreateTestNodes(2, 10000));
+    wrouter::RegisterRoutingTable(kTestServiceType, routing_table);
+    std::string header_hash = RandomString(32);
+    std::string block = CreateLargeBlock(manager_, header_hash);
+    SyncChunkManifest manifest;
+    ASSERT_TRUE(DecodeSyncManifest(manager_->GetSyncResponse(header_hash)->payload, manifest));
+    manager_->RemoveHeaderBlock(header_hash);
+    manager_->AddHeaderHashToQueue(header_hash, kTestServiceType, "127.0.0.1", 10000);
+
+    // nothing is allocated for the size the manifest claims
+    manager_->HandleSyncManifest(manifest, CreateSource("127.0.0.1"));
+    auto transfer = FindRecord(header_hash)->transfer;
+    ASSERT_TRUE(transfer != nullptr);
+    ASSERT_EQ(transfer->chunks.size(), manifest.chunk_hashes.size());
+    for (uint32_t i = 0; i < transfer->chunks.size(); ++i) {
+        ASSERT_TRUE(transfer->chunks[i].empty());
+    }
+
+    // chunks in any order make up the block
+    for (uint32_t i = transfer->chunks.size(); i > 0; --i) {
+        uint32_t offset = (i - 1) * manifest.chunk_size;
+        manager_->HandleSyncChunk(SyncChunk{ header_hash, i - 1, block.substr(offset, manifest.chunk_size) });
+    }
+    ASSERT_EQ(FindRecord(header_hash)->state, kSyncHeaderFetched);
+    ASSERT_TRUE(FindRecord(header_hash)->transfer == nullptr);
+    wrouter::UnregisterRoutingTable(kTestServiceType);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
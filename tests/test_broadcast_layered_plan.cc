@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#define private public
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/node_capacity.h"
+#include "xgossip/tests/test_gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static void CreatePlanMessage(
+        uint32_t msg_id,
+        uint32_t gossip_type,
+        transport::protobuf::RoutingMessage& message) {
+    message.set_id(msg_id);
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(0);
+    auto gossip_param = message.mutable_gossip();
+    gossip_param->set_neighber_count(3);
+    gossip_param->set_gossip_type(gossip_type);
+    gossip_param->set_msg_hash(msg_id);
+}
+
+TEST(TestBroadcastLayeredPlan, PlanFollowsMembership) {
+    auto nodes = CreateTestNodes(30, 10000);
+    auto routing_table = CreateTestRoutingTable(nullptr, CreateTestLocalNode(9000), nodes);
+    BroadcastLayered broadcast(nullptr);
+    transport::protobuf::RoutingMessage message;
+    CreatePlanMessage(7, kGossipLayeredBroadcast, message);
+
+    auto plan = broadcast.GetBroadcastPlan(message, routing_table);
+    ASSERT_TRUE(plan != nullptr);
+    ASSERT_FALSE(plan->nodes.empty());
+    ASSERT_EQ(broadcast.GetBroadcastPlan(message, routing_table), plan);
+
+    // one member leaves and another joins, the table keeps its size
+    auto left_node = plan->nodes[0];
+    routing_table->DropNode(left_node);
+    routing_table->AddNode(CreateTestNode(RandomString(kadmlia::kNodeIdSize), 10100));
+    BroadcastLayered::OnMembershipChanged();
+    ASSERT_EQ(routing_table->nodes_size(), nodes.size());
+
+    auto new_plan = broadcast.GetBroadcastPlan(message, routing_table);
+    ASSERT_TRUE(new_plan != nullptr);
+    ASSERT_NE(new_plan, plan);
+    for (auto iter = new_plan->nodes.begin(); iter != new_plan->nodes.end(); ++iter) {
+        ASSERT_NE((*iter)->hash64, left_node->hash64);
+    }
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    broadcast.GetPlanCacheStat(hit_count, miss_count);
+    ASSERT_EQ(hit_count, 1u);
+    ASSERT_EQ(miss_count, 2u);
+}
+
+static std::set<uint64_t> NodesHash(const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+    std::set<uint64_t> hash_set;
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        hash_set.insert((*iter)->hash64);
+    }
+    return hash_set;
+}
+
+// the capacity classes one relay knows: what the others advertised to it,
+// its own one it sets itself
+static void SetRelayCapacity(
+        const kadmlia::LocalNodeInfoPtr& local,
+        uint32_t local_capacity,
+        const kadmlia::LocalNodeInfoPtr& peer,
+        uint32_t peer_capacity) {
+    auto capacity = NodeCapacityManager::Instance();
+    capacity->RemoveNode(local->hash64());
+    capacity->SetNodeCapacity(peer->hash64(), peer_capacity);
+    capacity->SetLocalCapacity(local_capacity);
+}
+
+TEST(TestBroadcastLayeredPlan, CapacityTreeSameOnEveryRelay) {
+    auto others = CreateTestNodes(20, 11000);
+    for (uint32_t i = 0; i < others.size(); ++i) {
+        NodeCapacityManager::Instance()->SetNodeCapacity(
+                others[i]->hash64,
+                (i % 2 == 0) ? kUploadCapacityLow : kUploadCapacityMiddle);
+    }
+    // relay a is the only high capacity node, relay b a low one
+    auto local_a = CreateTestLocalNode(9001);
+    auto local_b = CreateTestLocalNode(9002);
+    auto nodes_a = others;
+    nodes_a.push_back(CreateTestNode(local_b));
+    auto nodes_b = others;
+    nodes_b.push_back(CreateTestNode(local_a));
+    auto routing_table_a = CreateTestRoutingTable(nullptr, local_a, nodes_a);
+    auto routing_table_b = CreateTestRoutingTable(nullptr, local_b, nodes_b);
+    BroadcastLayered broadcast_a(nullptr, kLayeredTreeCapacity);
+    BroadcastLayered broadcast_b(nullptr, kLayeredTreeCapacity);
+
+    for (uint32_t msg_id = 1; msg_id <= 30; ++msg_id) {
+        transport::protobuf::RoutingMessage first_message;
+        CreatePlanMessage(msg_id, kGossipLayeredCapacity, first_message);
+        transport::protobuf::RoutingMessage relay_message(first_message);
+        relay_message.set_hop_num(1);
+
+        SetRelayCapacity(local_b, kUploadCapacityLow, local_a, kUploadCapacityHigh);
+        auto plan_b = broadcast_b.GetBroadcastPlan(first_message, routing_table_b);
+        SetRelayCapacity(local_a, kUploadCapacityHigh, local_b, kUploadCapacityLow);
+        auto first_plan_a = broadcast_a.GetBroadcastPlan(first_message, routing_table_a);
+        auto plan_a = broadcast_a.GetBroadcastPlan(relay_message, routing_table_a);
+        ASSERT_TRUE(plan_b && first_plan_a && plan_a);
+
+        // b puts a first under the originator, with the children a picks
+        // for itself, and both agree on the other first hop nodes
+        ASSERT_EQ(plan_b->nodes.size(), 3u);
+        ASSERT_EQ(plan_b->nodes[0]->hash64, local_a->hash64());
+        ASSERT_EQ(NodesHash(plan_b->bypass_nodes[0]), NodesHash(plan_a->nodes));
+        std::vector<kadmlia::NodeInfoPtr> first_hop_b(plan_b->nodes.begin() + 1, plan_b->nodes.end());
+        std::vector<kadmlia::NodeInfoPtr> first_hop_a(
+                first_plan_a->nodes.begin(),
+                first_plan_a->nodes.begin() + first_hop_b.size());
+        ASSERT_EQ(NodesHash(first_hop_a), NodesHash(first_hop_b));
+        // the same children under them, a plan never lists its own node
+        for (uint32_t i = 1; i < plan_b->nodes.size(); ++i) {
+            auto children_a = NodesHash(first_plan_a->bypass_nodes[i - 1]);
+            children_a.erase(local_b->hash64());
+            ASSERT_EQ(NodesHash(plan_b->bypass_nodes[i]), children_a);
+        }
+    }
+
+    auto capacity = NodeCapacityManager::Instance();
+    for (auto iter = nodes_a.begin(); iter != nodes_a.end(); ++iter) {
+        capacity->RemoveNode((*iter)->hash64);
+    }
+    capacity->RemoveNode(local_a->hash64());
+    capacity->SetLocalCapacity(kUploadCapacityUnknown);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
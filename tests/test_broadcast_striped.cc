@@ -0,0 +1,226 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define private public
+#include "xgossip/include/broadcast_striped.h"
+#include "xgossip/include/layered_tree_index.h"
+#include "xgossip/include/striped_tree_index.h"
+#include "xgossip/tests/test_gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static const uint32_t kMaxTestMsgHash = 0x10000u;
+
+TEST(TestBroadcastStriped, LogicalIndexMatchOrder) {
+    for (uint32_t k = 1; k <= 8; ++k) {
+        for (uint32_t count = 1; count <= 300; ++count) {
+            for (uint32_t t = 0; t < k; ++t) {
+                // group t first, then the rest, both ascending
+                std::vector<uint32_t> order;
+                for (uint32_t r = 1; r <= count; ++r) {
+                    if (StripeTreeIndex(r, k) == t) {
+                        order.push_back(r);
+                    }
+                }
+                for (uint32_t r = 1; r <= count; ++r) {
+                    if (StripeTreeIndex(r, k) != t) {
+                        order.push_back(r);
+                    }
+                }
+                if (k == 1) {
+                    order.resize(count);
+                }
+                for (uint32_t l = 1; l <= count; ++l) {
+                    ASSERT_EQ(StripedRotatedIndex(l, t, k, count), order[l - 1])
+                            << "k:" << k << " count:" << count << " t:" << t << " l:" << l;
+                    ASSERT_EQ(StripedLogicalIndex(order[l - 1], t, k, count), l);
+                }
+            }
+        }
+    }
+}
+
+TEST(TestBroadcastStriped, InteriorInOneTree) {
+    for (uint32_t k = 2; k <= 8; ++k) {
+        for (uint32_t count = 1; count <= 300; ++count) {
+            for (uint32_t r = 1; r <= count; ++r) {
+                uint32_t interior_trees = 0;
+                for (uint32_t t = 0; t < k; ++t) {
+                    uint32_t l = StripedLogicalIndex(r, t, k, count);
+                    if (!LayeredIsLeaf(l, k, count)) {
+                        ++interior_trees;
+                        ASSERT_EQ(t, StripeTreeIndex(r, k));
+                    }
+                }
+                ASSERT_LE(interior_trees, 1u);
+            }
+        }
+    }
+}
+
+static StripeHeader CreateStripeHeader(
+        uint32_t msg_hash,
+        uint32_t stripe_index,
+        uint32_t stripe_count,
+        uint32_t total_size) {
+    StripeHeader header;
+    header.magic = BroadcastStriped::kStripeMagic;
+    header.msg_hash = msg_hash;
+    header.stripe_index = static_cast<uint16_t>(stripe_index);
+    header.stripe_count = static_cast<uint16_t>(stripe_count);
+    header.total_size = total_size;
+    return header;
+}
+
+TEST(TestBroadcastStriped, EncodeDecodeStripe) {
+    auto header = CreateStripeHeader(77, 1, 3, 10);
+    auto data = BroadcastStriped::EncodeStripe(header, "abcd");
+    ASSERT_EQ(data.size(), sizeof(StripeHeader) + 4);
+
+    StripeHeader decoded;
+    std::string stripe;
+    ASSERT_TRUE(BroadcastStriped::DecodeStripe(data, decoded, stripe));
+    ASSERT_EQ(decoded.msg_hash, 77u);
+    ASSERT_EQ(decoded.stripe_index, 1u);
+    ASSERT_EQ(decoded.stripe_count, 3u);
+    ASSERT_EQ(decoded.total_size, 10u);
+    ASSERT_EQ(stripe, "abcd");
+
+    // an empty stripe still carries its header
+    ASSERT_TRUE(BroadcastStriped::DecodeStripe(
+            BroadcastStriped::EncodeStripe(CreateStripeHeader(1, 0, 1, 0), ""), decoded, stripe));
+    ASSERT_TRUE(stripe.empty());
+
+    ASSERT_FALSE(BroadcastStriped::DecodeStripe(data.substr(0, sizeof(StripeHeader) - 1), decoded, stripe));
+    ASSERT_FALSE(BroadcastStriped::DecodeStripe("plain block data", decoded, stripe));
+    header.stripe_index = 3;
+    ASSERT_FALSE(BroadcastStriped::DecodeStripe(
+            BroadcastStriped::EncodeStripe(header, "abcd"), decoded, stripe));
+    header.stripe_index = 0;
+    header.stripe_count = 0;
+    ASSERT_FALSE(BroadcastStriped::DecodeStripe(
+            BroadcastStriped::EncodeStripe(header, "abcd"), decoded, stripe));
+}
+
+TEST(TestBroadcastStriped, SendStripes) {
+    auto transport = std::make_shared<TestTransport>();
+    auto routing_table = CreateTestRoutingTable(
+            transport, CreateTestLocalNode(9000), CreateTestNodes(30, 10000));
+    BroadcastStriped broadcast(transport);
+
+    transport::protobuf::RoutingMessage message;
+    message.set_id(5);
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(0);
+    message.set_data(RandomString(40 * 1024 + 7));
+    message.mutable_gossip()->set_neighber_count(3);
+    message.mutable_gossip()->set_gossip_type(kGossipStripedLayered);
+    message.mutable_gossip()->set_msg_hash(123);
+    broadcast.SendStripes(message, routing_table);
+
+    // 3 stripes of 40KiB, each to the first hop of its own tree, less
+    // this node when it is one of them
+    const uint32_t stripe_count = 3;
+    uint32_t stripe_size = (message.data().size() + stripe_count - 1) / stripe_count;
+    std::vector<uint32_t> sent_count(stripe_count, 0);
+    for (auto iter = transport->sent().begin(); iter != transport->sent().end(); ++iter) {
+        ASSERT_NE(iter->port, 9000u);
+        StripeHeader header;
+        std::string stripe;
+        ASSERT_TRUE(BroadcastStriped::DecodeStripe(iter->message.data(), header, stripe));
+        ASSERT_EQ(header.msg_hash, 123u);
+        ASSERT_EQ(header.stripe_count, stripe_count);
+        ASSERT_EQ(header.total_size, message.data().size());
+        ASSERT_LT(header.stripe_index, stripe_count);
+        ASSERT_EQ(stripe, message.data().substr(header.stripe_index * stripe_size, stripe_size));
+        ASSERT_EQ(
+                iter->message.gossip().msg_hash(),
+                broadcast.GetStripeMessageHash(123, header.stripe_index));
+        ++sent_count[header.stripe_index];
+    }
+    for (uint32_t i = 0; i < stripe_count; ++i) {
+        ASSERT_GE(sent_count[i], 2u);
+    }
+}
+
+TEST(TestBroadcastStriped, AddStripe) {
+    BroadcastStriped broadcast(nullptr);
+    std::string whole = RandomString(30);
+    std::string data;
+
+    // out of order, a repeated stripe is ignored
+    std::string stripe = whole.substr(20, 10);
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 2, 3, 30), stripe, data));
+    stripe = whole.substr(0, 10);
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 0, 3, 30), stripe, data));
+    stripe = whole.substr(0, 10);
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 0, 3, 30), stripe, data));
+    // a stripe that does not fit the message is dropped
+    stripe = whole.substr(10, 10);
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 1, 4, 30), stripe, data));
+    stripe = whole.substr(10, 10);
+    ASSERT_TRUE(broadcast.AddStripe(CreateStripeHeader(1, 1, 3, 30), stripe, data));
+    ASSERT_EQ(data, whole);
+    // delivered once
+    stripe = whole.substr(10, 10);
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 1, 3, 30), stripe, data));
+
+    // an empty message is one empty stripe
+    stripe.clear();
+    data = "stale";
+    ASSERT_TRUE(broadcast.AddStripe(CreateStripeHeader(2, 0, 1, 0), stripe, data));
+    ASSERT_TRUE(data.empty());
+}
+
+TEST(TestBroadcastStriped, StripeMapKeepsPartialMessages) {
+    const uint32_t max_map_size = BroadcastStriped::kMaxStripeMapSize;
+    BroadcastStriped broadcast(nullptr);
+    std::string data;
+    std::string stripe("a");
+    ASSERT_FALSE(broadcast.AddStripe(CreateStripeHeader(1, 0, 2, 2), stripe, data));
+
+    // fill the map with messages past the timeout
+    auto old_time = std::chrono::steady_clock::now() -
+            std::chrono::seconds(BroadcastStriped::kStripeTimeoutSec + 1);
+    for (uint32_t msg_hash = 2; msg_hash <= max_map_size; ++msg_hash) {
+        stripe = "b";
+        broadcast.AddStripe(CreateStripeHeader(msg_hash, 0, 2, 2), stripe, data);
+        broadcast.stripe_map_[msg_hash]->create_time = old_time;
+    }
+    ASSERT_EQ(broadcast.stripe_map_.size(), max_map_size);
+
+    stripe = "c";
+    broadcast.AddStripe(CreateStripeHeader(kMaxTestMsgHash, 0, 2, 2), stripe, data);
+    ASSERT_EQ(broadcast.stripe_map_.size(), 2u);
+    stripe = "d";
+    ASSERT_TRUE(broadcast.AddStripe(CreateStripeHeader(1, 1, 2, 2), stripe, data));
+    ASSERT_EQ(data, "ad");
+
+    // none past the timeout, the delivered message goes before partial ones
+    for (uint32_t msg_hash = 2; broadcast.stripe_map_.size() < max_map_size; ++msg_hash) {
+        stripe = "e";
+        broadcast.AddStripe(CreateStripeHeader(msg_hash, 0, 2, 2), stripe, data);
+    }
+    stripe = "f";
+    broadcast.AddStripe(CreateStripeHeader(kMaxTestMsgHash + 1, 0, 2, 2), stripe, data);
+    ASSERT_EQ(broadcast.stripe_map_.size(), max_map_size);
+    ASSERT_EQ(broadcast.stripe_map_.count(1), 0u);
+    ASSERT_EQ(broadcast.stripe_map_.count(kMaxTestMsgHash), 1u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
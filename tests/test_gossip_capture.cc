@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#define private public
+#define protected public
+#include "xgossip/include/gossip_capture.h"
+#include "xgossip/include/gossip_filter.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestGossipCapture, WriteAndRead) {
+    std::string path = "/tmp/test_gossip_capture_" + std::to_string(getpid()) + ".cap";
+    GossipCaptureWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    ASSERT_TRUE(writer.Write(1000, "10.0.0.1", 9000, "first"));
+    ASSERT_TRUE(writer.Write(2500, "", 0, std::string("se\0cond", 7)));
+    ASSERT_TRUE(writer.Write(4000, "10.0.0.2", 65535, ""));
+    writer.Close();
+
+    GossipCaptureReader reader;
+    ASSERT_TRUE(reader.Open(path));
+    GossipCaptureRecord record;
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.arrive_us, 1000u);
+    ASSERT_EQ(record.from_ip, "10.0.0.1");
+    ASSERT_EQ(record.from_port, 9000u);
+    ASSERT_EQ(std::string(record.message_data, record.message_size), "first");
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.arrive_us, 2500u);
+    ASSERT_EQ(record.from_ip, "");
+    ASSERT_EQ(std::string(record.message_data, record.message_size), std::string("se\0cond", 7));
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.from_port, 65535u);
+    ASSERT_EQ(record.message_size, 0u);
+    ASSERT_FALSE(reader.Next(record));
+
+    reader.Rewind();
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.arrive_us, 1000u);
+    reader.Close();
+    unlink(path.c_str());
+}
+
+TEST(TestGossipCapture, TornRecordEndsCapture) {
+    std::string path = "/tmp/test_gossip_capture_torn_" + std::to_string(getpid()) + ".cap";
+    GossipCaptureWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    ASSERT_TRUE(writer.Write(1, "10.0.0.1", 9000, "whole"));
+    ASSERT_TRUE(writer.Write(2, "10.0.0.1", 9000, "torn message"));
+    uint64_t size = writer.size();
+    writer.Close();
+    ASSERT_EQ(truncate(path.c_str(), size - 3), 0);
+
+    GossipCaptureReader reader;
+    ASSERT_TRUE(reader.Open(path));
+    GossipCaptureRecord record;
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(std::string(record.message_data, record.message_size), "whole");
+    ASSERT_FALSE(reader.Next(record));
+    reader.Close();
+
+    // not a capture
+    FILE* file = fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fputs("not a capture file", file);
+    fclose(file);
+    ASSERT_FALSE(reader.Open(path));
+    unlink(path.c_str());
+}
+
+TEST(TestGossipCapture, FilterRecordsPacketAddress) {
+    auto filter = GossipFilter::Instance();
+    if (!filter->inited_) {
+        ASSERT_TRUE(filter->Init());
+    }
+    std::string path = "/tmp/test_gossip_capture_filter_" + std::to_string(getpid()) + ".cap";
+    ASSERT_TRUE(GossipCapture::Instance()->Start(path, 1024 * 1024));
+
+    transport::protobuf::RoutingMessage message;
+    message.set_id(1);
+    message.mutable_gossip()->set_msg_hash(getpid());
+    // what the sender claims, the packet came from somewhere else
+    message.mutable_gossip()->set_pre_ip("10.0.0.1");
+    message.mutable_gossip()->set_pre_port(9000);
+    filter->FilterMessage(message, "10.0.0.9", 9100);
+    // the wrouter receive path has only what the sender put there, the
+    // duplicate is captured too
+    filter->FilterMessage(message);
+    GossipCapture::Instance()->Stop();
+
+    GossipCaptureReader reader;
+    ASSERT_TRUE(reader.Open(path));
+    GossipCaptureRecord record;
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.from_ip, "10.0.0.9");
+    ASSERT_EQ(record.from_port, 9100u);
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ(record.from_ip, "10.0.0.1");
+    ASSERT_EQ(record.from_port, 9000u);
+    transport::protobuf::RoutingMessage captured;
+    ASSERT_TRUE(captured.ParseFromArray(record.message_data, record.message_size));
+    ASSERT_EQ(captured.gossip().msg_hash(), message.gossip().msg_hash());
+    ASSERT_FALSE(reader.Next(record));
+    reader.Close();
+    unlink(path.c_str());
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
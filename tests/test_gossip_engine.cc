@@ -0,0 +1,128 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "xpbase/base/top_utils.h"
+#include "xgossip/include/gossip_engine.h"
+#include "xgossip/include/gossip_registry.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+// records the stages run, stops or selects nothing on demand
+struct TestStop {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        engine.stages += "stop,";
+        return !engine.stop;
+    }
+};
+
+struct TestSelect {
+    template <class Engine>
+    static bool Run(Engine& engine, GossipPass& pass) {
+        engine.stages += "select,";
+        for (uint32_t i = 0; i < engine.select_count; ++i) {
+            pass.nodes.push_back(std::make_shared<kadmlia::NodeInfo>());
+        }
+        return !pass.nodes.empty();
+    }
+};
+
+struct TestFilter {
+    template <class Engine>
+    static void Run(Engine& engine, GossipPass& pass) {
+        engine.stages += "filter,";
+        pass.message.mutable_gossip()->add_pass_node(static_cast<uint32_t>(pass.context.local_hash64));
+    }
+};
+
+struct TestSend {
+    template <class Engine>
+    static uint32_t Run(Engine& engine, GossipPass& pass) {
+        engine.stages += "send,";
+        engine.fanout += pass.nodes.size();
+        return pass.nodes.size();
+    }
+};
+
+class TestEngine : public GossipEngine<TestEngine, TestStop, TestSelect, TestFilter, TestSend> {
+public:
+    TestEngine() : GossipEngine(nullptr) {}
+
+    std::string stages;
+    bool stop{ false };
+    uint32_t select_count{ 0 };
+    uint32_t fanout{ 0 };
+};
+
+static void InitMessage(transport::protobuf::RoutingMessage& message, uint32_t gossip_type) {
+    message.set_id(1);
+    message.mutable_gossip()->set_gossip_type(gossip_type);
+}
+
+TEST(TestGossipEngine, Stages) {
+    TestEngine engine;
+    GossipContext context;
+    context.local_hash64 = 7;
+    transport::protobuf::RoutingMessage message;
+    InitMessage(message, kGossipSetFilterAndLayered);
+
+    engine.stop = true;
+    engine.Run(context, message);
+    ASSERT_EQ(engine.stages, "stop,");
+
+    engine.stages.clear();
+    engine.stop = false;
+    engine.Run(context, message);
+    ASSERT_EQ(engine.stages, "stop,select,");
+    ASSERT_EQ(message.gossip().pass_node_size(), 0);
+
+    engine.stages.clear();
+    engine.select_count = 3;
+    engine.Broadcast(7, message, nullptr);
+    ASSERT_EQ(engine.stages, "stop,select,filter,send,");
+    ASSERT_EQ(engine.fanout, 3u);
+    ASSERT_EQ(message.gossip().pass_node_size(), 1);
+    ASSERT_EQ(message.gossip().pass_node(0), 7u);
+
+    // tree entry without a routing table stops before any stage
+    engine.stages.clear();
+    kadmlia::RoutingTablePtr routing_table;
+    engine.Broadcast(message, routing_table);
+    ASSERT_TRUE(engine.stages.empty());
+}
+
+TEST(TestGossipEngine, Registry) {
+    GossipRegistry registry(nullptr);
+    ASSERT_TRUE(registry.Has(kGossipBloomfilter));
+    ASSERT_TRUE(registry.Has(kGossipLayeredCapacity));
+    ASSERT_FALSE(registry.Has(kGossipStripedLayered));
+    ASSERT_FALSE(registry.Has(kGossipTypeCount));
+
+    GossipContext context;
+    transport::protobuf::RoutingMessage message;
+    InitMessage(message, kGossipStripedLayered);
+    ASSERT_FALSE(registry.Broadcast(context, message));
+
+    auto engine = std::make_shared<TestEngine>();
+    engine->select_count = 2;
+    registry.Register(kGossipStripedLayered, engine);
+    ASSERT_TRUE(registry.Broadcast(context, message));
+    ASSERT_EQ(engine->stages, "stop,select,filter,send,");
+    ASSERT_EQ(engine->fanout, 2u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
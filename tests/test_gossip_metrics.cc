@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "xgossip/include/gossip_metrics.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestGossipMetrics, HistogramBuckets) {
+    for (uint64_t value = 0; value < 8; ++value) {
+        ASSERT_EQ(GossipHistogram::BucketIndex(value), value);
+    }
+    ASSERT_EQ(GossipHistogram::BucketIndex(8), 8u);
+    ASSERT_EQ(GossipHistogram::BucketIndex(15), 15u);
+    ASSERT_EQ(GossipHistogram::BucketIndex(16), 16u);
+    ASSERT_EQ(GossipHistogram::BucketIndex(17), 16u);
+    ASSERT_EQ(GossipHistogram::BucketIndex(~0ull), GossipHistogram::kBucketCount - 1);
+    // every value lands in the bucket whose lower bound is at most itself
+    // and within 12.5% of it
+    for (uint64_t value = 1; value < (1ull << 40); value = value * 3 + 1) {
+        uint32_t index = GossipHistogram::BucketIndex(value);
+        uint64_t lower = GossipHistogram::BucketLowerBound(index);
+        ASSERT_LE(lower, value);
+        ASSERT_LE(value - lower, lower / 8);
+        ASSERT_EQ(GossipHistogram::BucketIndex(lower), index);
+    }
+
+    GossipHistogram histogram;
+    for (uint64_t value = 1; value <= 100; ++value) {
+        histogram.Add(value);
+    }
+    GossipHistogramSnapshot snapshot;
+    histogram.GetSnapshot(snapshot);
+    ASSERT_EQ(snapshot.count, 100u);
+    ASSERT_EQ(snapshot.sum, 5050u);
+    ASSERT_EQ(snapshot.max, 100u);
+    ASSERT_EQ(snapshot.Percentile(0.0), 1u);
+    ASSERT_EQ(snapshot.Percentile(0.5), 48u);
+    ASSERT_EQ(snapshot.Percentile(0.99), 96u);
+}
+
+TEST(TestGossipMetrics, HistogramMergesStripes) {
+    GossipHistogram histogram;
+    std::vector<std::thread> threads;
+    for (uint64_t i = 1; i <= 4; ++i) {
+        threads.push_back(std::thread([&histogram, i]() {
+            for (uint32_t j = 0; j < 1000; ++j) {
+                histogram.Add(i * 100);
+            }
+        }));
+    }
+    for (auto iter = threads.begin(); iter != threads.end(); ++iter) {
+        iter->join();
+    }
+    // each thread has its own stripe, the snapshot is the whole
+    GossipHistogramSnapshot snapshot;
+    histogram.GetSnapshot(snapshot);
+    ASSERT_EQ(snapshot.count, 4000u);
+    ASSERT_EQ(snapshot.sum, 1000u * (100u + 200u + 300u + 400u));
+    ASSERT_EQ(snapshot.max, 400u);
+    ASSERT_EQ(snapshot.buckets.size(), 4u);
+    ASSERT_EQ(snapshot.Percentile(0.0), GossipHistogram::BucketLowerBound(
+            GossipHistogram::BucketIndex(100)));
+}
+
+TEST(TestGossipMetrics, CountersAndSnapshot) {
+    auto metrics = GossipMetrics::Instance();
+    GossipMetricsSnapshot old_snapshot;
+    metrics->GetSnapshot(old_snapshot);
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([metrics]() {
+            for (uint32_t j = 0; j < 1000; ++j) {
+                metrics->AddOutcome(1, 600, kGossipTraceForwarded, 3);
+                metrics->AddOutcome(1, 600, kGossipTraceDuplicate, 0);
+            }
+        }));
+    }
+    for (auto iter = threads.begin(); iter != threads.end(); ++iter) {
+        iter->join();
+    }
+    // out of range types fall into the catch all slots
+    metrics->AddOutcome(100, 5000, kGossipTraceStopped, 0);
+    metrics->AddSendFailed();
+    metrics->AddSyncAsk(5);
+    metrics->AddSyncFetched();
+    metrics->AddSyncTimeout(2);
+    std::vector<uint64_t> bloomfilter(4, 0);
+    bloomfilter[0] = ~0ull;
+    metrics->AddBloomfilterFill(bloomfilter);
+
+    GossipMetricsSnapshot snapshot;
+    metrics->GetSnapshot(snapshot);
+    auto old_type = old_snapshot.type_outcomes[1];
+    old_type.resize(kGossipMetricOutcomeCount, 0);
+    ASSERT_EQ(snapshot.type_outcomes[1][kGossipTraceForwarded] - old_type[kGossipTraceForwarded], 4000u);
+    ASSERT_EQ(snapshot.type_outcomes[1][kGossipTraceDuplicate] - old_type[kGossipTraceDuplicate], 4000u);
+    ASSERT_GE(snapshot.type_outcomes[0][kGossipTraceStopped], 1u);
+    // the threads add to different stripes, the snapshot sums them
+    auto old_message_type = old_snapshot.message_type_outcomes[600];
+    old_message_type.resize(kGossipMetricOutcomeCount, 0);
+    ASSERT_EQ(
+            snapshot.message_type_outcomes[600][kGossipTraceForwarded] -
+                    old_message_type[kGossipTraceForwarded],
+            4000u);
+    ASSERT_GE(snapshot.message_type_outcomes[0][kGossipTraceStopped], 1u);
+    ASSERT_EQ(snapshot.fanout.count - old_snapshot.fanout.count, 4000u);
+    ASSERT_EQ(snapshot.fanout.Percentile(0.5), 3u);
+    ASSERT_EQ(snapshot.send_failed - old_snapshot.send_failed, 1u);
+    ASSERT_EQ(snapshot.sync_ask - old_snapshot.sync_ask, 5u);
+    ASSERT_EQ(snapshot.sync_fetched - old_snapshot.sync_fetched, 1u);
+    ASSERT_EQ(snapshot.sync_timeout - old_snapshot.sync_timeout, 2u);
+    ASSERT_EQ(snapshot.bloomfilter_fill.max, 250u);
+
+    std::string text = snapshot.ToString();
+    ASSERT_NE(text.find("xgossip_messages{gossip_type=\"1\",outcome=\"forwarded\"}"), std::string::npos);
+    ASSERT_NE(text.find("xgossip_sync_ask "), std::string::npos);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
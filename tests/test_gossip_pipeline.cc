@@ -0,0 +1,60 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "xgossip/include/gossip_pipeline.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestGossipPipeline, StageTimer) {
+    auto stat = GossipStageStat::Instance();
+    GossipHistogramSnapshot snapshot;
+    stat->GetSnapshot(3, kGossipStageSelect, snapshot);
+    uint64_t old_count = snapshot.count;
+    {
+        // off by default, nothing recorded
+        GossipStageTimer stage(3, kGossipStageStopCheck);
+        stage.Enter(kGossipStageSelect);
+    }
+    stat->GetSnapshot(3, kGossipStageSelect, snapshot);
+    ASSERT_EQ(snapshot.count, old_count);
+
+    stat->SetEnabled(true);
+    ASSERT_GT(stat->cycles_per_us(), 0.0);
+    {
+        GossipStageTimer stage(3, kGossipStageStopCheck);
+        stage.Enter(kGossipStageSelect);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        // entered twice, one sample of both parts
+        stage.Enter(kGossipStageEncode);
+        stage.Enter(kGossipStageSelect);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        stage.Stop();
+        stage.Enter(kGossipStageTransmit);
+    }
+    stat->SetEnabled(false);
+
+    stat->GetSnapshot(3, kGossipStageSelect, snapshot);
+    ASSERT_EQ(snapshot.count, old_count + 1);
+    ASSERT_GE(snapshot.max / stat->cycles_per_us(), 3500.0);
+    stat->GetSnapshot(3, kGossipStageStopCheck, snapshot);
+    ASSERT_GE(snapshot.count, 1u);
+    stat->GetSnapshot(3, kGossipStageTransmit, snapshot);
+    ASSERT_EQ(snapshot.count, 0u);
+    ASSERT_NE(stat->ToString().find("stage:select"), std::string::npos);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
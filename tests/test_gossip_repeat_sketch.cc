@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "xgossip/include/gossip_repeat_sketch.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestGossipRepeatSketch, DistributionAndTop) {
+    GossipRepeatSketch sketch(4096, 4, 2);
+    // message i received i % 5 + 1 times, message 7 received 100 times
+    uint64_t receive_count = 0;
+    for (uint32_t i = 1000; i < 2000; ++i) {
+        for (uint32_t j = 0; j <= i % 5; ++j) {
+            sketch.Add(i);
+            ++receive_count;
+        }
+    }
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([&sketch]() {
+            for (uint32_t j = 0; j < 25; ++j) {
+                sketch.Add(7u);
+            }
+        }));
+    }
+    for (auto iter = threads.begin(); iter != threads.end(); ++iter) {
+        iter->join();
+    }
+    receive_count += 100;
+
+    GossipRepeatStat stat;
+    sketch.GetStat(stat);
+    ASSERT_EQ(stat.receive_count, receive_count);
+    ASSERT_EQ(stat.message_count, 1001u);
+    for (uint32_t i = 1; i <= 5; ++i) {
+        ASSERT_EQ(stat.repeat_distribution[i], 200u);
+    }
+    ASSERT_EQ(stat.repeat_distribution[kRepeatBuckets - 1], 1u);
+    ASSERT_EQ(stat.max_repeat, 100u);
+    ASSERT_EQ(stat.top_messages.front().first, 7u);
+    ASSERT_EQ(stat.top_messages.front().second, 100u);
+    ASSERT_EQ(stat.top_messages.size(), kRepeatTopCount);
+    ASSERT_EQ(stat.top_messages.back().second, 5u);
+}
+
+TEST(TestGossipRepeatSketch, SlidingWindows) {
+    GossipRepeatSketch sketch(1024, 4, 2);
+    sketch.Add(1u);
+    sketch.Add(1u);
+    sketch.Rotate();
+    sketch.Add(1u);
+    GossipRepeatStat stat;
+    sketch.GetStat(stat);
+    ASSERT_EQ(stat.receive_count, 3u);
+    ASSERT_EQ(stat.top_messages.size(), 1u);
+    ASSERT_EQ(stat.top_messages.front().second, 2u);
+
+    // the first window leaves after two more rotations
+    sketch.Rotate();
+    sketch.GetStat(stat);
+    ASSERT_EQ(stat.receive_count, 1u);
+    sketch.Rotate();
+    sketch.GetStat(stat);
+    ASSERT_EQ(stat.receive_count, 0u);
+    ASSERT_EQ(stat.message_count, 0u);
+    ASSERT_EQ(sketch.Add(1u), 1u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include "xgossip/include/gossip_utils.h"
+
+#define private public
+#include "xgossip/sim/gossip_simulator.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static sim::SimConfig CreateSimConfig(uint32_t gossip_type) {
+    sim::SimConfig config;
+    config.node_count = 100;
+    config.gossip_type = gossip_type;
+    config.broadcast_count = 3;
+    config.neighbor_count = 3;
+    config.payload_size = 256;
+    config.switch_layer_hop_num = kGossipSwitchLayerCount;
+    config.ign_bloomfilter_level = kGossipBloomfilterIgnoreLevel;
+    config.stop_times = kGossipSendoutMaxTimes;
+    config.latency_us = 50 * 1000;
+    config.jitter_us = 20 * 1000;
+    config.bandwidth_kbps = 0;
+    config.loss_rate = 0.0;
+    config.churn_rate = 0.0;
+    config.filter_duplicates = true;
+    config.seed = 1;
+    return config;
+}
+
+static void RunSim(const sim::SimConfig& config, sim::SimResult& result) {
+    sim::GossipSimulator simulator(config);
+    ASSERT_TRUE(simulator.Init());
+    simulator.Run(result);
+}
+
+TEST(TestGossipSimulator, EveryTypeCoversLosslessNetwork) {
+    const uint32_t gossip_types[] = {
+            kGossipBloomfilter,
+            kGossipLayeredBroadcast,
+            kGossipBloomfilterAndLayered,
+            kGossipSetFilterAndLayered };
+    for (uint32_t i = 0; i < sizeof(gossip_types) / sizeof(gossip_types[0]); ++i) {
+        sim::SimResult result;
+        RunSim(CreateSimConfig(gossip_types[i]), result);
+        ASSERT_EQ(result.broadcast_count, 3u);
+        ASSERT_GT(result.mean_coverage, 0.9) << "gossip type " << gossip_types[i];
+        ASSERT_GE(result.amplification, result.mean_coverage);
+        ASSERT_GT(result.sent_packets, 0u);
+        ASSERT_EQ(result.lost_packets, 0u);
+    }
+}
+
+// a run leaves stop times in the MessageWithBloomfilter singleton, the
+// next simulator in the process must not find them
+TEST(TestGossipSimulator, RunsInOneProcessIndependent) {
+    auto config = CreateSimConfig(kGossipBloomfilter);
+    sim::GossipSimulator first_simulator(config);
+    sim::GossipSimulator again_simulator(config);
+    ASSERT_NE(first_simulator.NodeMessageHash(1, 0), again_simulator.NodeMessageHash(1, 0));
+
+    sim::SimResult first;
+    RunSim(config, first);
+    sim::SimResult other;
+    RunSim(CreateSimConfig(kGossipBloomfilterAndLayered), other);
+    sim::SimResult again;
+    RunSim(config, again);
+    // node ids are random, the packet count only varies a little
+    ASSERT_GT(again.sent_packets, first.sent_packets * 9 / 10);
+    ASSERT_LT(again.sent_packets, first.sent_packets * 11 / 10);
+    ASSERT_GT(again.mean_coverage, 0.9);
+}
+
+TEST(TestGossipSimulator, LossAndChurnCounted) {
+    auto config = CreateSimConfig(kGossipLayeredBroadcast);
+    config.loss_rate = 0.05;
+    config.churn_rate = 0.1;
+    sim::SimResult result;
+    RunSim(config, result);
+    ASSERT_GT(result.lost_packets, 0u);
+    ASSERT_LE(result.min_coverage, result.mean_coverage);
+    ASSERT_LE(result.mean_coverage, 1.0);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "xgossip/include/gossip_trace.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestGossipTrace, SampleAndQuery) {
+    auto trace = GossipTrace::Instance();
+    std::vector<GossipTraceEvent> events;
+    trace->SetSampleRate(0);
+    trace->Drain(events);
+    events.clear();
+
+    transport::protobuf::RoutingMessage message;
+    message.set_hop_num(3);
+    message.mutable_gossip()->set_msg_hash(1234u);
+    message.mutable_gossip()->set_gossip_type(1);
+    {
+        GossipTraceScope scope(message);
+        scope.set_outcome(kGossipTraceStopped);
+    }
+    trace->Drain(events);
+    ASSERT_TRUE(events.empty());
+
+    trace->SetSampleRate(1);
+    {
+        GossipTraceScope scope(message);
+        scope.set_filtered(2);
+        scope.StartSend();
+        scope.StopSend(3);
+    }
+    // recorded from another thread, its ring outlives it
+    std::thread thread([&message]() {
+        GossipTraceScope scope(message);
+        scope.set_outcome(kGossipTraceDuplicate);
+    });
+    thread.join();
+
+    trace->Query(1234u, events);
+    ASSERT_EQ(events.size(), 2u);
+    ASSERT_EQ(events[0].hop_num, 3u);
+    ASSERT_EQ(events[0].gossip_type, 1u);
+    ASSERT_EQ(events[0].filtered, 2u);
+    ASSERT_EQ(events[0].fanout, 3u);
+    ASSERT_EQ(events[0].outcome, kGossipTraceForwarded);
+    ASSERT_EQ(events[1].outcome, kGossipTraceDuplicate);
+    events.clear();
+    trace->Query(4321u, events);
+    ASSERT_TRUE(events.empty());
+
+    // 1 in 16 sampled, the same messages on every node
+    trace->SetSampleRate(16);
+    uint32_t sampled_count = 0;
+    for (uint32_t msg_hash = 0; msg_hash < 16000u; ++msg_hash) {
+        if (trace->Sampled(msg_hash)) {
+            ++sampled_count;
+        }
+    }
+    ASSERT_EQ(sampled_count, 1000u);
+    trace->SetSampleRate(0);
+    trace->Drain(events);
+}
+
+TEST(TestGossipTrace, FullRingDrops) {
+    auto trace = GossipTrace::Instance();
+    std::vector<GossipTraceEvent> events;
+    trace->Drain(events);
+    events.clear();
+    uint64_t record_count = 0;
+    uint64_t drop_count = 0;
+    trace->GetStat(record_count, drop_count);
+    uint64_t old_drop_count = drop_count;
+
+    GossipTraceEvent event = {};
+    for (uint64_t i = 0; i < GossipTraceRing::kCapacity + 10; ++i) {
+        trace->Record(event);
+    }
+    trace->GetStat(record_count, drop_count);
+    ASSERT_EQ(drop_count - old_drop_count, 10u);
+    trace->Drain(events);
+    ASSERT_EQ(events.size(), GossipTraceRing::kCapacity);
+    // room again after the drain
+    trace->Record(event);
+    events.clear();
+    trace->Drain(events);
+    ASSERT_EQ(events.size(), 1u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
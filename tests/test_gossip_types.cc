@@ -0,0 +1,281 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#define private public
+#include "xpbase/base/uint64_bloomfilter.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_registry.h"
+#include "xgossip/include/gossip_utils.h"
+#include "xgossip/include/neighbor_liveness.h"
+#include "xgossip/tests/test_gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+// every registered gossip type over a routing table that is never started,
+// what each one sends and what it carries on in the message
+
+// a new msg_hash every time, the stop times of one are counted process wide
+static void CreateTypeMessage(
+        uint32_t gossip_type,
+        uint32_t hop_num,
+        transport::protobuf::RoutingMessage& message) {
+    static std::atomic<uint32_t> next_msg_hash{ 0x71000u };
+    uint32_t msg_hash = next_msg_hash.fetch_add(1);
+    message.set_id(msg_hash);
+    message.set_type(kTestChainTrade);
+    message.set_hop_num(hop_num);
+    auto gossip_param = message.mutable_gossip();
+    gossip_param->set_neighber_count(3);
+    gossip_param->set_stop_times(kGossipSendoutMaxTimes);
+    gossip_param->set_gossip_type(gossip_type);
+    gossip_param->set_max_hop_num(10);
+    gossip_param->set_evil_rate(0);
+    gossip_param->set_switch_layer_hop_num(kGossipSwitchLayerCount);
+    gossip_param->set_ign_bloomfilter_level(0);
+    gossip_param->set_msg_hash(msg_hash);
+    gossip_param->set_min_dis(0);
+    gossip_param->set_max_dis(0);
+    gossip_param->set_left_min(0);
+    gossip_param->set_right_max(std::numeric_limits<uint64_t>::max());
+}
+
+static std::shared_ptr<base::Uint64BloomFilter> MessageBloomfilter(
+        const transport::protobuf::RoutingMessage& message) {
+    std::vector<uint64_t> bloomfilter_vec;
+    for (int i = 0; i < message.bloomfilter_size(); ++i) {
+        bloomfilter_vec.push_back(message.bloomfilter(i));
+    }
+    if (bloomfilter_vec.empty()) {
+        return nullptr;
+    }
+    return std::make_shared<base::Uint64BloomFilter>(bloomfilter_vec, kGossipBloomfilterHashNum);
+}
+
+static std::map<uint16_t, kadmlia::NodeInfoPtr> NodesByPort(
+        const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+    std::map<uint16_t, kadmlia::NodeInfoPtr> port_map;
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        port_map[(*iter)->public_port] = *iter;
+    }
+    return port_map;
+}
+
+TEST(TestGossipTypes, Bloomfilter) {
+    auto transport = std::make_shared<TestTransport>();
+    GossipRegistry registry(transport);
+    auto nodes = CreateTestNodes(30, 12000);
+    auto port_map = NodesByPort(nodes);
+    GossipContext context;
+    context.local_hash64 = 0x1234567;
+    context.neighbors = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>(nodes);
+
+    // a relay, the first 10 neighbors already have it
+    transport::protobuf::RoutingMessage message;
+    CreateTypeMessage(kGossipBloomfilter, 1, message);
+    base::Uint64BloomFilter bloomfilter(kGossipBloomfilterSize, kGossipBloomfilterHashNum);
+    for (uint32_t i = 0; i < 10; ++i) {
+        bloomfilter.Add(nodes[i]->hash64);
+    }
+    for (auto value : bloomfilter.Uint64Vector()) {
+        message.add_bloomfilter(value);
+    }
+    ASSERT_TRUE(registry.Broadcast(context, message));
+
+    auto& sent = transport->sent();
+    ASSERT_EQ(sent.size(), 3u);
+    std::set<uint16_t> sent_ports;
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        ASSERT_GE(iter->port, 12010u);
+        ASSERT_TRUE(port_map.count(iter->port) == 1);
+        sent_ports.insert(iter->port);
+    }
+    ASSERT_EQ(sent_ports.size(), 3u);
+
+    // past ign_bloomfilter_level the bloomfilter out has this node, the
+    // nodes it had and the nodes sent to
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        auto sent_bloomfilter = MessageBloomfilter(iter->message);
+        ASSERT_TRUE(sent_bloomfilter != nullptr);
+        ASSERT_TRUE(sent_bloomfilter->Contain(context.local_hash64));
+        for (uint32_t i = 0; i < 10; ++i) {
+            ASSERT_TRUE(sent_bloomfilter->Contain(nodes[i]->hash64));
+        }
+        for (auto port : sent_ports) {
+            ASSERT_TRUE(sent_bloomfilter->Contain(port_map[port]->hash64));
+        }
+        ASSERT_EQ(iter->message.gossip().pass_node_size(), 0);
+    }
+}
+
+TEST(TestGossipTypes, BloomfilterLayer) {
+    auto transport = std::make_shared<TestTransport>();
+    GossipRegistry registry(transport);
+    auto local_node = CreateTestLocalNode(9000);
+    auto nodes = CreateTestNodes(30, 13000);
+    auto port_map = NodesByPort(nodes);
+    GossipContext context;
+    context.local_hash64 = local_node->hash64();
+    context.routing_table = CreateTestRoutingTable(transport, local_node, nodes);
+
+    // before switch_layer_hop_num: random nodes of the range, one message
+    transport::protobuf::RoutingMessage message;
+    CreateTypeMessage(kGossipBloomfilterAndLayered, 0, message);
+    ASSERT_TRUE(registry.Broadcast(context, message));
+    auto& sent = transport->sent();
+    ASSERT_EQ(sent.size(), 3u);
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        ASSERT_TRUE(port_map.count(iter->port) == 1);
+        auto sent_bloomfilter = MessageBloomfilter(iter->message);
+        ASSERT_TRUE(sent_bloomfilter != nullptr);
+        ASSERT_TRUE(sent_bloomfilter->Contain(context.local_hash64));
+        for (auto sent_iter = sent.begin(); sent_iter != sent.end(); ++sent_iter) {
+            ASSERT_TRUE(sent_bloomfilter->Contain(port_map[sent_iter->port]->hash64));
+        }
+        ASSERT_EQ(iter->message.gossip().min_dis(), 0u);
+        ASSERT_EQ(iter->message.gossip().max_dis(), 0u);
+    }
+
+    // past it: every node gets the part of the range up to its own hash
+    sent.clear();
+    transport::protobuf::RoutingMessage layer_message;
+    CreateTypeMessage(kGossipBloomfilterAndLayered, kGossipSwitchLayerCount, layer_message);
+    ASSERT_TRUE(registry.Broadcast(context, layer_message));
+    ASSERT_EQ(sent.size(), 3u);
+    uint64_t last_max_dis = 0;
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        auto& gossip = iter->message.gossip();
+        uint64_t hash64 = port_map[iter->port]->hash64;
+        uint64_t max_dis = gossip.max_dis() > 0 ? gossip.max_dis() : std::numeric_limits<uint64_t>::max();
+        ASSERT_EQ(gossip.min_dis(), last_max_dis);
+        ASSERT_GT(hash64, gossip.min_dis());
+        ASSERT_LE(hash64, max_dis);
+        last_max_dis = gossip.max_dis();
+    }
+    ASSERT_EQ(last_max_dis, std::numeric_limits<uint64_t>::max());
+}
+
+TEST(TestGossipTypes, SetLayer) {
+    auto transport = std::make_shared<TestTransport>();
+    GossipRegistry registry(transport);
+    auto nodes = CreateTestNodes(30, 14000);
+    auto port_map = NodesByPort(nodes);
+    GossipContext context;
+    context.local_hash64 = 0x7654321;
+    context.neighbors = std::make_shared<std::vector<kadmlia::NodeInfoPtr>>(nodes);
+
+    // the first 10 neighbors already passed
+    transport::protobuf::RoutingMessage message;
+    CreateTypeMessage(kGossipSetFilterAndLayered, 1, message);
+    std::set<uint32_t> passed_set;
+    for (uint32_t i = 0; i < 10; ++i) {
+        message.mutable_gossip()->add_pass_node(static_cast<uint32_t>(nodes[i]->hash64));
+        passed_set.insert(static_cast<uint32_t>(nodes[i]->hash64));
+    }
+    ASSERT_TRUE(registry.Broadcast(context, message));
+
+    auto& sent = transport->sent();
+    ASSERT_EQ(sent.size(), 3u);
+    std::set<uint32_t> expect_set(passed_set);
+    expect_set.insert(static_cast<uint32_t>(context.local_hash64));
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        ASSERT_TRUE(port_map.count(iter->port) == 1);
+        uint32_t hash = static_cast<uint32_t>(port_map[iter->port]->hash64);
+        ASSERT_TRUE(passed_set.find(hash) == passed_set.end());
+        expect_set.insert(hash);
+    }
+
+    // no bloomfilter, the pass set out is the one in, this node and the
+    // nodes sent to, each once
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        auto& gossip = iter->message.gossip();
+        ASSERT_EQ(iter->message.bloomfilter_size(), 0);
+        std::set<uint32_t> pass_set;
+        for (int i = 0; i < gossip.pass_node_size(); ++i) {
+            pass_set.insert(gossip.pass_node(i));
+        }
+        ASSERT_EQ(static_cast<uint32_t>(gossip.pass_node_size()), pass_set.size());
+        ASSERT_EQ(pass_set, expect_set);
+    }
+}
+
+TEST(TestGossipTypes, Layered) {
+    auto transport = std::make_shared<TestTransport>();
+    auto local_node = CreateTestLocalNode(9000);
+    auto nodes = CreateTestNodes(30, 15000);
+    kadmlia::RoutingTablePtr routing_table = CreateTestRoutingTable(transport, local_node, nodes);
+    // the engine the registry runs for the type, kept to see its plan
+    auto broadcast = std::make_shared<BroadcastLayered>(transport);
+    GossipRegistry registry(transport);
+    registry.Register(kGossipLayeredBroadcast, broadcast);
+    GossipContext context;
+    context.local_hash64 = local_node->hash64();
+    context.routing_table = routing_table;
+
+    transport::protobuf::RoutingMessage message;
+    CreateTypeMessage(kGossipLayeredBroadcast, 0, message);
+    ASSERT_TRUE(registry.Broadcast(context, message));
+    auto plan = broadcast->GetBroadcastPlan(message, routing_table);
+    ASSERT_TRUE(plan != nullptr);
+    ASSERT_FALSE(plan->nodes.empty());
+
+    // the children of the plan, the message as it came
+    auto& sent = transport->sent();
+    std::vector<uint16_t> sent_ports;
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        sent_ports.push_back(iter->port);
+        ASSERT_EQ(iter->message.bloomfilter_size(), 0);
+        ASSERT_EQ(iter->message.gossip().pass_node_size(), 0);
+    }
+    std::vector<uint16_t> plan_ports;
+    for (auto iter = plan->nodes.begin(); iter != plan->nodes.end(); ++iter) {
+        plan_ports.push_back((*iter)->public_port);
+    }
+    ASSERT_EQ(sent_ports, plan_ports);
+
+    // a suspect child, its children are sent to as well
+    uint32_t bypass_index = 0;
+    while (bypass_index < plan->nodes.size() && plan->bypass_nodes[bypass_index].empty()) {
+        ++bypass_index;
+    }
+    ASSERT_LT(bypass_index, plan->nodes.size());
+    auto suspect = plan->nodes[bypass_index];
+    auto liveness = NeighborLiveness::Instance();
+    liveness->AddScore(suspect->public_ip, suspect->public_port, 2.0, std::chrono::steady_clock::now());
+    ASSERT_TRUE(liveness->IsSuspect(suspect->public_ip, suspect->public_port));
+    sent.clear();
+    transport::protobuf::RoutingMessage suspect_message(message);
+    ASSERT_TRUE(registry.Broadcast(context, suspect_message));
+    for (auto iter = plan->bypass_nodes[bypass_index].begin();
+            iter != plan->bypass_nodes[bypass_index].end(); ++iter) {
+        plan_ports.push_back((*iter)->public_port);
+    }
+    sent_ports.clear();
+    for (auto iter = sent.begin(); iter != sent.end(); ++iter) {
+        sent_ports.push_back(iter->port);
+    }
+    ASSERT_EQ(sent_ports, plan_ports);
+
+    liveness->OnAck(suspect->public_ip, suspect->public_port);
+    ASSERT_FALSE(liveness->HasSuspect());
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
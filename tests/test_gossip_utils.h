@@ -0,0 +1,132 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xbase/xhash.h"
+#include "xbase/xpacket.h"
+#include "xpbase/base/top_utils.h"
+#include "xpbase/base/check_cast.h"
+#include "xpbase/base/kad_key/platform_kadmlia_key.h"
+#include "xtransport/udp_transport/udp_transport.h"
+#include "xtransport/proto/transport.pb.h"
+#include "xkad/routing_table/local_node_info.h"
+#include "xkad/routing_table/node_info.h"
+#include "xkad/routing_table/routing_table.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/broadcast_layered.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+// routing tables of members that are never started, for the broadcast
+// tests that only look at which nodes a relay picks
+
+// UdpTransport that is never started, keeps every message it sends with
+// the port it went to
+class TestTransport : public transport::UdpTransport {
+public:
+    struct SentMessage {
+        uint16_t port;
+        transport::protobuf::RoutingMessage message;
+    };
+
+    TestTransport() {}
+    virtual ~TestTransport() {}
+    virtual int SendData(base::xpacket_t& packet) override {
+        auto& body = packet.get_body();
+        if (body.size() < sizeof(_xip2_header)) {
+            return kadmlia::kKadFailed;
+        }
+        SentMessage sent;
+        sent.port = packet.get_to_ip_port();
+        if (!sent.message.ParseFromArray(
+                (const char*)body.data() + sizeof(_xip2_header),
+                body.size() - sizeof(_xip2_header))) {
+            return kadmlia::kKadFailed;
+        }
+        sent_.push_back(sent);
+        return kadmlia::kKadSuccess;
+    }
+    std::vector<SentMessage>& sent() { return sent_; }
+
+private:
+    std::vector<SentMessage> sent_;
+
+    DISALLOW_COPY_AND_ASSIGN(TestTransport);
+};
+
+inline kadmlia::LocalNodeInfoPtr CreateTestLocalNode(uint16_t port) {
+    std::string idtype(kadmlia::GenNodeIdType("CN", "VPN"));
+    kadmlia::LocalNodeInfoPtr local_node_info;
+    local_node_info.reset(new kadmlia::LocalNodeInfo());
+    auto kad_key = std::make_shared<base::PlatformKadmliaKey>();
+    kad_key->set_xnetwork_id(kEdgeXVPN);
+    kad_key->set_zone_id(check_cast<uint8_t>(26));
+    local_node_info->Init(
+        "127.0.0.1", port, false, false, idtype, kad_key, kad_key->xnetwork_id(), kRoleEdge);
+    local_node_info->set_public_ip("127.0.0.1");
+    local_node_info->set_public_port(port);
+    return local_node_info;
+}
+
+inline kadmlia::NodeInfoPtr CreateTestNode(const std::string& id, uint16_t port) {
+    auto node_ptr = std::make_shared<kadmlia::NodeInfo>(id);
+    node_ptr->xid = id;
+    node_ptr->local_ip = "127.0.0.1";
+    node_ptr->local_port = port;
+    node_ptr->public_ip = "127.0.0.1";
+    node_ptr->public_port = port;
+    node_ptr->hash64 = base::xhash64_t::digest(id);
+    return node_ptr;
+}
+
+// node_count members with random ids on ports from base_port
+inline std::vector<kadmlia::NodeInfoPtr> CreateTestNodes(uint32_t node_count, uint16_t base_port) {
+    std::vector<kadmlia::NodeInfoPtr> nodes;
+    for (uint32_t i = 0; i < node_count; ++i) {
+        nodes.push_back(CreateTestNode(RandomString(kadmlia::kNodeIdSize), base_port + i));
+    }
+    return nodes;
+}
+
+// the local node as other members see it
+inline kadmlia::NodeInfoPtr CreateTestNode(kadmlia::LocalNodeInfoPtr local_node_info) {
+    auto node_ptr = CreateTestNode(local_node_info->id(), local_node_info->public_port());
+    node_ptr->hash64 = local_node_info->hash64();
+    return node_ptr;
+}
+
+inline kadmlia::RoutingTablePtr CreateTestRoutingTable(
+        transport::TransportPtr transport,
+        kadmlia::LocalNodeInfoPtr local_node_info,
+        const std::vector<kadmlia::NodeInfoPtr>& nodes) {
+    if (!transport) {
+        transport = std::make_shared<transport::UdpTransport>();
+    }
+    kadmlia::RoutingTablePtr routing_table_ptr;
+    routing_table_ptr.reset(new kadmlia::RoutingTable(
+            transport, kadmlia::kNodeIdSize, local_node_info));
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        routing_table_ptr->AddNode(*iter);
+    }
+    BroadcastLayered::OnMembershipChanged();
+    return routing_table_ptr;
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include "xgossip/include/layered_tree_index.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+// the pow() based level walk BroadcastLayered used before LayeredChildrenRange,
+// kept here as the reference the integer math must match
+static uint32_t RefFindHopNum(uint32_t self_sort_index, uint32_t neighber_count) {
+    uint32_t K = neighber_count;
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    uint32_t hop_num = 0;
+    for (uint32_t i = 0; ; ++i) {
+        sum1 += pow(K, i);
+        if (i == 0) {
+            sum1 = 0;
+        }
+        sum2 = sum1 + pow(K, i+1);
+        if (self_sort_index > sum1 && self_sort_index <= sum2) {
+            hop_num = i + 1;
+            break;
+        }
+    }
+    return hop_num;
+}
+
+static std::vector<uint32_t> RefChooseNodes(
+        int hop_num,
+        uint32_t self_sort_index,
+        uint32_t neighber_count,
+        const std::vector<uint32_t>& sort_nodes_index_vec) {
+    uint32_t sum1 = 0;
+    uint32_t K = neighber_count;
+    for (int i = 1; i < hop_num; ++i) {
+        sum1 += pow(K, i);
+    }
+    uint32_t sum2 = sum1 + pow(K, hop_num);
+    if (self_sort_index <= sum1 || self_sort_index > sum2) {
+        return {};
+    }
+
+    uint32_t front_level_size = self_sort_index - sum1 - 1;
+    uint32_t begin  =  sum2 + front_level_size * K + 1;
+    uint32_t end = begin + K;
+    std::vector<uint32_t> result;
+    for ( uint32_t i = begin; i < end; ++i) {
+        if (i > sort_nodes_index_vec.size()) {
+            break;
+        }
+        result.push_back(sort_nodes_index_vec[i-1]);
+    }
+    return result;
+}
+
+static std::vector<uint32_t> RefChooseNextNodes(
+        uint32_t count,
+        uint32_t self_node_index,
+        uint32_t neighber_count) {
+    if (self_node_index > count) {
+        return {};
+    }
+    std::vector<uint32_t> sort_nodes_index_vec;
+    for (uint32_t i = 0; i < count; ++i) {
+        sort_nodes_index_vec.push_back(i+1);
+    }
+    uint32_t hop_num = RefFindHopNum(self_node_index, neighber_count);
+    return RefChooseNodes(hop_num, self_node_index, neighber_count, sort_nodes_index_vec);
+}
+
+static_assert(LayeredLevel(0, 3) == 0, "root level");
+static_assert(LayeredLevel(3, 3) == 1, "first level ends at K");
+static_assert(LayeredLevel(4, 3) == 2, "second level starts at K + 1");
+static_assert(LayeredLevel(12, 3) == 2, "second level ends at K + K^2");
+static_assert(LayeredParentIndex(13, 3) == 4, "parent of 13");
+static_assert(LayeredChildrenRange(0, 3, 64).begin == 1, "root children");
+static_assert(LayeredChildrenRange(4, 3, 64).begin == 13, "children of 4");
+static_assert(LayeredChildrenRange(4, 3, 64).end == 15, "children of 4");
+static_assert(LayeredChildrenRange(21, 3, 64).size() == 1, "clamped to count");
+static_assert(LayeredChildrenRange(22, 3, 64).empty(), "leaf");
+
+TEST(TestLayeredTreeIndex, MatchChooseNextNodes) {
+    for (uint32_t k = 1; k <= 10; ++k) {
+        for (uint32_t count = 1; count <= 400; ++count) {
+            for (uint32_t index = 1; index <= count + 1; ++index) {
+                auto expect = RefChooseNextNodes(count, index, k);
+                auto range = LayeredChildrenRange(index, k, count);
+                ASSERT_EQ(expect.size(), range.size())
+                        << "k:" << k << " count:" << count << " index:" << index;
+                if (expect.empty()) {
+                    continue;
+                }
+                ASSERT_EQ(expect.front(), range.begin);
+                ASSERT_EQ(expect.back(), range.end);
+            }
+        }
+    }
+}
+
+TEST(TestLayeredTreeIndex, MatchFindHopNum) {
+    for (uint32_t k = 1; k <= 16; ++k) {
+        for (uint32_t index = 1; index <= 5000; ++index) {
+            ASSERT_EQ(RefFindHopNum(index, k), LayeredLevel(index, k))
+                    << "k:" << k << " index:" << index;
+        }
+    }
+}
+
+TEST(TestLayeredTreeIndex, ParentOfChildren) {
+    for (uint32_t k = 1; k <= 16; ++k) {
+        for (uint32_t index = 0; index <= 5000; ++index) {
+            auto range = LayeredChildrenRange(index, k, 5000);
+            for (uint32_t child = range.begin; child <= range.end && !range.empty(); ++child) {
+                ASSERT_EQ(LayeredParentIndex(child, k), index);
+                ASSERT_EQ(LayeredLevel(child, k), LayeredLevel(index, k) + 1);
+            }
+        }
+    }
+}
+
+TEST(TestLayeredTreeIndex, LargeCount) {
+    // K * index + K would overflow uint32_t, must stay empty instead of wrapping
+    const uint32_t count = 0xffffffffu;
+    auto range = LayeredChildrenRange(count - 1, 8, count);
+    ASSERT_TRUE(range.empty());
+    range = LayeredChildrenRange(count / 8 - 1, 8, count);
+    ASSERT_EQ(range.size(), 8u);
+    ASSERT_EQ(LayeredLevel(count, 2), 32u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
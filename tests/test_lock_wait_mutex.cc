@@ -0,0 +1,55 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "xgossip/include/lock_wait_mutex.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestLockWaitMutex, CountsOnlyBlockedLocks) {
+    LockWaitMutex mutex;
+    {
+        std::unique_lock<LockWaitMutex> lock(mutex);
+    }
+    LockWaitStat stat;
+    mutex.GetStat(stat);
+    ASSERT_EQ(stat.wait_count, 0u);
+
+    std::unique_lock<LockWaitMutex> lock(mutex);
+    std::thread waiter([&mutex]() {
+        std::unique_lock<LockWaitMutex> wait_lock(mutex);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock.unlock();
+    waiter.join();
+
+    // GetStat adds, the caller sums
+    mutex.GetStat(stat);
+    ASSERT_EQ(stat.wait_count, 1u);
+    ASSERT_GE(stat.wait_ns, 10u * 1000u * 1000u);
+    ASSERT_TRUE(mutex.try_lock());
+    // try_lock on the owning thread is undefined, ask from another one
+    bool other_locked = true;
+    std::thread other([&mutex, &other_locked]() {
+        other_locked = mutex.try_lock();
+    });
+    other.join();
+    ASSERT_FALSE(other_locked);
+    mutex.unlock();
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,103 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#define private public
+#include "xgossip/include/neighbor_liveness.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+class TestNeighborLiveness : public testing::Test {
+protected:
+    virtual void SetUp() override {
+        Reset();
+    }
+    virtual void TearDown() override {
+        Reset();
+    }
+    void Reset() {
+        auto liveness = NeighborLiveness::Instance();
+        liveness->liveness_map_.clear();
+        liveness->suspect_count_ = 0;
+        liveness->suspect_until_ = 0;
+        liveness->liveness_size_ = 0;
+    }
+
+    NeighborLiveness* liveness_{ NeighborLiveness::Instance() };
+};
+
+TEST_F(TestNeighborLiveness, SuspectAfterFailures) {
+    auto tp_now = std::chrono::steady_clock::now();
+    liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    ASSERT_FALSE(liveness_->HasSuspect(tp_now));
+    ASSERT_FALSE(liveness_->IsSuspect("10.0.0.1", 9000));
+
+    liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    ASSERT_TRUE(liveness_->HasSuspect(tp_now));
+    ASSERT_TRUE(liveness_->IsSuspect("10.0.0.1", 9000));
+    ASSERT_FALSE(liveness_->IsSuspect("10.0.0.1", 9001));
+    ASSERT_FALSE(liveness_->IsSuspect("10.0.0.2", 9000));
+}
+
+TEST_F(TestNeighborLiveness, SuspectDecaysWithoutLookup) {
+    auto tp_now = std::chrono::steady_clock::now();
+    // score 3 takes one half-life to fall below the threshold of 1.5,
+    // score 2 about 12 seconds
+    for (uint32_t i = 0; i < 3; ++i) {
+        liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    }
+    liveness_->AddScore("10.0.0.2", 9000, 2.0, tp_now);
+    ASSERT_TRUE(liveness_->HasSuspect(tp_now));
+    ASSERT_TRUE(liveness_->HasSuspect(tp_now + std::chrono::seconds(20)));
+    ASSERT_FALSE(liveness_->HasSuspect(tp_now + std::chrono::seconds(31)));
+    ASSERT_EQ(liveness_->suspect_count_, 0u);
+
+    // a new failure after the sweep counts again
+    auto tp_later = tp_now + std::chrono::seconds(40);
+    liveness_->AddScore("10.0.0.3", 9000, 2.0, tp_later);
+    ASSERT_TRUE(liveness_->HasSuspect(tp_later));
+    ASSERT_EQ(liveness_->suspect_count_, 1u);
+}
+
+TEST_F(TestNeighborLiveness, AckForgetsFailures) {
+    auto tp_now = std::chrono::steady_clock::now();
+    // one failure short of suspect, then an ack
+    liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    liveness_->OnAck("10.0.0.1", 9000);
+    liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    ASSERT_FALSE(liveness_->HasSuspect(tp_now));
+
+    liveness_->AddScore("10.0.0.1", 9000, 1.0, tp_now);
+    ASSERT_TRUE(liveness_->HasSuspect(tp_now));
+    liveness_->OnAck("10.0.0.1", 9000);
+    ASSERT_FALSE(liveness_->HasSuspect(tp_now));
+    ASSERT_FALSE(liveness_->IsSuspect("10.0.0.1", 9000));
+    ASSERT_EQ(liveness_->liveness_size_, 0u);
+}
+
+TEST_F(TestNeighborLiveness, FullMapKeepsSuspects) {
+    auto tp_now = std::chrono::steady_clock::now();
+    liveness_->AddScore("10.0.0.1", 9000, 2.0, tp_now);
+    for (uint32_t i = 1; i < NeighborLiveness::kMaxLivenessMapSize; ++i) {
+        liveness_->AddScore("10.0.1.1", static_cast<uint16_t>(i), 1.0, tp_now);
+    }
+    liveness_->AddScore("10.0.0.2", 9000, 1.0, tp_now);
+    ASSERT_EQ(liveness_->liveness_map_.size(), 2u);
+    ASSERT_TRUE(liveness_->IsSuspect("10.0.0.1", 9000));
+    ASSERT_TRUE(liveness_->HasSuspect(tp_now));
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
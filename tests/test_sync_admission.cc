@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xgossip/include/sync_admission.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestSyncAdmission, RequesterAndGlobalBudget) {
+    // 10 KB/s for the node, 4 KB/s for each requester, bursts of twice that
+    SyncAdmission admission(10000, 20000, 4000, 8000);
+    ASSERT_TRUE(admission.Admit("10.0.0.1", 9000, 8000));
+    ASSERT_FALSE(admission.Admit("10.0.0.1", 9000, 1000));
+    ASSERT_FALSE(admission.HasBudget("10.0.0.1", 9000));
+    // another requester still has its own burst
+    ASSERT_TRUE(admission.Admit("10.0.0.2", 9000, 8000));
+    // the node only has 4000 left
+    ASSERT_FALSE(admission.Admit("10.0.0.3", 9000, 5000));
+    ASSERT_TRUE(admission.Admit("10.0.0.3", 9000, 4000));
+    ASSERT_FALSE(admission.HasBudget("10.0.0.4", 9000));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    // about 3000 back for the node and 1200 for each requester
+    ASSERT_TRUE(admission.Admit("10.0.0.1", 9000, 1000));
+    ASSERT_FALSE(admission.Admit("10.0.0.1", 9000, 1000));
+
+    uint64_t admit_count = 0;
+    uint64_t refuse_count = 0;
+    uint32_t requester_count = 0;
+    admission.GetStat(admit_count, refuse_count, requester_count);
+    ASSERT_EQ(admit_count, 4u);
+    ASSERT_EQ(refuse_count, 3u);
+    ASSERT_EQ(requester_count, 4u);
+}
+
+TEST(TestSyncAdmission, Holders) {
+    SyncAdmission admission(10000, 20000, 4000, 8000);
+    for (uint16_t port = 1; port <= 10; ++port) {
+        admission.AddHolder("header", SyncHolder{ "10.0.0.1", port, "node" });
+    }
+    admission.AddHolder("header", SyncHolder{ "10.0.0.1", 5, "node" });
+
+    std::vector<SyncHolder> holders;
+    admission.GetHolders("header", "10.0.0.1", 10, 4, holders);
+    ASSERT_EQ(holders.size(), 4u);
+    // newest first, the asking node is left out
+    ASSERT_EQ(holders[0].port, 5);
+    ASSERT_EQ(holders[1].port, 9);
+    ASSERT_EQ(holders[2].port, 8);
+
+    holders.clear();
+    admission.GetHolders("header", "10.0.0.1", 10, 100, holders);
+    ASSERT_EQ(holders.size(), 7u);
+    holders.clear();
+    admission.GetHolders("other header", "10.0.0.1", 10, 4, holders);
+    ASSERT_TRUE(holders.empty());
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
@@ -0,0 +1,110 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "xgossip/include/sync_message_codec.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+TEST(TestSyncMessageCodec, RoundTrip) {
+    std::vector<std::string> entries;
+    entries.push_back("1234567890");
+    entries.push_back("");
+    entries.push_back(std::string("\0\1\2", 3));
+    entries.push_back(std::string(70000, 'x'));
+    std::string data;
+    EncodeSyncEnvelope(kSyncEnvelopeBatch, entries, data);
+    ASSERT_EQ(GetSyncEnvelopeKind(data), kSyncEnvelopeBatch);
+
+    std::vector<std::string> decoded;
+    ASSERT_TRUE(DecodeSyncEnvelope(data, kSyncEnvelopeBatch, decoded));
+    ASSERT_EQ(decoded, entries);
+}
+
+TEST(TestSyncMessageCodec, SingleHeaderIsNotEnvelope) {
+    ASSERT_EQ(GetSyncEnvelopeKind("2847561234"), kSyncEnvelopeInvalid);
+    ASSERT_EQ(GetSyncEnvelopeKind(""), kSyncEnvelopeInvalid);
+    ASSERT_EQ(GetSyncEnvelopeKind(std::string("\0SYZ", 4)), kSyncEnvelopeInvalid);
+}
+
+TEST(TestSyncMessageCodec, Truncated) {
+    std::vector<std::string> entries(3, "header_hash");
+    std::string data;
+    EncodeSyncEnvelope(kSyncEnvelopeBatch, entries, data);
+    for (uint32_t size = kSyncEnvelopeHeadSize + 1; size < data.size(); ++size) {
+        std::vector<std::string> decoded;
+        bool ok = DecodeSyncEnvelope(data.substr(0, size), kSyncEnvelopeBatch, decoded);
+        // only a cut right after an entry still decodes, to fewer entries
+        if (ok) {
+            ASSERT_LT(decoded.size(), entries.size());
+        }
+    }
+}
+
+TEST(TestSyncMessageCodec, ChunkMessages) {
+    SyncChunkManifest manifest{ "header", 40000, 16384, { 1ull, 0xffffffffffffffffull, 3ull } };
+    std::string data;
+    EncodeSyncManifest(manifest, data);
+    ASSERT_EQ(GetSyncEnvelopeKind(data), kSyncEnvelopeManifest);
+    SyncChunkManifest decoded_manifest;
+    ASSERT_TRUE(DecodeSyncManifest(data, decoded_manifest));
+    ASSERT_EQ(decoded_manifest.header_hash, manifest.header_hash);
+    ASSERT_EQ(decoded_manifest.total_size, manifest.total_size);
+    ASSERT_EQ(decoded_manifest.chunk_size, manifest.chunk_size);
+    ASSERT_EQ(decoded_manifest.chunk_hashes, manifest.chunk_hashes);
+    SyncChunk chunk;
+    ASSERT_FALSE(DecodeSyncChunk(data, chunk));
+
+    SyncChunkRequest request{ "header", { 0, 2, 70000 } };
+    EncodeSyncChunkRequest(request, data);
+    SyncChunkRequest decoded_request;
+    ASSERT_TRUE(DecodeSyncChunkRequest(data, decoded_request));
+    ASSERT_EQ(decoded_request.chunk_indexes, request.chunk_indexes);
+
+    chunk = SyncChunk{ "header", 2, std::string(7232, 'c') };
+    EncodeSyncChunk(chunk, data);
+    SyncChunk decoded_chunk;
+    ASSERT_TRUE(DecodeSyncChunk(data, decoded_chunk));
+    ASSERT_EQ(decoded_chunk.chunk_index, 2u);
+    ASSERT_EQ(decoded_chunk.data, chunk.data);
+}
+
+TEST(TestSyncMessageCodec, BusyMessages) {
+    std::vector<SyncRedirect> redirects{
+            SyncRedirect{ "header a", {} },
+            SyncRedirect{ "header b", {
+                    SyncHolder{ "10.0.0.1", 9000, "node 1" },
+                    SyncHolder{ "10.0.0.2", 65535, "" } } } };
+    std::string data;
+    EncodeSyncBusy(redirects, data);
+    ASSERT_EQ(GetSyncEnvelopeKind(data), kSyncEnvelopeBusy);
+    std::vector<SyncRedirect> decoded;
+    ASSERT_TRUE(DecodeSyncBusy(data, decoded));
+    ASSERT_EQ(decoded.size(), 2u);
+    ASSERT_EQ(decoded[0].header_hash, "header a");
+    ASSERT_TRUE(decoded[0].holders.empty());
+    ASSERT_EQ(decoded[1].holders.size(), 2u);
+    ASSERT_EQ(decoded[1].holders[0].ip, "10.0.0.1");
+    ASSERT_EQ(decoded[1].holders[0].node_id, "node 1");
+    ASSERT_EQ(decoded[1].holders[1].port, 65535);
+
+    // a holder count past the entries is rejected
+    std::vector<std::string> entries{ "header", std::string("\x05\0\0\0", 4), "ip" };
+    EncodeSyncEnvelope(kSyncEnvelopeBusy, entries, data);
+    ASSERT_FALSE(DecodeSyncBusy(data, decoded));
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
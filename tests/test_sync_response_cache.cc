@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "xgossip/include/sync_response_cache.h"
+
+namespace top {
+
+namespace gossip {
+
+namespace test {
+
+static std::shared_ptr<SyncResponseEntry> MakeEntry(uint32_t payload_size, uint32_t block_size) {
+    auto entry = std::make_shared<SyncResponseEntry>();
+    entry->payload.assign(payload_size, 'p');
+    auto block = std::make_shared<std::string>(block_size, 'b');
+    entry->block.buffer = block;
+    entry->block.data = block->data();
+    entry->block.size = block->size();
+    return entry;
+}
+
+TEST(TestSyncResponseCache, EvictLeastRecentlyUsed) {
+    SyncResponseCache cache(300);
+    cache.Put("a", MakeEntry(100, 0));
+    cache.Put("b", MakeEntry(50, 50));
+    cache.Put("c", MakeEntry(100, 0));
+    // touch a, so b is the oldest
+    ASSERT_NE(cache.Get("a"), nullptr);
+    cache.Put("d", MakeEntry(100, 0));
+    ASSERT_EQ(cache.Get("b"), nullptr);
+    ASSERT_NE(cache.Get("a"), nullptr);
+    ASSERT_NE(cache.Get("c"), nullptr);
+    ASSERT_NE(cache.Get("d"), nullptr);
+
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    uint64_t bytes = 0;
+    cache.GetStat(hit, miss, bytes);
+    ASSERT_EQ(hit, 4u);
+    ASSERT_EQ(miss, 1u);
+    ASSERT_EQ(bytes, 300u);
+}
+
+TEST(TestSyncResponseCache, ReplaceAndRemove) {
+    SyncResponseCache cache(1000);
+    cache.Put("a", MakeEntry(100, 0));
+    auto held = cache.Get("a");
+    cache.Put("a", MakeEntry(10, 20));
+    // readers keep the entry they got
+    ASSERT_EQ(held->payload.size(), 100u);
+    ASSERT_EQ(cache.Get("a")->block.size, 20u);
+    cache.Remove("a");
+    ASSERT_EQ(cache.Get("a"), nullptr);
+
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    uint64_t bytes = 0;
+    cache.GetStat(hit, miss, bytes);
+    ASSERT_EQ(bytes, 0u);
+    // larger than the whole cache, not kept
+    cache.Put("b", MakeEntry(2000, 0));
+    ASSERT_EQ(cache.Get("b"), nullptr);
+}
+
+TEST(TestSyncResponseCache, ExpiredEntriesDropped) {
+    SyncResponseCache cache(1000);
+    auto tp_now = std::chrono::steady_clock::now();
+    auto expired = MakeEntry(100, 0);
+    expired->expire_time = tp_now - std::chrono::seconds(1);
+    cache.Put("a", expired);
+    auto later = MakeEntry(10, 20);
+    later->expire_time = tp_now + std::chrono::seconds(60);
+    cache.Put("b", later);
+    cache.Put("c", MakeEntry(50, 0));
+    // an expired entry is a miss, even before it is dropped
+    ASSERT_EQ(cache.Get("a"), nullptr);
+    ASSERT_NE(cache.Get("b"), nullptr);
+
+    uint64_t hit = 0;
+    uint64_t miss = 0;
+    uint64_t bytes = 0;
+    cache.GetStat(hit, miss, bytes);
+    ASSERT_EQ(bytes, 80u);
+    cache.DropExpired(tp_now + std::chrono::seconds(60));
+    ASSERT_EQ(cache.Get("b"), nullptr);
+    ASSERT_NE(cache.Get("c"), nullptr);
+    cache.GetStat(hit, miss, bytes);
+    ASSERT_EQ(bytes, 50u);
+}
+
+}  // namespace test
+
+}  // namespace gossip
+
+}  // namespace top
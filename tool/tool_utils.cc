@@ -0,0 +1,80 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "xgossip/tool/tool_utils.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xpbase/base/top_utils.h"
+#include "xkad/routing_table/routing_utils.h"
+#include "xgossip/include/gossip_utils.h"
+
+namespace top {
+    std::shared_ptr<top::base::KadmliaKey> global_xid;
+    uint32_t gloabl_platform_type = kPlatform;
+    std::string global_node_id = RandomString(256);
+    std::string global_node_id_hash("");
+}
+
+namespace top {
+
+namespace gossip {
+
+namespace tool {
+
+static const uint32_t kToolGossipTypeCount = 4u;
+static const uint32_t kToolGossipTypes[kToolGossipTypeCount] = {
+    kGossipBloomfilter,
+    kGossipLayeredBroadcast,
+    kGossipBloomfilterAndLayered,
+    kGossipSetFilterAndLayered,
+};
+
+const char* GossipTypeName(uint32_t gossip_type) {
+    switch (gossip_type) {
+    case kGossipBloomfilter:
+        return "bloomfilter";
+    case kGossipLayeredBroadcast:
+        return "layered";
+    case kGossipBloomfilterAndLayered:
+        return "bloomfilter_layered";
+    case kGossipSetFilterAndLayered:
+        return "set_layered";
+    default:
+        return "unknown";
+    }
+}
+
+bool GetArg(const char* arg, const char* name, std::string& value) {
+    std::string prefix = std::string("--") + name + "=";
+    if (strncmp(arg, prefix.c_str(), prefix.size()) != 0) {
+        return false;
+    }
+    value = arg + prefix.size();
+    return true;
+}
+
+void GetGossipTypes(uint32_t gossip_type, std::vector<uint32_t>& gossip_types) {
+    gossip_types.clear();
+    if (gossip_type != 0) {
+        gossip_types.push_back(gossip_type);
+        return;
+    }
+    gossip_types.assign(kToolGossipTypes, kToolGossipTypes + kToolGossipTypeCount);
+}
+
+void PrintGossipTypeUsage() {
+    printf("type 0 runs");
+    for (uint32_t i = 0; i < kToolGossipTypeCount; ++i) {
+        printf(" %s(%u)", GossipTypeName(kToolGossipTypes[i]), kToolGossipTypes[i]);
+    }
+    printf("\n");
+}
+
+}  // namespace tool
+
+}  // namespace gossip
+
+}  // namespace top
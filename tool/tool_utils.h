@@ -0,0 +1,35 @@
+// Copyright (c) 2017-2019 Telos Foundation & contributors
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace top {
+
+namespace gossip {
+
+namespace tool {
+
+// command line helpers shared by xgossip_sim, xgossip_cluster and
+// xgossip_replay. tool_utils.cc also defines the top::global_* the
+// libraries expect from the executable
+
+// short name of gossip_type for result tables
+const char* GossipTypeName(uint32_t gossip_type);
+// --name=value, false if arg is not --name=
+bool GetArg(const char* arg, const char* name, std::string& value);
+// gossip_type 0 is every type the tools compare, else only gossip_type
+void GetGossipTypes(uint32_t gossip_type, std::vector<uint32_t>& gossip_types);
+// the usage line of --type
+void PrintGossipTypeUsage();
+
+}  // namespace tool
+
+}  // namespace gossip
+
+}  // namespace top